@@ -112,6 +112,7 @@ extern int              am_thingcolor;
 extern int              am_tswallcolor;
 extern int              am_wallcolor;
 extern dboolean         autoload;
+extern dboolean         buildreject;
 extern dboolean         centerweapon;
 extern dboolean         con_obituaries;
 extern dboolean         con_timestamps;
@@ -127,6 +128,7 @@ extern int              gp_vibrate_damage;
 extern int              gp_vibrate_weapons;
 extern char             *iwadfolder;
 extern char             *language;
+extern dboolean         levelcache;
 extern dboolean         messages;
 extern float            m_acceleration;
 extern dboolean         m_doubleclick_use;
@@ -149,6 +151,7 @@ extern dboolean         r_corpses_slide;
 extern dboolean         r_corpses_smearblood;
 extern int              r_detail;
 extern int              r_diskicon;
+extern int              r_dynamicresolution;
 extern dboolean         r_fixmaperrors;
 extern dboolean         r_fixspriteoffsets;
 extern dboolean         r_floatbob;
@@ -163,12 +166,16 @@ extern dboolean         r_liquid_swirl;
 extern char             *r_lowpixelsize;
 extern dboolean         r_mirroredweapons;
 extern dboolean         r_playersprites;
+extern int              r_renderscale;
 extern dboolean         r_rockettrails;
 extern int              r_screensize;
 extern dboolean         r_shadows;
 extern int              r_shakescreen;
 extern dboolean         r_translucency;
+extern int              rewind_interval;
+extern int              rewind_memory;
 extern int              s_musicvolume;
+extern dboolean         s_precachesfx;
 extern dboolean         s_randommusic;
 extern dboolean         s_randompitch;
 extern int              s_sfxvolume;
@@ -211,6 +218,7 @@ extern unsigned int     stat_shotsfired;
 extern unsigned int     stat_shotshit;
 extern unsigned int     stat_time;
 extern int              stillbob;
+extern dboolean         threadedai;
 extern int              timelimit;
 extern int              turbo;
 extern int              units;
@@ -220,6 +228,7 @@ extern int              vid_display;
 extern char             *vid_driver;
 #endif
 extern dboolean         vid_fullscreen;
+extern int              vid_maxfps;
 extern dboolean         vid_motionblur;
 extern char             *vid_scaleapi;
 extern char             *vid_scalefilter;
@@ -310,6 +319,7 @@ action_t actions[] =
     { "+menu",         &keyboardmenu,              NULL,                  NULL,             NULL, &gamepadmenu,              NULL         },
     { "+nextweapon",   &keyboardnextweapon,        NULL,                  &mousenextweapon, NULL, &gamepadnextweapon,        NULL         },
     { "+prevweapon",   &keyboardprevweapon,        NULL,                  &mouseprevweapon, NULL, &gamepadprevweapon,        NULL         },
+    { "+rewind",       &keyboardrewind,            NULL,                  NULL,             NULL, NULL,                      NULL         },
     { "+right",        &keyboardright,             NULL,                  NULL,             NULL, &gamepadright,             NULL         },
     { "+rotatemode",   &keyboardautomaprotatemode, NULL,                  NULL,             NULL, &gamepadautomaprotatemode, NULL         },
     { "+run",          &keyboardrun,               NULL,                  &mouserun,        NULL, &gamepadrun,               NULL         },
@@ -370,6 +380,8 @@ static dboolean respawnmonsters_cmd_func1(char *, char *, char *, char *);
 static void respawnmonsters_cmd_func2(char *, char *, char *, char *);
 static dboolean resurrect_cmd_func1(char *, char *, char *, char *);
 static void resurrect_cmd_func2(char *, char *, char *, char *);
+static dboolean rewind_cmd_func1(char *, char *, char *, char *);
+static void rewind_cmd_func2(char *, char *, char *, char *);
 static dboolean save_cmd_func1(char *, char *, char *, char *);
 static void save_cmd_func2(char *, char *, char *, char *);
 static dboolean spawn_cmd_func1(char *, char *, char *, char *);
@@ -402,12 +414,15 @@ static void r_blood_cvar_func2(char *, char *, char *, char *);
 static void r_bloodsplats_max_cvar_func2(char *, char *, char *, char *);
 static dboolean r_detail_cvar_func1(char *, char *, char *, char *);
 static void r_detail_cvar_func2(char *, char *, char *, char *);
+static void r_dynamicresolution_cvar_func2(char *, char *, char *, char *);
 static dboolean r_gamma_cvar_func1(char *, char *, char *, char *);
 static void r_gamma_cvar_func2(char *, char *, char *, char *);
 static void r_hud_cvar_func2(char *, char *, char *, char *);
 static void r_lowpixelsize_cvar_func2(char *, char *, char *, char *);
+static void r_renderscale_cvar_func2(char *, char *, char *, char *);
 static void r_screensize_cvar_func2(char *, char *, char *, char *);
 static void r_translucency_cvar_func2(char *, char *, char *, char *);
+static void s_precachesfx_cvar_func2(char *, char *, char *, char *);
 static dboolean s_volume_cvars_func1(char *, char *, char *, char *);
 static void s_volume_cvars_func2(char *, char *, char *, char *);
 static void timelimit_cvar_func2(char *, char *, char *, char *);
@@ -537,6 +552,8 @@ consolecmd_t consolecmds[] =
         "Binds an <i>action</i> to a <i>control</i>."),
     CMD(bindlist, "", null_func1, bindlist_cmd_func2, 0, "",
         "Shows a list of all bound controls."),
+    CVAR_BOOL(buildreject, "", bool_cvars_func1, bool_cvars_func2, BOOLALIAS,
+        "Toggles building a REJECT table for maps that don't\nhave one, so monsters can check their sight faster."),
     CVAR_BOOL(centerweapon, centreweapon, bool_cvars_func1, bool_cvars_func2, BOOLALIAS,
         "Toggles the centering of the player's weapon when firing."),
     CMD(clear, "", null_func1, clear_cmd_func2, 0, "",
@@ -610,6 +627,8 @@ consolecmd_t consolecmds[] =
         "The folder where an IWAD was last opened."),
     CMD(kill, "", kill_cmd_func1, kill_cmd_func2, 1, KILLCMDFORMAT,
         "Kills the <b>player</b>, <b>all</b> monsters or a type of <i>monster</i>."),
+    CVAR_BOOL(levelcache, "", bool_cvars_func1, bool_cvars_func2, BOOLALIAS,
+        "Toggles caching the nodes and blockmap of each map\nso it loads faster the next time."),
     CMD(load, "", null_func1, load_cmd_func2, 1, LOADCMDFORMAT,
         "Loads a game from a file."),
     CVAR_FLOAT(m_acceleration, "", float_cvars_func1, float_cvars_func2, CF_NONE,
@@ -677,6 +696,8 @@ consolecmd_t consolecmds[] =
         "Toggles the graphic detail (<b>low</b> or <b>high</b>)."),
     CVAR_BOOL(r_diskicon, "", bool_cvars_func1, bool_cvars_func2, BOOLALIAS,
         "Toggles showing a disk icon when loading and saving."),
+    CVAR_INT(r_dynamicresolution, "", int_cvars_func1, r_dynamicresolution_cvar_func2, CF_NONE, NOALIAS,
+        "The framerate below which the resolution of the view is\nlowered (<b>0</b> for off, or up to <b>1,000</b> FPS)."),
     CVAR_BOOL(r_fixmaperrors, "", bool_cvars_func1, bool_cvars_func2, BOOLALIAS,
         "Toggles the fixing of mapping errors in the <i><b>DOOM</b></i> and <i><b>DOOM II</b></i>\nIWADs."),
     CVAR_BOOL(r_fixspriteoffsets, "", bool_cvars_func1, bool_cvars_func2, BOOLALIAS,
@@ -705,6 +726,8 @@ consolecmd_t consolecmds[] =
         "Toggles randomly mirroring the weapons dropped by monsters."),
     CVAR_BOOL(r_playersprites, "", bool_cvars_func1, bool_cvars_func2, BOOLALIAS,
         "Toggles the display of the player's weapon."),
+    CVAR_INT(r_renderscale, "", int_cvars_func1, r_renderscale_cvar_func2, CF_PERCENT, NOALIAS,
+        "The resolution the view is rendered at (<b>50%</b> to <b>100%</b>)."),
     CVAR_BOOL(r_rockettrails, "", bool_cvars_func1, bool_cvars_func2, BOOLALIAS,
         "Toggles the trails behind rockets fired by the player and\ncyberdemons."),
     CVAR_INT(r_screensize, "", int_cvars_func1, r_screensize_cvar_func2, CF_NONE, NOALIAS,
@@ -725,8 +748,16 @@ consolecmd_t consolecmds[] =
         "Toggles respawning monsters."),
     CMD(resurrect, "", resurrect_cmd_func1, resurrect_cmd_func2, 0, "",
         "Resurrects the player."),
+    CMD(rewind, "", rewind_cmd_func1, rewind_cmd_func2, 0, "",
+        "Rewinds the game to the last snapshot taken."),
+    CVAR_INT(rewind_interval, "", int_cvars_func1, int_cvars_func2, CF_NONE, NOALIAS,
+        "The number of seconds between each snapshot taken\nto rewind to."),
+    CVAR_INT(rewind_memory, "", int_cvars_func1, int_cvars_func2, CF_NONE, NOALIAS,
+        "The amount of memory used to keep snapshots to\nrewind to, in megabytes (<b>0</b> to disable)."),
     CVAR_INT(s_musicvolume, "", s_volume_cvars_func1, s_volume_cvars_func2, CF_PERCENT, NOALIAS,
         "The music volume."),
+    CVAR_BOOL(s_precachesfx, "", bool_cvars_func1, s_precachesfx_cvar_func2, BOOLALIAS,
+        "Toggles converting all sound effects in advance,\nrather than when each is first played."),
     CVAR_BOOL(s_randommusic, "", bool_cvars_func1, bool_cvars_func2, BOOLALIAS,
         "Toggles randomizing the music at the start of each map."),
     CVAR_BOOL(s_randompitch, "", bool_cvars_func1, bool_cvars_func2, BOOLALIAS,
@@ -749,6 +780,8 @@ consolecmd_t consolecmds[] =
         "Teleports the player to (<i>x</i>,<i>y</i>) in the current map."),
     CMD(thinglist, "", game_func1, thinglist_cmd_func2, 0, "",
         "Shows a list of things in the current map."),
+    CVAR_BOOL(threadedai, "", bool_cvars_func1, bool_cvars_func2, BOOLALIAS,
+        "Toggles tracing the lines of sight of monsters on more than one\nthread."),
     CVAR_INT(timelimit, "", int_cvars_func1, timelimit_cvar_func2, CF_NONE, TIMELIMITALIAS,
         "The time limit for each map (<b>none</b> or in minutes)."),
     CVAR_INT(turbo, "", turbo_cvar_func1, turbo_cvar_func2, CF_PERCENT, NOALIAS,
@@ -769,6 +802,8 @@ consolecmd_t consolecmds[] =
 #endif
     CVAR_BOOL(vid_fullscreen, "", bool_cvars_func1, vid_fullscreen_cvar_func2, BOOLALIAS,
         "Toggles between fullscreen and a window."),
+    CVAR_INT(vid_maxfps, "", int_cvars_func1, int_cvars_func2, CF_NONE, NOALIAS,
+        "The maximum framerate when it isn't capped at 35 FPS (<b>0</b>\nfor no limit, or up to <b>1,000</b> FPS)."),
     CVAR_BOOL(vid_motionblur, "", bool_cvars_func1, bool_cvars_func2, BOOLALIAS,
         "Toggles motion blur when the player turns quickly."),
     CVAR_STR(vid_scaleapi, "", vid_scaleapi_cvar_func1, vid_scaleapi_cvar_func2, CF_NONE,
@@ -2458,6 +2493,10 @@ static void mapstats_cmd_func2(char *cmd, char *parm1, char *parm2, char *parm3)
             commify((max_x - min_x) >> FRACBITS), commify((max_y - min_y) >> FRACBITS));
     }
 
+    if (sightchecks)
+        C_TabbedOutput(tabs, "Sight checks\t<b>%s</b> (<b>%i%%</b> cached)",
+            commify(sightchecks), (int)(sightcachehits * 100 / sightchecks));
+
     if (mus_playing && !nomusic)
     {
         int     lumps = W_CheckMultipleLumps(mus_playing->name);
@@ -3164,6 +3203,19 @@ static void resurrect_cmd_func2(char *cmd, char *parm1, char *parm2, char *parm3
     M_SaveCVARs();
 }
 
+//
+// rewind cmd
+//
+static dboolean rewind_cmd_func1(char *cmd, char *parm1, char *parm2, char *parm3)
+{
+    return G_CanRewind();
+}
+
+static void rewind_cmd_func2(char *cmd, char *parm1, char *parm2, char *parm3)
+{
+    G_Rewind();
+}
+
 //
 // save cmd
 //
@@ -3940,8 +3992,11 @@ static void r_bloodsplats_max_cvar_func2(char *cmd, char *parm1, char *parm2, ch
 
     int_cvars_func2(cmd, parm1, "", "");
     if (r_bloodsplats_max != r_bloodsplats_max_old)
+    {
         P_BloodSplatSpawner = (r_blood == r_blood_none || !r_bloodsplats_max ?
             P_NullBloodSplatSpawner : P_SpawnBloodSplat);
+        P_ResizeBloodSplats();
+    }
 }
 
 //
@@ -3977,6 +4032,18 @@ static void r_detail_cvar_func2(char *cmd, char *parm1, char *parm2, char *parm3
     }
 }
 
+//
+// r_dynamicresolution cvar
+//
+static void r_dynamicresolution_cvar_func2(char *cmd, char *parm1, char *parm2, char *parm3)
+{
+    int r_dynamicresolution_old = r_dynamicresolution;
+
+    int_cvars_func2(cmd, parm1, "", "");
+    if (r_dynamicresolution != r_dynamicresolution_old)
+        R_SetViewSize(r_screensize);
+}
+
 //
 // r_gamma cvar
 //
@@ -4061,6 +4128,18 @@ static void r_lowpixelsize_cvar_func2(char *cmd, char *parm1, char *parm2, char
     }
 }
 
+//
+// r_renderscale cvar
+//
+static void r_renderscale_cvar_func2(char *cmd, char *parm1, char *parm2, char *parm3)
+{
+    int r_renderscale_old = r_renderscale;
+
+    int_cvars_func2(cmd, parm1, "", "");
+    if (r_renderscale != r_renderscale_old)
+        R_SetViewSize(r_screensize);
+}
+
 //
 // r_screensize cvar
 //
@@ -4140,15 +4219,7 @@ static void r_translucency_cvar_func2(char *cmd, char *parm1, char *parm2, char
 
                 while (mo)
                 {
-                    mobjtype_t  type = mo->type;
-
-                    if (type == MT_BLOODSPLAT)
-                        mo->colfunc = bloodsplatcolfunc;
-                    else if (type == MT_SHADOW)
-                        mo->colfunc = (mo->shadow->type == MT_SHADOWS ? R_DrawFuzzyShadowColumn :
-                            (r_translucency ? R_DrawShadowColumn : R_DrawSolidShadowColumn));
-                    else
-                        mo->colfunc = mo->info->colfunc;
+                    mo->colfunc = mo->info->colfunc;
                     mo = mo->snext;
                 }
             }
@@ -4167,6 +4238,17 @@ static void r_translucency_cvar_func2(char *cmd, char *parm1, char *parm2, char
     }
 }
 
+//
+// s_precachesfx cvar
+//
+static void s_precachesfx_cvar_func2(char *cmd, char *parm1, char *parm2, char *parm3)
+{
+    bool_cvars_func2(cmd, parm1, "", "");
+
+    if (s_precachesfx)
+        S_PrecacheSounds();
+}
+
 //
 // s_musicvolume and s_sfxvolume cvars
 //
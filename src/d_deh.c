@@ -215,6 +215,7 @@ char    *s_GGSAVED = GGSAVED;
 char    *s_GGLOADED = "";
 char    *s_GGAUTOLOADED = "";
 char    *s_GSCREENSHOT = GSCREENSHOT;
+char    *s_GREWOUND = GREWOUND;
 
 char    *s_ALWAYSRUNOFF = "";
 char    *s_ALWAYSRUNON = "";
@@ -741,6 +742,7 @@ deh_strs deh_strlookup[] =
     { &s_GGLOADED,             "GGLOADED",             false },
     { &s_GGAUTOLOADED,         "GGAUTOLOADED",         false },
     { &s_GSCREENSHOT,          "GSCREENSHOT",          false },
+    { &s_GREWOUND,             "GREWOUND",             false },
 
     { &s_ALWAYSRUNOFF,         "ALWAYSRUNOFF",         false },
     { &s_ALWAYSRUNON,          "ALWAYSRUNON",          false },
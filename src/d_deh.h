@@ -152,6 +152,7 @@ extern char     *s_GGSAVED;
 extern char     *s_GGLOADED;
 extern char     *s_GGAUTOLOADED;
 extern char     *s_GSCREENSHOT;
+extern char     *s_GREWOUND;
 
 extern char     *s_ALWAYSRUNOFF;
 extern char     *s_ALWAYSRUNON;
@@ -147,6 +147,7 @@
 //
 #define GGSAVED                 "game saved."
 #define GSCREENSHOT             "screen shot"
+#define GREWOUND                "game rewound."
 
 //
 //  hu_stuff.c
@@ -75,7 +75,8 @@ typedef enum
     ga_victory,
     ga_worlddone,
     ga_screenshot,
-    ga_autoloadgame
+    ga_autoloadgame,
+    ga_rewind
 } gameaction_t;
 
 //
@@ -167,7 +167,7 @@ void TryRunTics(void)
             if (I_GetTime() - entertic >= MAX_NETGAME_STALL_TICS)
                 return;
 
-            I_Sleep(1);
+            I_WaitForTic(lasttime + 1);
         }
     }
 
@@ -209,6 +209,7 @@ gamestate_t             wipegamestate = GS_TITLESCREEN;
 extern dboolean         setsizeneeded;
 extern dboolean         message_on;
 extern int              r_detail;
+extern int              vid_maxfps;
 extern int              viewheight2;
 extern gameaction_t     loadaction;
 
@@ -277,7 +278,7 @@ void D_Display(void)
     {
         HU_Erase();
 
-        ST_Drawer((viewheight == SCREENHEIGHT), true);
+        ST_Drawer((scaledviewheight == SCREENHEIGHT), true);
 
         // draw the view directly
         R_RenderPlayerView(&players[0]);
@@ -330,7 +331,7 @@ void D_Display(void)
 
             if (vid_widescreen)
                 V_DrawPatchWithShadow((ORIGINALWIDTH - SHORT(patch->width)) / 2,
-                    viewwindowy / 2 + (viewheight / 2 - SHORT(patch->height)) / 2, patch, false);
+                    viewwindowy / 2 + (scaledviewheight / 2 - SHORT(patch->height)) / 2, patch, false);
             else
                 V_DrawPatchWithShadow((ORIGINALWIDTH - SHORT(patch->width)) / 2,
                     (ORIGINALHEIGHT - SHORT(patch->height)) / 2, patch, false);
@@ -338,7 +339,7 @@ void D_Display(void)
         else
         {
             if (vid_widescreen)
-                M_DrawCenteredString(viewwindowy / 2 + (viewheight / 2 - 16) / 2, s_M_PAUSED);
+                M_DrawCenteredString(viewwindowy / 2 + (scaledviewheight / 2 - 16) / 2, s_M_PAUSED);
             else
                 M_DrawCenteredString((ORIGINALHEIGHT - 16) / 2, s_M_PAUSED);
         }
@@ -354,6 +355,10 @@ void D_Display(void)
         if (drawdisk)
             HU_DrawDisk();
 
+        // cap the framerate when it is uncapped
+        if (vid_maxfps && !vid_capfps)
+            I_CapFramerate(vid_maxfps);
+
         // normal update
         blitfunc();             // blit buffer
 
@@ -61,6 +61,7 @@
 #include "s_sound.h"
 #include "st_stuff.h"
 #include "v_video.h"
+#include "version.h"
 #include "w_wad.h"
 #include "wi_stuff.h"
 #include "z_zone.h"
@@ -74,6 +75,13 @@ void G_DoNewGame(void);
 void G_DoCompleted(void);
 void G_DoWorldDone(void);
 void G_DoSaveGame(void);
+void G_DoRewind(void);
+
+static void G_ClearRewind(void);
+
+#if defined(_DEBUG)
+static void G_CheckRestore(char *description, const byte *data, size_t length);
+#endif
 
 // Game state the last time G_Ticker was called.
 gamestate_t     oldgamestate;
@@ -105,6 +113,8 @@ dboolean        autoload = autoload_default;
 dboolean        gp_swapthumbsticks = gp_swapthumbsticks_default;
 int             gp_vibrate_damage = gp_vibrate_damage_default;
 int             gp_vibrate_weapons = gp_vibrate_weapons_default;
+int             rewind_interval = rewind_interval_default;
+int             rewind_memory = rewind_memory_default;
 
 #define MAXPLMOVE       forwardmove[1]
 
@@ -499,6 +509,9 @@ void G_DoLoadLevel(void)
     char        *author = P_GetMapAuthor(map);
     player_t    *player = &players[0];
 
+    // [BH] snapshots from a previous map can't be rewound to
+    G_ClearRewind();
+
     HU_DrawDisk();
 
     // Set the sky map.
@@ -733,6 +746,11 @@ dboolean G_Responder(event_t *ev)
                 keydown = keyboardalwaysrun;
                 G_ToggleAlwaysRun(ev_keydown);
             }
+            else if (key == keyboardrewind && !menuactive && !paused && !keydown)
+            {
+                keydown = keyboardrewind;
+                G_Rewind();
+            }
             else if (key < NUMKEYS)
             {
                 gamekeydown[key] = true;
@@ -861,6 +879,8 @@ void G_Ticker(void)
     ticcmd_t    *cmd;
     player_t    *player = &players[0];
 
+    G_UpdateSaveGame(false);
+
     // do player reborn if needed
     if (player->playerstate == PST_REBORN)
         G_DoReborn();
@@ -893,6 +913,10 @@ void G_Ticker(void)
                 G_DoSaveGame();
                 break;
 
+            case ga_rewind:
+                G_DoRewind();
+                break;
+
             case ga_completed:
                 G_DoCompleted();
                 break;
@@ -1002,6 +1026,7 @@ void G_Ticker(void)
     {
         case GS_LEVEL:
             P_Ticker();
+            G_UpdateRewind();
             ST_Ticker();
             AM_Ticker();
             HU_Ticker();
@@ -1413,30 +1438,25 @@ void G_LoadGame(char *name)
     gameaction = ga_loadgame;
 }
 
-void G_DoLoadGame(void)
+//
+// G_ReadSaveGame
+// Loads the map of the savegame in save_stream, and then restores everything in it. If inplace
+// is true, the savegame is of the current map and is restored over it without loading it again.
+//
+static dboolean G_ReadSaveGame(char *description, dboolean inplace)
 {
-    int savedleveltime;
-
-    I_SetPalette(W_CacheLumpName("PLAYPAL", PU_CACHE));
-
-    loadaction = gameaction;
-    gameaction = ga_nothing;
-
-    if (!(save_stream = fopen(savename, "rb")))
-        return;
+    if (!P_ReadSaveGameHeader(description))
+        return false;
 
-    if (!P_ReadSaveGameHeader(savedescription))
+    if (!inplace)
     {
-        fclose(save_stream);
-        return;
-    }
+        int savedleveltime = leveltime;
 
-    savedleveltime = leveltime;
+        // load a base level
+        G_InitNew(gameskill, gameepisode, gamemap);
 
-    // load a base level
-    G_InitNew(gameskill, gameepisode, gamemap);
-
-    leveltime = savedleveltime;
+        leveltime = savedleveltime;
+    }
 
     // unarchive all the modifications
     P_UnArchivePlayers();
@@ -1455,7 +1475,56 @@ void G_DoLoadGame(void)
     if (!P_ReadSaveGameEOF())
         I_Error("Bad savegame");
 
-    fclose(save_stream);
+    return true;
+}
+
+void G_DoLoadGame(void)
+{
+    FILE        *handle;
+    byte        *savebuffer;
+    long        length;
+
+    I_SetPalette(W_CacheLumpName("PLAYPAL", PU_CACHE));
+
+    loadaction = gameaction;
+    gameaction = ga_nothing;
+
+    // finish writing any savegame first, in case it's the one being loaded
+    G_UpdateSaveGame(true);
+
+    if (!(handle = fopen(savename, "rb")))
+        return;
+
+    // [BH] read the whole savegame into memory and parse it from there
+    length = M_FileLength(handle);
+
+    if (length <= 0 || !(savebuffer = malloc(length)))
+    {
+        fclose(handle);
+        return;
+    }
+
+    length = (long)fread(savebuffer, 1, length, handle);
+    fclose(handle);
+
+    save_stream = mem_fopen_read(savebuffer, length);
+
+    if (!G_ReadSaveGame(savedescription, false))
+    {
+        mem_fclose(save_stream);
+        free(savebuffer);
+        return;
+    }
+
+    mem_fclose(save_stream);
+
+#if defined(_DEBUG)
+    // savegames from before chunks were added are written differently
+    if (length > SAVESTRINGSIZE + VERSIONSIZE
+        && !strncmp((char *)savebuffer + SAVESTRINGSIZE, PACKAGE_SAVEGAMEVERSIONSTRING, VERSIONSIZE))
+        G_CheckRestore(savedescription, savebuffer, length);
+#endif
+    free(savebuffer);
 
     if (setsizeneeded)
         R_ExecuteSetViewSize();
@@ -1502,50 +1571,63 @@ void G_SaveGame(int slot, char *description, char *name)
     drawdisk = true;
 }
 
-void G_DoSaveGame(void)
+//
+// [BH] A savegame is captured in memory during the tic, and then written to disk on another
+// thread so the game doesn't stall while it waits for slow storage. The player is told it has
+// been saved once the write has finished.
+//
+typedef struct
 {
-    char        *temp_savegame_file = P_TempSaveGameFile();
-    char        *savegame_file = (consoleactive ? savename : P_SaveGameFile(savegameslot));
-
-    // Open the savegame file for writing. We write to a temporary file
-    // and then rename it at the end if it was successfully written.
-    // This prevents an existing savegame from being overwritten by
-    // a corrupted one, or if a savegame buffer overrun occurs.
-    save_stream = fopen(temp_savegame_file, "wb");
+    MEMFILE     *stream;
+    char        *filename;
+    char        *tempfilename;
+    char        savename[256];
+    char        description[SAVESTRINGSIZE];
+    dboolean    console;
+} savejob_t;
+
+static savejob_t        *savejob;
+static thread_t         *savethread;
+
+static int G_WriteSaveGame(thread_t *thread, void *data)
+{
+    savejob_t   *job = data;
+    void        *savebuffer;
+    size_t      length;
+    byte        *packed;
+    size_t      packedlength;
+    dboolean    result;
+
+    mem_get_buf(job->stream, &savebuffer, &length);
+
+    // We write to a temporary file and then rename it over the actual
+    // savegame file if it was successfully written. This prevents an
+    // existing savegame from being overwritten by a corrupted one.
+    if (!P_PackSaveGame(savebuffer, length, &packed, &packedlength))
+        return M_WriteFileSafely(job->filename, job->tempfilename, savebuffer, length);
+
+    result = M_WriteFileSafely(job->filename, job->tempfilename, packed, packedlength);
+    free(packed);
+    return result;
+}
 
-    if (!save_stream)
+static void G_FinishSaveGame(dboolean saved)
+{
+    if (!saved)
     {
         menuactive = false;
         C_ShowConsole();
-        C_Warning("%s couldn't be saved.", savename);
+        C_Warning("%s couldn't be saved.", savejob->savename);
     }
     else
     {
-        P_WriteSaveGameHeader(savedescription);
-
-        P_ArchivePlayers();
-        P_ArchiveWorld();
-        P_ArchiveThinkers();
-        P_ArchiveSpecials();
-        P_ArchiveMap();
-
-        P_WriteSaveGameEOF();
-
-        // Finish up, close the savegame file.
-        fclose(save_stream);
-
-        // Now rename the temporary savegame file to the actual savegame
-        // file, overwriting the old savegame if there was one there.
-        remove(savegame_file);
-        rename(temp_savegame_file, savegame_file);
-
-        if (consoleactive)
-            C_Output("<b>%s</b> saved.", savename);
+        if (savejob->console)
+            C_Output("<b>%s</b> saved.", savejob->savename);
         else
         {
             static char     buffer[1024];
 
-            M_snprintf(buffer, sizeof(buffer), s_GGSAVED, titlecase(savedescription));
+            M_snprintf(buffer, sizeof(buffer), s_GGSAVED, titlecase(savejob->description));
             HU_PlayerMessage(buffer, false, false);
             message_dontfuckwithme = true;
             S_StartSound(NULL, sfx_swtchx);
@@ -1555,11 +1637,272 @@ void G_DoSaveGame(void)
         R_FillBackScreen();
     }
 
-    gameaction = ga_nothing;
+    mem_fclose(savejob->stream);
+    free(savejob->filename);
+    free(savejob);
+    savejob = NULL;
 
     drawdisk = false;
 }
 
+//
+// G_UpdateSaveGame
+// Reports on the savegame being written once it is done, or waits for it if wait is true.
+//
+void G_UpdateSaveGame(dboolean wait)
+{
+    if (savethread && (wait || I_ThreadDone(savethread)))
+    {
+        dboolean    saved = I_WaitThread(savethread, false);
+
+        savethread = NULL;
+        G_FinishSaveGame(saved);
+    }
+}
+
+void G_DoSaveGame(void)
+{
+    // only one savegame is written at a time
+    G_UpdateSaveGame(true);
+
+    savejob = calloc(1, sizeof(*savejob));
+    savejob->filename = strdup(consoleactive ? savename : P_SaveGameFile(savegameslot));
+    savejob->tempfilename = P_TempSaveGameFile();
+    M_StringCopy(savejob->savename, savename, sizeof(savejob->savename));
+    M_StringCopy(savejob->description, savedescription, sizeof(savejob->description));
+    savejob->console = consoleactive;
+
+    // [BH] Build the savegame in memory, and then write it out all at once.
+    save_stream = savejob->stream = mem_fopen_write();
+
+    P_WriteSaveGameHeader(savedescription);
+
+    P_ArchivePlayers();
+    P_ArchiveWorld();
+    P_ArchiveThinkers();
+    P_ArchiveSpecials();
+    P_ArchiveMap();
+
+    P_WriteSaveGameEOF();
+
+    gameaction = ga_nothing;
+
+    if (!(savethread = I_StartThread(G_WriteSaveGame, "Savegame writer", savejob)))
+        G_FinishSaveGame(G_WriteSaveGame(NULL, savejob));
+}
+
+//
+// REWIND BUFFER
+// [BH] Every rewind_interval seconds a snapshot of the game is archived in memory, exactly as it
+// would be in a savegame, and each of its chunks compressed. The oldest snapshots are discarded
+// once rewind_memory MB is used.
+//
+#define MAXREWINDS      256
+
+typedef struct
+{
+    byte        *snapshot;
+    size_t      length;
+    int         leveltime;
+} rewind_t;
+
+static rewind_t rewinds[MAXREWINDS];
+static int      firstrewind;
+static int      numrewinds;
+static size_t   rewindsize;
+static int      nextrewindleveltime;
+
+static void G_FreeRewind(rewind_t *rewind)
+{
+    rewindsize -= rewind->length;
+    free(rewind->snapshot);
+    rewind->snapshot = NULL;
+}
+
+static void G_FreeOldestRewind(void)
+{
+    G_FreeRewind(&rewinds[firstrewind]);
+    firstrewind = (firstrewind + 1) % MAXREWINDS;
+    numrewinds--;
+}
+
+static void G_ClearRewind(void)
+{
+    while (numrewinds)
+        G_FreeOldestRewind();
+
+    nextrewindleveltime = 0;
+}
+
+//
+// G_TakeSnapshot
+// Archives the game into a new buffer, compressed using P_PackSaveGame(), that must be freed by
+// the caller.
+//
+static dboolean G_TakeSnapshot(char *description, byte **snapshot, size_t *length)
+{
+    void        *buffer;
+    size_t      bufferlength;
+    dboolean    result;
+
+    save_stream = mem_fopen_write();
+
+    P_WriteSaveGameHeader(description);
+
+    P_ArchivePlayers();
+    P_ArchiveWorld();
+    P_ArchiveThinkers();
+    P_ArchiveSpecials();
+    P_ArchiveMap();
+
+    P_WriteSaveGameEOF();
+
+    mem_get_buf(save_stream, &buffer, &bufferlength);
+
+    if ((result = P_PackSaveGame(buffer, bufferlength, snapshot, length)))
+    {
+        // the packed buffer is as big as the unpacked one, so give back what isn't used
+        byte    *shrunk = realloc(*snapshot, *length);
+
+        if (shrunk)
+            *snapshot = shrunk;
+    }
+
+    mem_fclose(save_stream);
+
+    return result;
+}
+
+#if defined(_DEBUG)
+//
+// G_CheckRestore
+// [BH] Archives the game again once it has been restored from a savegame or a snapshot, and
+// warns if the result isn't the same, as something wasn't saved or restored properly.
+//
+static void G_CheckRestore(char *description, const byte *data, size_t length)
+{
+    byte    *check;
+    size_t  checklength;
+
+    if (!G_TakeSnapshot(description, &check, &checklength))
+        return;
+
+    if (checklength != length || memcmp(check, data, length))
+        C_Warning("The game wasn't restored exactly as it was saved.");
+
+    free(check);
+}
+#endif
+
+//
+// G_UpdateRewind
+// Called every tic to take a new snapshot when it is due.
+//
+void G_UpdateRewind(void)
+{
+    rewind_t    *rewind;
+    byte        *snapshot;
+    size_t      length;
+
+    if (!rewind_memory)
+    {
+        if (numrewinds)
+            G_ClearRewind();
+
+        return;
+    }
+
+    if (players[0].playerstate != PST_LIVE || paused || menuactive
+        || leveltime < nextrewindleveltime)
+        return;
+
+    if (!G_TakeSnapshot("", &snapshot, &length))
+        return;
+
+    if (numrewinds == MAXREWINDS)
+        G_FreeOldestRewind();
+
+    rewind = &rewinds[(firstrewind + numrewinds++) % MAXREWINDS];
+    rewind->snapshot = snapshot;
+    rewind->length = length;
+    rewind->leveltime = leveltime;
+    rewindsize += length;
+
+    nextrewindleveltime = leveltime + rewind_interval * TICRATE;
+
+    // the newest snapshot is always kept, even if it's bigger than rewind_memory on its own
+    while (numrewinds > 1 && rewindsize > (size_t)rewind_memory * 1024 * 1024)
+        G_FreeOldestRewind();
+}
+
+//
+// G_CanRewind
+//
+dboolean G_CanRewind(void)
+{
+    return (numrewinds && gamestate == GS_LEVEL);
+}
+
+//
+// G_Rewind
+// Called by G_Responder and the rewind CCMD.
+//
+void G_Rewind(void)
+{
+    if (G_CanRewind())
+        gameaction = ga_rewind;
+}
+
+//
+// G_DoRewind
+// Restores the most recent snapshot, and then discards it so that the one before it is
+// restored next.
+//
+void G_DoRewind(void)
+{
+    char        description[SAVESTRINGSIZE];
+    rewind_t    *rewind;
+    dboolean    result;
+    int         seconds;
+
+    gameaction = ga_nothing;
+
+    if (!G_CanRewind())
+        return;
+
+    rewind = &rewinds[(firstrewind + numrewinds - 1) % MAXREWINDS];
+    seconds = MAX(0, leveltime - rewind->leveltime) / TICRATE;
+
+    save_stream = mem_fopen_read(rewind->snapshot, rewind->length);
+
+    // snapshots are always of the current map, so the live level is restored in place
+    result = G_ReadSaveGame(description, true);
+
+    mem_fclose(save_stream);
+
+#if defined(_DEBUG)
+    if (result)
+        G_CheckRestore(description, rewind->snapshot, rewind->length);
+#endif
+
+    G_FreeRewind(rewind);
+    numrewinds--;
+
+    if (!result)
+    {
+        G_ClearRewind();
+        return;
+    }
+
+    // don't take another snapshot straight away, so rewinding again goes further back
+    nextrewindleveltime = leveltime + rewind_interval * TICRATE;
+
+    HU_SetPlayerMessage(s_GREWOUND, false);
+    message_dontfuckwithme = true;
+
+    C_Output("Rewound %i second%s.", seconds, (seconds == 1 ? "" : "s"));
+}
+
 skill_t d_skill;
 int     d_episode;
 int     d_map;
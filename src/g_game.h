@@ -63,6 +63,12 @@ void G_DoLoadGame(void);
 
 // Called by M_Responder.
 void G_SaveGame(int slot, char *description, char *name);
+void G_UpdateSaveGame(dboolean wait);
+
+// [BH] Rewind to snapshots kept in memory.
+void G_UpdateRewind(void);
+dboolean G_CanRewind(void);
+void G_Rewind(void);
 
 void G_ExitLevel(void);
 void G_SecretExitLevel(void);
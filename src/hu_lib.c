@@ -277,12 +277,12 @@ void HUlib_eraseTextLine(hu_textline_t *l)
 
         for (y = l->y, yoffset = y * SCREENWIDTH; y < l->y + lh; y++, yoffset += SCREENWIDTH)
         {
-            if (y < viewwindowy || y >= viewwindowy + viewheight)
+            if (y < viewwindowy || y >= viewwindowy + scaledviewheight)
                 R_VideoErase(yoffset, SCREENWIDTH);                             // erase entire line
             else
             {
                 R_VideoErase(yoffset, viewwindowx);                             // erase left border
-                R_VideoErase(yoffset + viewwindowx + viewwidth, viewwindowx);   // erase right border
+                R_VideoErase(yoffset + viewwindowx + scaledviewwidth, viewwindowx);   // erase right border
             }
         }
     }
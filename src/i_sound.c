@@ -301,25 +301,19 @@ static dboolean ConvertibleRatio(int freq1, int freq2)
     }
 }
 
-// Generic sound expansion function for any sample rate.
-// Returns number of clipped samples (always 0).
-static dboolean ExpandSoundData(sfxinfo_t *sfxinfo, byte *data, int samplerate, int length)
+// Calculate the length of the expanded version of a sample.
+// Double up twice: 8 -> 16 bit and mono -> stereo
+static uint32_t ExpandedLength(int samplerate, int length)
 {
-    SDL_AudioCVT        convertor;
-    Mix_Chunk           *chunk;
-
-    // Calculate the length of the expanded version of the sample.
-    // Double up twice: 8 -> 16 bit and mono -> stereo
-    uint32_t            expanded_length = (uint32_t)(((uint64_t)length * mixer_freq) / samplerate)
-                           * 4;
-
-    // Allocate a chunk in which to expand the sound
-    allocated_sound_t   *snd = AllocateSound(sfxinfo, expanded_length);
-
-    if (!snd)
-        return false;
+    return (uint32_t)(((uint64_t)length * mixer_freq) / samplerate) * 4;
+}
 
-    chunk = &snd->chunk;
+// Generic sound expansion function for any sample rate, into a chunk
+// that has already been allocated. This only touches the chunk, so it
+// can be called from any thread.
+static void ConvertSoundData(Mix_Chunk *chunk, byte *data, int samplerate, int length)
+{
+    SDL_AudioCVT        convertor;
 
     // If we can, use the standard / optimized SDL conversion routines.
     if (samplerate <= mixer_freq && ConvertibleRatio(samplerate, mixer_freq)
@@ -335,6 +329,7 @@ static dboolean ExpandSoundData(sfxinfo_t *sfxinfo, byte *data, int samplerate,
     else
     {
         Sint16          *expanded = (Sint16 *)chunk->abuf;
+        uint32_t        expanded_length;
         int             expand_ratio;
         unsigned int    i;
 
@@ -358,7 +353,8 @@ static dboolean ExpandSoundData(sfxinfo_t *sfxinfo, byte *data, int samplerate,
         }
 
         {
-            float       rc, dt, alpha;
+            float       rc, dt;
+            int         alpha;
 
             // Low-pass filter for cutoff frequency f:
             //
@@ -370,36 +366,45 @@ static dboolean ExpandSoundData(sfxinfo_t *sfxinfo, byte *data, int samplerate,
             // (maximum frequency, by nyquist)
             dt = 1.0f / mixer_freq;
             rc = 1.0f / (float)(2 * M_PI * samplerate);
-            alpha = dt / (rc + dt);
+
+            // [BH] alpha is applied in 1.15 fixed point
+            alpha = (int)(dt / (rc + dt) * 32768);
 
             // Both channels are processed in parallel, hence [i - 2]:
             for (i = 2; i < expanded_length * 2; ++i)
-                expanded[i] = (Sint16)(alpha * expanded[i] + (1 - alpha) * expanded[i - 2]);
+                expanded[i] = (Sint16)((alpha * expanded[i] + (32768 - alpha) * expanded[i - 2]) >> 15);
         }
     }
+}
+
+// Allocate a chunk for a sound effect, and expand it into it.
+static dboolean ExpandSoundData(sfxinfo_t *sfxinfo, byte *data, int samplerate, int length)
+{
+    // Allocate a chunk in which to expand the sound
+    allocated_sound_t   *snd = AllocateSound(sfxinfo, ExpandedLength(samplerate, length));
+
+    if (!snd)
+        return false;
+
+    ConvertSoundData(&snd->chunk, data, samplerate, length);
 
     return true;
 }
 
-// Load and convert a sound effect
-// Returns true if successful
-static dboolean CacheSFX(sfxinfo_t *sfxinfo)
+// Cache a sound effect lump and check its header.
+// Returns a pointer to its samples, or NULL if it's invalid.
+static byte *GetSoundSamples(int lumpnum, int *samplerate, unsigned int *length)
 {
-    int                 samplerate;
-    unsigned int        length;
-
-    // need to load the sound
-    int                 lumpnum = sfxinfo->lumpnum;
     byte                *data = W_CacheLumpNum(lumpnum, PU_STATIC);
     unsigned int        lumplen = W_LumpLength(lumpnum);
 
     // Check the header, and ensure this is a valid sound
     if (lumplen < 8 || data[0] != 0x03 || data[1] != 0x00)
-        return false;   // Invalid sound
+        return NULL;    // Invalid sound
 
     // 16 bit sample rate field, 32 bit length field
-    samplerate = ((data[3] << 8) | data[2]);
-    length = ((data[7] << 24) | (data[6] << 16) | (data[5] << 8) | data[4]);
+    *samplerate = ((data[3] << 8) | data[2]);
+    *length = ((data[7] << 24) | (data[6] << 16) | (data[5] << 8) | data[4]);
 
     // If the header specifies that the length of the sound is greater than
     // the length of the lump itself, this is an invalid sound lump
@@ -409,24 +414,97 @@ static dboolean CacheSFX(sfxinfo_t *sfxinfo)
     // seems to vary slightly depending on the sample rate. This needs
     // further investigation to better understand the correct
     // behavior.
-    if (length > lumplen - 8 || length <= 48)
-        return false;
+    if (*length > lumplen - 8 || *length <= 48)
+        return NULL;
 
     // The DMX sound library seems to skip the first 16 and last 16
     // bytes of the lump - reason unknown.
-    data += 16;
-    length -= 32;
+    *length -= 32;
+
+    return data + 24;
+}
+
+// Load and convert a sound effect
+// Returns true if successful
+static dboolean CacheSFX(sfxinfo_t *sfxinfo)
+{
+    int                 samplerate;
+    unsigned int        length;
+    byte                *data = GetSoundSamples(sfxinfo->lumpnum, &samplerate, &length);
+
+    if (!data)
+        return false;
 
     // Sample rate conversion
-    if (!ExpandSoundData(sfxinfo, data + 8, samplerate, length))
+    if (!ExpandSoundData(sfxinfo, data, samplerate, length))
         return false;
 
     // don't need the original lump any more
-    W_ReleaseLumpNum(lumpnum);
+    W_ReleaseLumpNum(sfxinfo->lumpnum);
 
     return true;
 }
 
+typedef struct
+{
+    allocated_sound_t   *snd;
+    byte                *data;
+    int                 samplerate;
+    unsigned int        length;
+} convertjob_t;
+
+static void ConvertSoundJob(void *data, int job, int worker)
+{
+    convertjob_t        *convertjob = (convertjob_t *)data + job;
+
+    ConvertSoundData(&convertjob->snd->chunk, convertjob->data, convertjob->samplerate,
+        convertjob->length);
+}
+
+// Convert every sound effect that hasn't been converted yet, spread
+// across the worker threads, so that none of them has to be converted
+// the first time it's played. Lumps are cached and chunks allocated
+// here first, since neither can be done from the workers.
+void I_PrecacheSounds(sfxinfo_t *sfxinfos, int count)
+{
+    convertjob_t        *jobs;
+    int                 numjobs = 0;
+    int                 i;
+
+    if (!sound_initialized || !(jobs = malloc(count * sizeof(*jobs))))
+        return;
+
+    for (i = 0; i < count; i++)
+    {
+        sfxinfo_t       *sfxinfo = &sfxinfos[i];
+        convertjob_t    *job = &jobs[numjobs];
+
+        if (sfxinfo->lumpnum < 0 || GetAllocatedSoundBySfxInfoAndPitch(sfxinfo, NORM_PITCH))
+            continue;
+
+        if (!(job->data = GetSoundSamples(sfxinfo->lumpnum, &job->samplerate, &job->length))
+            || !(job->snd = AllocateSound(sfxinfo, ExpandedLength(job->samplerate, job->length))))
+        {
+            W_ReleaseLumpNum(sfxinfo->lumpnum);
+            continue;
+        }
+
+        // Don't let the cache free it before it's been converted
+        LockAllocatedSound(job->snd);
+        numjobs++;
+    }
+
+    I_RunJobs(ConvertSoundJob, jobs, numjobs);
+
+    for (i = 0; i < numjobs; i++)
+    {
+        UnlockAllocatedSound(jobs[i].snd);
+        W_ReleaseLumpNum(jobs[i].snd->sfxinfo->lumpnum);
+    }
+
+    free(jobs);
+}
+
 // Load a SFX chunk into memory and ensure that it is locked.
 static dboolean LockSound(sfxinfo_t *sfxinfo)
 {
@@ -47,6 +47,7 @@ void I_ShutdownWindows32(void);
 #include "c_console.h"
 #include "doomstat.h"
 #include "i_gamepad.h"
+#include "i_system.h"
 #include "i_timer.h"
 #include "m_config.h"
 #include "m_misc.h"
@@ -204,6 +205,261 @@ void I_PrintSystemInfo(void)
         cores, (cores > 1 ? "s" : ""), commify(SDL_GetSystemRAM()));
 }
 
+//
+// WORKER THREADS
+// A pool of threads that I_RunJobs() hands out jobs to. The pool is created the first time
+// it is needed, with one thread for each additional CPU core.
+//
+#define MAXWORKERS      15
+
+static SDL_Thread       *workers[MAXWORKERS];
+static int              numworkers = -1;
+
+static SDL_mutex        *workermutex;
+static SDL_cond         *workercond;
+static SDL_cond         *workersdonecond;
+static int              workersbusy;
+static int              jobbatch;
+static dboolean         quitworkers;
+
+static jobfunc_t        jobfunc;
+static void             *jobdata;
+static int              numjobs;
+static SDL_atomic_t     nextjob;
+
+static void I_DoJobs(int worker)
+{
+    int job;
+
+    while ((job = SDL_AtomicAdd(&nextjob, 1)) < numjobs)
+        jobfunc(jobdata, job, worker);
+}
+
+static int SDLCALL I_WorkerThread(void *data)
+{
+    int worker = (int)(intptr_t)data;
+    int batch = 0;
+
+    SDL_LockMutex(workermutex);
+
+    while (true)
+    {
+        while (batch == jobbatch && !quitworkers)
+            SDL_CondWait(workercond, workermutex);
+
+        if (quitworkers)
+            break;
+
+        batch = jobbatch;
+        SDL_UnlockMutex(workermutex);
+
+        I_DoJobs(worker);
+
+        SDL_LockMutex(workermutex);
+
+        if (!--workersbusy)
+            SDL_CondSignal(workersdonecond);
+    }
+
+    SDL_UnlockMutex(workermutex);
+    return 0;
+}
+
+static void I_StartWorkers(void)
+{
+    int count = MIN(SDL_GetCPUCount() - 1, MAXWORKERS);
+
+    numworkers = 0;
+
+    if (count < 1 || !(workermutex = SDL_CreateMutex()) || !(workercond = SDL_CreateCond())
+        || !(workersdonecond = SDL_CreateCond()))
+        return;
+
+    while (numworkers < count)
+    {
+        char    name[16];
+
+        M_snprintf(name, sizeof(name), "Worker %i", numworkers + 1);
+
+        if (!(workers[numworkers] = SDL_CreateThread(I_WorkerThread, name,
+            (void *)(intptr_t)numworkers)))
+            break;
+
+        numworkers++;
+    }
+}
+
+static void I_ShutdownWorkers(void)
+{
+    int i;
+
+    if (numworkers <= 0)
+        return;
+
+    SDL_LockMutex(workermutex);
+    quitworkers = true;
+    SDL_CondBroadcast(workercond);
+    SDL_UnlockMutex(workermutex);
+
+    for (i = 0; i < numworkers; i++)
+        SDL_WaitThread(workers[i], NULL);
+
+    numworkers = 0;
+}
+
+//
+// I_GetNumWorkers
+// Returns the number of threads that can run jobs at once, including the calling thread.
+//
+int I_GetNumWorkers(void)
+{
+    if (numworkers == -1)
+        I_StartWorkers();
+
+    return numworkers + 1;
+}
+
+//
+// I_RunJobs
+// Calls func(data, job, worker) for each job from 0 to count - 1, spread across the worker
+// threads and the calling thread, and returns once all of them are done. Each worker is
+// numbered from 0 to I_GetNumWorkers() - 1.
+//
+void I_RunJobs(jobfunc_t func, void *data, int count)
+{
+    if (I_GetNumWorkers() == 1 || count < 2)
+    {
+        int job;
+
+        for (job = 0; job < count; job++)
+            func(data, job, 0);
+
+        return;
+    }
+
+    SDL_LockMutex(workermutex);
+    jobfunc = func;
+    jobdata = data;
+    numjobs = count;
+    SDL_AtomicSet(&nextjob, 0);
+    workersbusy = numworkers;
+    jobbatch++;
+    SDL_CondBroadcast(workercond);
+    SDL_UnlockMutex(workermutex);
+
+    I_DoJobs(numworkers);
+
+    SDL_LockMutex(workermutex);
+
+    while (workersbusy)
+        SDL_CondWait(workersdonecond, workermutex);
+
+    SDL_UnlockMutex(workermutex);
+}
+
+//
+// BACKGROUND THREADS
+// Longer tasks that run alongside the game, such as building a REJECT table. The game checks
+// I_ThreadDone() while it waits for the result, and a task that is no longer wanted is asked to
+// stop by I_WaitThread(). Tasks that don't check I_ThreadCancelled(), such as writing a
+// savegame, always finish, even when quitting.
+//
+struct thread_s
+{
+    SDL_Thread          *thread;
+    threadfunc_t        func;
+    void                *data;
+    SDL_atomic_t        done;
+    SDL_atomic_t        cancelled;
+    struct thread_s     *next;
+};
+
+static thread_t         *threads;
+
+static int SDLCALL I_BackgroundThread(void *data)
+{
+    thread_t    *thread = data;
+    int         result = thread->func(thread, thread->data);
+
+    SDL_AtomicSet(&thread->done, 1);
+    return result;
+}
+
+//
+// I_StartThread
+// Starts func(thread, data) on a new thread. Returns NULL if the thread can't be created, in
+// which case the caller should do the work itself.
+//
+thread_t *I_StartThread(threadfunc_t func, const char *name, void *data)
+{
+    thread_t    *thread = calloc(1, sizeof(*thread));
+
+    if (!thread)
+        return NULL;
+
+    thread->func = func;
+    thread->data = data;
+
+    if (!(thread->thread = SDL_CreateThread(I_BackgroundThread, name, thread)))
+    {
+        free(thread);
+        return NULL;
+    }
+
+    thread->next = threads;
+    threads = thread;
+
+    return thread;
+}
+
+//
+// I_ThreadDone
+// Returns true once the thread's function has returned, and everything it wrote can be read.
+//
+dboolean I_ThreadDone(thread_t *thread)
+{
+    return !!SDL_AtomicGet(&thread->done);
+}
+
+//
+// I_ThreadCancelled
+// Called by the thread itself to check whether it should give up early.
+//
+dboolean I_ThreadCancelled(thread_t *thread)
+{
+    return !!SDL_AtomicGet(&thread->cancelled);
+}
+
+//
+// I_WaitThread
+// Waits for the thread to finish, after first asking it to stop if cancel is true, and returns
+// the value its function returned. The thread can't be used again afterwards.
+//
+int I_WaitThread(thread_t *thread, dboolean cancel)
+{
+    thread_t    **link = &threads;
+    int         result;
+
+    if (cancel)
+        SDL_AtomicSet(&thread->cancelled, 1);
+
+    SDL_WaitThread(thread->thread, &result);
+
+    while (*link != thread)
+        link = &(*link)->next;
+
+    *link = thread->next;
+    free(thread);
+
+    return result;
+}
+
+static void I_ShutdownThreads(void)
+{
+    while (threads)
+        I_WaitThread(threads, true);
+}
+
 //
 // I_Quit
 //
@@ -211,6 +467,9 @@ void I_Quit(dboolean shutdown)
 {
     if (shutdown)
     {
+        I_ShutdownThreads();
+        I_ShutdownWorkers();
+
         S_Shutdown();
 
         if (returntowidescreen)
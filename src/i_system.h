@@ -54,6 +54,19 @@ void I_Quit(dboolean shutdown);
 
 void I_Error(char *error, ...);
 
+typedef void (*jobfunc_t)(void *data, int job, int worker);
+
+int I_GetNumWorkers(void);
+void I_RunJobs(jobfunc_t func, void *data, int count);
+
+typedef struct thread_s thread_t;
+typedef int (*threadfunc_t)(thread_t *thread, void *data);
+
+thread_t *I_StartThread(threadfunc_t func, const char *name, void *data);
+dboolean I_ThreadDone(thread_t *thread);
+dboolean I_ThreadCancelled(thread_t *thread);
+int I_WaitThread(thread_t *thread, dboolean cancel);
+
 void I_PrintWindowsVersion(void);
 void I_PrintSystemInfo(void);
 
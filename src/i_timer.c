@@ -37,33 +37,107 @@
 */
 
 #include "doomdef.h"
+#include "i_timer.h"
 #include "SDL.h"
 
+// Spin rather than sleep for the last part of a wait, since SDL_Delay() may
+// oversleep by a millisecond or more on some platforms.
+#define SPINTIME        2000000
+
+static Uint64   basecounter;
+static Uint64   counterfreq;
+
 //
-// I_GetTime
-// returns time in 1/35th second tics
+// I_GetTimeNS
+// Returns the number of nanoseconds since the timer was initialized.
 //
+uint64_t I_GetTimeNS(void)
+{
+    Uint64  counter;
+
+    if (!counterfreq)
+    {
+        counterfreq = SDL_GetPerformanceFrequency();
+        basecounter = SDL_GetPerformanceCounter();
+    }
+
+    counter = SDL_GetPerformanceCounter() - basecounter;
+
+    return (counter / counterfreq * 1000000000 + counter % counterfreq * 1000000000 / counterfreq);
+}
+
 int I_GetTime(void)
 {
-    return SDL_GetTicks() * TICRATE / 1000;
+    return (int)(I_GetTimeNS() * TICRATE / 1000000000);
 }
 
-//
-// Same as I_GetTime, but returns time in milliseconds
-//
 int I_GetTimeMS(void)
 {
-    return SDL_GetTicks();
+    return (int)(I_GetTimeNS() / 1000000);
 }
 
 //
-// Sleep for a specified number of ms
+// I_GetFracTic
+// Returns how far into the current tic we are, as a fixed_t.
 //
+fixed_t I_GetFracTic(void)
+{
+    return (fixed_t)(I_GetTimeNS() * TICRATE % 1000000000 * FRACUNIT / 1000000000);
+}
+
 void I_Sleep(int ms)
 {
     SDL_Delay(ms);
 }
 
+//
+// I_SleepUntil
+// Sleeps coarsely until shortly before the given time, and then spins for
+// the remainder so that the wait ends as close to it as possible.
+//
+static void I_SleepUntil(uint64_t time)
+{
+    uint64_t    now;
+
+    while ((now = I_GetTimeNS()) + SPINTIME < time)
+        SDL_Delay((Uint32)((time - now - SPINTIME) / 1000000 + 1));
+
+    while (I_GetTimeNS() < time);
+}
+
+//
+// I_WaitForTic
+// Waits until I_GetTime() would return tic.
+//
+void I_WaitForTic(int tic)
+{
+    I_SleepUntil(((uint64_t)tic * 1000000000 + TICRATE - 1) / TICRATE);
+}
+
+//
+// I_CapFramerate
+// Called once per frame. Waits so that frames are no closer together than
+// 1/fps seconds.
+//
+void I_CapFramerate(int fps)
+{
+    static uint64_t nextframe;
+    static int      oldfps;
+    uint64_t        frametime = 1000000000 / fps;
+    uint64_t        now = I_GetTimeNS();
+
+    // resync if the target has changed or we have fallen more than a frame behind
+    if (fps != oldfps || now > nextframe + frametime)
+    {
+        oldfps = fps;
+        nextframe = now;
+    }
+    else
+        I_SleepUntil(nextframe);
+
+    nextframe += frametime;
+}
+
 void I_InitTimer(void)
 {
     // initialize timer
@@ -39,6 +39,12 @@
 #if !defined(__I_TIMER_H__)
 #define __I_TIMER_H__
 
+#include "doomtype.h"
+#include "m_fixed.h"
+
+// returns current time in ns
+uint64_t I_GetTimeNS(void);
+
 // Called by D_DoomLoop,
 // returns current time in tics.
 int I_GetTime(void);
@@ -46,9 +52,18 @@ int I_GetTime(void);
 // returns current time in ms
 int I_GetTimeMS(void);
 
+// returns the fraction of the current tic that has elapsed
+fixed_t I_GetFracTic(void);
+
 // Pause for a specified number of ms
 void I_Sleep(int ms);
 
+// Pause until the specified tic
+void I_WaitForTic(int tic);
+
+// Pause to keep the framerate at or below fps
+void I_CapFramerate(int fps);
+
 // Initialize timer
 void I_InitTimer(void);
 
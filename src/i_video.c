@@ -76,6 +76,7 @@ int                     vid_display = vid_display_default;
 char                    *vid_driver = vid_driver_default;
 #endif
 dboolean                vid_fullscreen = vid_fullscreen_default;
+int                     vid_maxfps = vid_maxfps_default;
 dboolean                vid_motionblur = vid_motionblur_default;
 char                    *vid_scaleapi = vid_scaleapi_default;
 char                    *vid_scalefilter = vid_scalefilter_default;
@@ -99,6 +100,19 @@ static SDL_Palette      *palette;
 static SDL_Color        colors[256];
 static byte             *playpal;
 
+// 32-bit versions of every palette in PLAYPAL, built for each gamma level as it's used
+static Uint32           *playpal32[GAMMALEVELS];
+static int              playpallump;
+static int              numplaypals;
+static Uint32           custompal32[256];
+
+// The current palette, and whether the SDL palette needs updating to match it
+static Uint32           *pal32 = custompal32;
+static dboolean         palettechanged;
+static dboolean         motionblur;
+
+static void             (*presentfunc)(void);
+
 byte                    *mapscreen;
 SDL_Window              *mapwindow = NULL;
 static SDL_Renderer     *maprenderer;
@@ -327,6 +341,28 @@ dboolean keystate(int key)
     return keystate[TranslateKey2(key)];
 }
 
+//
+// UpdateColors
+// Updates the SDL palette from the current 32-bit palette. This is only
+// needed when SDL blits the frame rather than UpdateTexture() expanding it.
+//
+static void UpdateColors(void)
+{
+    int i;
+
+    for (i = 0; i < 256; ++i)
+    {
+        colors[i].r = (pal32[i] >> 16) & 0xFF;
+        colors[i].g = (pal32[i] >> 8) & 0xFF;
+        colors[i].b = pal32[i] & 0xFF;
+    }
+
+    if (SDL_SetPaletteColors(palette, colors, 0, 256) < 0)
+        I_SDLError("SDL_SetPaletteColors");
+
+    palettechanged = false;
+}
+
 static void FreeSurfaces(void)
 {
     SDL_FreePalette(palette);
@@ -538,7 +574,7 @@ static void I_GetEvent(void)
                             break;
 
                         case SDL_WINDOWEVENT_EXPOSED:
-                            SDL_SetPaletteColors(palette, colors, 0, 256);
+                            UpdateColors();
                             break;
 
                         case SDL_WINDOWEVENT_SIZE_CHANGED:
@@ -654,72 +690,59 @@ static void GetUpscaledTextureSize(int width, int height)
     upscaledheight = MIN(height / SCREENHEIGHT + !!(height % SCREENHEIGHT), MAXUPSCALEHEIGHT);
 }
 
-static void I_Blit(void)
-{
-    UpdateGrab();
-
-    SDL_LowerBlit(surface, &src_rect, buffer, &src_rect);
-    SDL_UpdateTexture(texture, &src_rect, buffer->pixels, SCREENWIDTH * 4);
-    SDL_RenderClear(renderer);
-    SDL_RenderCopy(renderer, texture, &src_rect, NULL);
-    SDL_RenderPresent(renderer);
-}
-
-static void I_Blit_NearestLinear(void)
+//
+// UpdateTexture
+// Expands screens[0] through the current palette directly into the
+// streaming texture. When motion blur is applied, the new frame has to be
+// blended with the previous one, so SDL blits it into buffer instead.
+//
+static void UpdateTexture(void)
 {
-    UpdateGrab();
-
-    SDL_LowerBlit(surface, &src_rect, buffer, &src_rect);
-    SDL_UpdateTexture(texture, &src_rect, buffer->pixels, SCREENWIDTH * 4);
-    SDL_RenderClear(renderer);
-    SDL_SetRenderTarget(renderer, texture_upscaled);
-    SDL_RenderCopy(renderer, texture, &src_rect, NULL);
-    SDL_SetRenderTarget(renderer, NULL);
-    SDL_RenderCopy(renderer, texture_upscaled, NULL, NULL);
-    SDL_RenderPresent(renderer);
-}
+    void    *pixels;
+    int     pitch;
+    byte    *src = screens[0];
+    int     y;
 
-static int      frames = -1;
-static Uint32   starttime;
-static Uint32   currenttime;
+    if (motionblur || SDL_LockTexture(texture, &src_rect, &pixels, &pitch) < 0)
+    {
+        if (palettechanged)
+            UpdateColors();
 
-static void I_Blit_ShowFPS(void)
-{
-    UpdateGrab();
+        SDL_LowerBlit(surface, &src_rect, buffer, &src_rect);
+        SDL_UpdateTexture(texture, &src_rect, buffer->pixels, SCREENWIDTH * 4);
+        return;
+    }
 
-    ++frames;
-    currenttime = SDL_GetTicks();
-    if (currenttime - starttime >= 1000)
+    for (y = 0; y < src_rect.h; ++y)
     {
-        fps = frames;
-        frames = 0;
-        starttime = currenttime;
+        Uint32      *dest = (Uint32 *)((byte *)pixels + y * pitch);
+        const byte  *end = src + SCREENWIDTH;
+
+        while (src < end)
+        {
+            dest[0] = pal32[src[0]];
+            dest[1] = pal32[src[1]];
+            dest[2] = pal32[src[2]];
+            dest[3] = pal32[src[3]];
+            dest += 4;
+            src += 4;
+        }
     }
-    C_UpdateFPS();
 
-    SDL_LowerBlit(surface, &src_rect, buffer, &src_rect);
-    SDL_UpdateTexture(texture, &src_rect, buffer->pixels, SCREENWIDTH * 4);
+    SDL_UnlockTexture(texture);
+}
+
+static void I_Present(void)
+{
+    UpdateTexture();
     SDL_RenderClear(renderer);
     SDL_RenderCopy(renderer, texture, &src_rect, NULL);
     SDL_RenderPresent(renderer);
 }
 
-static void I_Blit_NearestLinear_ShowFPS(void)
+static void I_Present_NearestLinear(void)
 {
-    UpdateGrab();
-
-    ++frames;
-    currenttime = SDL_GetTicks();
-    if (currenttime - starttime >= 1000)
-    {
-        fps = frames;
-        frames = 0;
-        starttime = currenttime;
-    }
-    C_UpdateFPS();
-
-    SDL_LowerBlit(surface, &src_rect, buffer, &src_rect);
-    SDL_UpdateTexture(texture, &src_rect, buffer->pixels, SCREENWIDTH * 4);
+    UpdateTexture();
     SDL_RenderClear(renderer);
     SDL_SetRenderTarget(renderer, texture_upscaled);
     SDL_RenderCopy(renderer, texture, &src_rect, NULL);
@@ -728,24 +751,18 @@ static void I_Blit_NearestLinear_ShowFPS(void)
     SDL_RenderPresent(renderer);
 }
 
-static void I_Blit_Shake(void)
+static void I_Present_Shake(void)
 {
-    UpdateGrab();
-
-    SDL_LowerBlit(surface, &src_rect, buffer, &src_rect);
-    SDL_UpdateTexture(texture, &src_rect, buffer->pixels, SCREENWIDTH * 4);
+    UpdateTexture();
     SDL_RenderClear(renderer);
     SDL_RenderCopyEx(renderer, texture, &src_rect, NULL,
         M_RandomInt(-1000, 1000) / 1000.0 * r_shakescreen / 100.0, NULL, SDL_FLIP_NONE);
     SDL_RenderPresent(renderer);
 }
 
-static void I_Blit_NearestLinear_Shake(void)
+static void I_Present_NearestLinear_Shake(void)
 {
-    UpdateGrab();
-
-    SDL_LowerBlit(surface, &src_rect, buffer, &src_rect);
-    SDL_UpdateTexture(texture, &src_rect, buffer->pixels, SCREENWIDTH * 4);
+    UpdateTexture();
     SDL_RenderClear(renderer);
     SDL_SetRenderTarget(renderer, texture_upscaled);
     SDL_RenderCopyEx(renderer, texture, &src_rect, NULL,
@@ -755,10 +772,12 @@ static void I_Blit_NearestLinear_Shake(void)
     SDL_RenderPresent(renderer);
 }
 
-static void I_Blit_ShowFPS_Shake(void)
-{
-    UpdateGrab();
+static int      frames = -1;
+static Uint32   starttime;
+static Uint32   currenttime;
 
+static void CountFPS(void)
+{
     ++frames;
     currenttime = SDL_GetTicks();
     if (currenttime - starttime >= 1000)
@@ -768,48 +787,29 @@ static void I_Blit_ShowFPS_Shake(void)
         starttime = currenttime;
     }
     C_UpdateFPS();
-
-    SDL_LowerBlit(surface, &src_rect, buffer, &src_rect);
-    SDL_UpdateTexture(texture, &src_rect, buffer->pixels, SCREENWIDTH * 4);
-    SDL_RenderClear(renderer);
-    SDL_RenderCopyEx(renderer, texture, &src_rect, NULL,
-        M_RandomInt(-1000, 1000) / 1000.0 * r_shakescreen / 100.0, NULL, SDL_FLIP_NONE);
-    SDL_RenderPresent(renderer);
 }
 
-static void I_Blit_NearestLinear_ShowFPS_Shake(void)
+static void I_Blit(void)
 {
     UpdateGrab();
+    presentfunc();
+}
 
-    ++frames;
-    currenttime = SDL_GetTicks();
-    if (currenttime - starttime >= 1000)
-    {
-        fps = frames;
-        frames = 0;
-        starttime = currenttime;
-    }
-    C_UpdateFPS();
-
-    SDL_LowerBlit(surface, &src_rect, buffer, &src_rect);
-    SDL_UpdateTexture(texture, &src_rect, buffer->pixels, SCREENWIDTH * 4);
-    SDL_RenderClear(renderer);
-    SDL_SetRenderTarget(renderer, texture_upscaled);
-    SDL_RenderCopyEx(renderer, texture, &src_rect, NULL,
-        M_RandomInt(-1000, 1000) / 1000.0 * r_shakescreen / 100.0, NULL, SDL_FLIP_NONE);
-    SDL_SetRenderTarget(renderer, NULL);
-    SDL_RenderCopy(renderer, texture_upscaled, NULL, NULL);
-    SDL_RenderPresent(renderer);
+static void I_Blit_ShowFPS(void)
+{
+    UpdateGrab();
+    CountFPS();
+    presentfunc();
 }
 
 void I_UpdateBlitFunc(dboolean shake)
 {
     if (shake)
-        blitfunc = (vid_showfps ? (nearestlinear ? I_Blit_NearestLinear_ShowFPS_Shake :
-            I_Blit_ShowFPS_Shake) : (nearestlinear ? I_Blit_NearestLinear_Shake  : I_Blit_Shake));
+        presentfunc = (nearestlinear ? I_Present_NearestLinear_Shake : I_Present_Shake);
     else
-        blitfunc = (vid_showfps ? (nearestlinear ? I_Blit_NearestLinear_ShowFPS : I_Blit_ShowFPS) :
-            (nearestlinear ? I_Blit_NearestLinear : I_Blit));
+        presentfunc = (nearestlinear ? I_Present_NearestLinear : I_Present);
+
+    blitfunc = (vid_showfps ? I_Blit_ShowFPS : I_Blit);
 }
 
 void I_Blit_Automap(void)
@@ -834,19 +834,47 @@ void I_ReadScreen(byte *screen)
 //
 // I_SetPalette
 //
+static void BuildPal32(byte *playpal, Uint32 *dest, int count)
+{
+    byte    *gamma = gammatable[gammaindex];
+
+    count *= 256;
+
+    while (count--)
+    {
+        *dest++ = (0xFF000000 | (gamma[playpal[0]] << 16) | (gamma[playpal[1]] << 8)
+            | gamma[playpal[2]]);
+        playpal += 3;
+    }
+}
+
+//
+// I_SetPalette
+// Palettes in the PLAYPAL lump are only converted once for each gamma
+// level, so changing between them just changes pal32.
+//
 void I_SetPalette(byte *playpal)
 {
-    int i;
+    byte    *playpalbase = W_CacheLumpNum(playpallump, PU_CACHE);
 
-    for (i = 0; i < 256; ++i)
+    if (playpal >= playpalbase && playpal < playpalbase + numplaypals * 768
+        && !((playpal - playpalbase) % 768))
+    {
+        if (!playpal32[gammaindex])
+        {
+            playpal32[gammaindex] = Z_Malloc(numplaypals * 256 * sizeof(Uint32), PU_STATIC, NULL);
+            BuildPal32(playpalbase, playpal32[gammaindex], numplaypals);
+        }
+
+        pal32 = playpal32[gammaindex] + (playpal - playpalbase) / 768 * 256;
+    }
+    else
     {
-        colors[i].r = gammatable[gammaindex][*playpal++];
-        colors[i].g = gammatable[gammaindex][*playpal++];
-        colors[i].b = gammatable[gammaindex][*playpal++];
+        BuildPal32(playpal, custompal32, 1);
+        pal32 = custompal32;
     }
 
-    if (SDL_SetPaletteColors(palette, colors, 0, 256) < 0)
-        I_SDLError("SDL_SetPaletteColors");
+    palettechanged = true;
 }
 
 static void I_RestoreFocus(void)
@@ -932,6 +960,7 @@ void I_CreateExternalAutomap(dboolean output)
         I_SDLError("SDL_AllocPalette");
     if (SDL_SetSurfacePalette(mapsurface, mappalette) < 0)
         I_SDLError("SDL_SetSurfacePalette");
+    UpdateColors();
     if (SDL_SetPaletteColors(mappalette, colors, 0, 256) < 0)
         I_SDLError("SDL_SetPaletteColors");
 
@@ -1162,6 +1191,14 @@ static void PositionOnCurrentDisplay(void)
 
 void I_SetMotionBlur(int percent)
 {
+    // buffer isn't kept up to date while there is no motion blur, so seed it with the last frame
+    if (percent && !motionblur)
+    {
+        SDL_SetSurfaceBlendMode(surface, SDL_BLENDMODE_NONE);
+        SDL_LowerBlit(surface, &src_rect, buffer, &src_rect);
+    }
+
+    motionblur = !!percent;
     SDL_SetSurfaceAlphaMod(surface, SDL_ALPHA_OPAQUE - 128 * percent / 100);
     SDL_SetSurfaceBlendMode(surface, (percent ? SDL_BLENDMODE_BLEND : SDL_BLENDMODE_NONE));
 }
@@ -1397,7 +1434,10 @@ static void SetVideoMode(dboolean output)
                         C_Warning("Vertical sync can't be enabled.");
                 }
 
-                C_Output("The framerate is uncapped.");
+                if (vid_maxfps)
+                    C_Output("The framerate is capped at %i FPS.", vid_maxfps);
+                else
+                    C_Output("The framerate is uncapped.");
             }
         }
     }
@@ -1463,6 +1503,8 @@ static void SetVideoMode(dboolean output)
 
     src_rect.w = SCREENWIDTH;
     src_rect.h = SCREENHEIGHT - SBARHEIGHT * vid_widescreen;
+
+    I_UpdateBlitFunc(false);
 }
 
 void I_ToggleWidescreen(dboolean toggle)
@@ -1495,8 +1537,7 @@ void I_ToggleWidescreen(dboolean toggle)
 
     returntowidescreen = false;
 
-    if (SDL_SetPaletteColors(palette, colors, 0, 256) < 0)
-        I_SDLError("SDL_SetPaletteColors");
+    UpdateColors();
 }
 
 #if defined(WIN32)
@@ -1639,7 +1680,9 @@ void I_InitGraphics(void)
     keys['a'] = keys['A'] = false;
     keys['l'] = keys['L'] = false;
 
-    playpal = W_CacheLumpName("PLAYPAL", PU_CACHE);
+    playpallump = W_GetNumForName("PLAYPAL");
+    numplaypals = MAX(1, W_LumpLength(playpallump) / 768);
+    playpal = W_CacheLumpNum(playpallump, PU_CACHE);
     I_InitTintTables(playpal);
     FindNearestColors(playpal);
 
@@ -1676,7 +1719,6 @@ void I_InitGraphics(void)
 
     SDL_SetWindowTitle(window, PACKAGE_NAME);
 
-    blitfunc = (nearestlinear ? I_Blit_NearestLinear : I_Blit);
     blitfunc();
 
     while (SDL_PollEvent(&dummy));
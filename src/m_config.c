@@ -68,6 +68,7 @@ extern int              am_thingcolor;
 extern int              am_tswallcolor;
 extern int              am_wallcolor;
 extern dboolean         autoload;
+extern dboolean         buildreject;
 extern dboolean         centerweapon;
 extern dboolean         con_obituaries;
 extern dboolean         con_timestamps;
@@ -81,6 +82,7 @@ extern dboolean         gp_swapthumbsticks;
 extern int              gp_vibrate_damage;
 extern int              gp_vibrate_weapons;
 extern char             *iwadfolder;
+extern dboolean         levelcache;
 extern dboolean         messages;
 extern float            m_acceleration;
 extern dboolean         m_doubleclick_use;
@@ -102,6 +104,7 @@ extern dboolean         r_corpses_slide;
 extern dboolean         r_corpses_smearblood;
 extern int              r_detail;
 extern dboolean         r_diskicon;
+extern int              r_dynamicresolution;
 extern dboolean         r_fixmaperrors;
 extern dboolean         r_fixspriteoffsets;
 extern dboolean         r_floatbob;
@@ -116,11 +119,15 @@ extern dboolean         r_liquid_swirl;
 extern char             *r_lowpixelsize;
 extern dboolean         r_mirroredweapons;
 extern dboolean         r_playersprites;
+extern int              r_renderscale;
 extern dboolean         r_rockettrails;
 extern dboolean         r_shadows;
 extern int              r_shakescreen;
 extern dboolean         r_translucency;
+extern int              rewind_interval;
+extern int              rewind_memory;
 extern int              s_musicvolume;
+extern dboolean         s_precachesfx;
 extern dboolean         s_randommusic;
 extern dboolean         s_randompitch;
 extern int              s_sfxvolume;
@@ -165,6 +172,7 @@ extern unsigned int     stat_shotsfired;
 extern unsigned int     stat_shotshit;
 extern unsigned int     stat_time;
 extern int              units;
+extern dboolean         threadedai;
 extern int              timelimit;
 extern int              turbo;
 extern char             *version;
@@ -174,6 +182,7 @@ extern int              vid_display;
 extern char             *vid_driver;
 #endif
 extern dboolean         vid_fullscreen;
+extern int              vid_maxfps;
 extern dboolean         vid_motionblur;
 extern char             *vid_scaleapi;
 extern char             *vid_scalefilter;
@@ -230,6 +239,7 @@ static default_t cvars[] =
     CONFIG_VARIABLE_INT          (am_tswallcolor,                                    NOALIAS    ),
     CONFIG_VARIABLE_INT          (am_wallcolor,                                      NOALIAS    ),
     CONFIG_VARIABLE_INT          (autoload,                                          BOOLALIAS  ),
+    CONFIG_VARIABLE_INT          (buildreject,                                       BOOLALIAS  ),
     CONFIG_VARIABLE_INT          (centerweapon,                                      BOOLALIAS  ),
     CONFIG_VARIABLE_INT          (con_obituaries,                                    BOOLALIAS  ),
     CONFIG_VARIABLE_INT          (con_timestamps,                                    BOOLALIAS  ),
@@ -243,6 +253,7 @@ static default_t cvars[] =
     CONFIG_VARIABLE_INT_PERCENT  (gp_vibrate_damage,                                 NOALIAS    ),
     CONFIG_VARIABLE_INT_PERCENT  (gp_vibrate_weapons,                                NOALIAS    ),
     CONFIG_VARIABLE_STRING       (iwadfolder,                                        NOALIAS    ),
+    CONFIG_VARIABLE_INT          (levelcache,                                        BOOLALIAS  ),
     CONFIG_VARIABLE_FLOAT        (m_acceleration,                                    NOALIAS    ),
     CONFIG_VARIABLE_INT          (m_doubleclick_use,                                 BOOLALIAS  ),
     CONFIG_VARIABLE_INT          (m_novertical,                                      BOOLALIAS  ),
@@ -264,6 +275,7 @@ static default_t cvars[] =
     CONFIG_VARIABLE_INT          (r_corpses_smearblood,                              BOOLALIAS  ),
     CONFIG_VARIABLE_INT          (r_detail,                                          DETAILALIAS),
     CONFIG_VARIABLE_INT          (r_diskicon,                                        BOOLALIAS  ),
+    CONFIG_VARIABLE_INT          (r_dynamicresolution,                               NOALIAS    ),
     CONFIG_VARIABLE_INT          (r_fixmaperrors,                                    BOOLALIAS  ),
     CONFIG_VARIABLE_INT          (r_fixspriteoffsets,                                BOOLALIAS  ),
     CONFIG_VARIABLE_INT          (r_floatbob,                                        BOOLALIAS  ),
@@ -278,12 +290,16 @@ static default_t cvars[] =
     CONFIG_VARIABLE_OTHER        (r_lowpixelsize,                                    NOALIAS    ),
     CONFIG_VARIABLE_INT          (r_mirroredweapons,                                 BOOLALIAS  ),
     CONFIG_VARIABLE_INT          (r_playersprites,                                   BOOLALIAS  ),
+    CONFIG_VARIABLE_INT_PERCENT  (r_renderscale,                                     NOALIAS    ),
     CONFIG_VARIABLE_INT          (r_rockettrails,                                    BOOLALIAS  ),
     CONFIG_VARIABLE_INT          (r_screensize,                                      NOALIAS    ),
     CONFIG_VARIABLE_INT          (r_shadows,                                         BOOLALIAS  ),
     CONFIG_VARIABLE_INT_PERCENT  (r_shakescreen,                                     NOALIAS    ),
     CONFIG_VARIABLE_INT          (r_translucency,                                    BOOLALIAS  ),
+    CONFIG_VARIABLE_INT          (rewind_interval,                                   NOALIAS    ),
+    CONFIG_VARIABLE_INT          (rewind_memory,                                     NOALIAS    ),
     CONFIG_VARIABLE_INT_PERCENT  (s_musicvolume,                                     NOALIAS    ),
+    CONFIG_VARIABLE_INT          (s_precachesfx,                                     BOOLALIAS  ),
     CONFIG_VARIABLE_INT          (s_randommusic,                                     BOOLALIAS  ),
     CONFIG_VARIABLE_INT          (s_randompitch,                                     BOOLALIAS  ),
     CONFIG_VARIABLE_INT_PERCENT  (s_sfxvolume,                                       NOALIAS    ),
@@ -291,6 +307,7 @@ static default_t cvars[] =
     CONFIG_VARIABLE_INT          (savegame,                                          NOALIAS    ),
     CONFIG_VARIABLE_INT          (skilllevel,                                        NOALIAS    ),
     CONFIG_VARIABLE_INT_PERCENT  (stillbob,                                          NOALIAS    ),
+    CONFIG_VARIABLE_INT          (threadedai,                                        BOOLALIAS  ),
     CONFIG_VARIABLE_INT          (timelimit,                                         NOALIAS    ),
     CONFIG_VARIABLE_INT_PERCENT  (turbo,                                             NOALIAS    ),
     CONFIG_VARIABLE_INT          (units,                                             UNITSALIAS ),
@@ -301,6 +318,7 @@ static default_t cvars[] =
     CONFIG_VARIABLE_STRING       (vid_driver,                                        NOALIAS    ),
 #endif
     CONFIG_VARIABLE_INT          (vid_fullscreen,                                    BOOLALIAS  ),
+    CONFIG_VARIABLE_INT          (vid_maxfps,                                        NOALIAS    ),
     CONFIG_VARIABLE_INT          (vid_motionblur,                                    BOOLALIAS  ),
     CONFIG_VARIABLE_STRING       (vid_scaleapi,                                      NOALIAS    ),
     CONFIG_VARIABLE_STRING       (vid_scalefilter,                                   NOALIAS    ),
@@ -649,6 +667,9 @@ static void M_CheckCVARs(void)
     if (autoload != false && autoload != true)
         autoload = autoload_default;
 
+    if (buildreject != false && buildreject != true)
+        buildreject = buildreject_default;
+
     if (centerweapon != false && centerweapon != true)
         centerweapon = centerweapon_default;
 
@@ -681,6 +702,9 @@ static void M_CheckCVARs(void)
 
     gp_vibrate_weapons = BETWEEN(gp_vibrate_weapons_min, gp_vibrate_damage, gp_vibrate_weapons_max);
 
+    if (levelcache != false && levelcache != true)
+        levelcache = levelcache_default;
+
     if (m_doubleclick_use != false && m_doubleclick_use != true)
         m_doubleclick_use = m_doubleclick_use_default;
 
@@ -735,6 +759,9 @@ static void M_CheckCVARs(void)
     if (r_diskicon != false && r_diskicon != true)
         r_diskicon = r_diskicon_default;
 
+    r_dynamicresolution = BETWEEN(r_dynamicresolution_min, r_dynamicresolution,
+        r_dynamicresolution_max);
+
     if (r_fixmaperrors != false && r_fixmaperrors != true)
         r_fixmaperrors = r_fixmaperrors_default;
 
@@ -774,6 +801,8 @@ static void M_CheckCVARs(void)
     if (r_playersprites != false && r_playersprites != true)
         r_playersprites = r_playersprites_default;
 
+    r_renderscale = BETWEEN(r_renderscale_min, r_renderscale, r_renderscale_max);
+
     if (r_rockettrails != false && r_rockettrails != true)
         r_rockettrails = r_rockettrails_default;
 
@@ -787,9 +816,16 @@ static void M_CheckCVARs(void)
     if (r_translucency != false && r_translucency != true)
         r_translucency = r_translucency_default;
 
+    rewind_interval = BETWEEN(rewind_interval_min, rewind_interval, rewind_interval_max);
+
+    rewind_memory = BETWEEN(rewind_memory_min, rewind_memory, rewind_memory_max);
+
     s_musicvolume = BETWEEN(s_musicvolume_min, s_musicvolume, s_musicvolume_max);
     musicVolume = (s_musicvolume * 15 + 50) / 100;
 
+    if (s_precachesfx != false && s_precachesfx != true)
+        s_precachesfx = s_precachesfx_default;
+
     if (s_randommusic != false && s_randommusic != true)
         s_randommusic = s_randommusic_default;
 
@@ -805,6 +841,9 @@ static void M_CheckCVARs(void)
 
     stillbob = BETWEEN(stillbob_min, stillbob, stillbob_max);
 
+    if (threadedai != false && threadedai != true)
+        threadedai = threadedai_default;
+
     timelimit = BETWEEN(timelimit_min, timelimit, timelimit_max);
 
     turbo = BETWEEN(turbo_min, turbo, turbo_max);
@@ -820,6 +859,8 @@ static void M_CheckCVARs(void)
     if (vid_fullscreen != false && vid_fullscreen != true)
         vid_fullscreen = vid_fullscreen_default;
 
+    vid_maxfps = BETWEEN(vid_maxfps_min, vid_maxfps, vid_maxfps_max);
+
     if (vid_motionblur != false && vid_motionblur != true)
         vid_motionblur = vid_motionblur_default;
 
@@ -140,6 +140,8 @@ typedef enum
 
 #define autoload_default                        true
 
+#define buildreject_default                     false
+
 #define centerweapon_default                    true
 
 #define con_obituaries_default                  true
@@ -186,6 +188,8 @@ typedef enum
 
 #define iwadfolder_default                      "C:\\"
 
+#define levelcache_default                      true
+
 #define messages_default                        false
 
 #define m_acceleration_min                      0
@@ -246,6 +250,10 @@ typedef enum
 
 #define r_diskicon_default                      true
 
+#define r_dynamicresolution_min                 0
+#define r_dynamicresolution_default             0
+#define r_dynamicresolution_max                 1000
+
 #define r_fixmaperrors_default                  true
 
 #define r_fixspriteoffsets_default              true
@@ -276,6 +284,10 @@ typedef enum
 
 #define r_playersprites_default                 true
 
+#define r_renderscale_min                       50
+#define r_renderscale_default                   100
+#define r_renderscale_max                       100
+
 #define r_rockettrails_default                  true
 
 #define r_screensize_min                        0
@@ -290,10 +302,20 @@ typedef enum
 
 #define r_translucency_default                  true
 
+#define rewind_interval_min                     1
+#define rewind_interval_default                 1
+#define rewind_interval_max                     60
+
+#define rewind_memory_min                       0
+#define rewind_memory_default                   0
+#define rewind_memory_max                       1024
+
 #define s_musicvolume_min                       0
 #define s_musicvolume_default                   100
 #define s_musicvolume_max                       100
 
+#define s_precachesfx_default                   true
+
 #define s_randommusic_default                   false
 
 #define s_randompitch_default                   false
@@ -316,6 +338,8 @@ typedef enum
 #define stillbob_default                        0
 #define stillbob_max                            100
 
+#define threadedai_default                      false
+
 #define turbo_min                               10
 #define turbo_default                           100
 #define turbo_max                               400
@@ -340,8 +364,13 @@ typedef enum
 
 #define vid_fullscreen_default                  true
 
+#define vid_maxfps_min                          0
+#define vid_maxfps_default                      0
+#define vid_maxfps_max                          1000
+
 #define vid_motionblur_default                  false
 
+
 #define vid_scaleapi_direct3d                   "direct3d"
 #define vid_scaleapi_opengl                     "opengl"
 #define vid_scaleapi_software                   "software"
@@ -414,6 +443,7 @@ typedef enum
 #define KEYLEFT_DEFAULT                         KEY_LEFTARROW
 #define KEYNEXTWEAPON_DEFAULT                   0
 #define KEYPREVWEAPON_DEFAULT                   0
+#define KEYREWIND_DEFAULT                       KEY_BACKSPACE
 #define KEYRIGHT_DEFAULT                        KEY_RIGHTARROW
 #define KEYRUN_DEFAULT                          KEY_SHIFT
 #if defined(WIN32)
@@ -58,6 +58,7 @@ int     keyboardleft = KEYLEFT_DEFAULT;
 int     keyboardmenu = KEY_ESCAPE;
 int     keyboardnextweapon = KEYNEXTWEAPON_DEFAULT;
 int     keyboardprevweapon = KEYPREVWEAPON_DEFAULT;
+int     keyboardrewind = KEYREWIND_DEFAULT;
 int     keyboardright = KEYRIGHT_DEFAULT;
 int     keyboardrun = KEYRUN_DEFAULT;
 int     keyboardscreenshot = KEYSCREENSHOT_DEFAULT;
@@ -59,6 +59,7 @@ extern int      keyboardleft;
 extern int      keyboardmenu;
 extern int      keyboardnextweapon;
 extern int      keyboardprevweapon;
+extern int      keyboardrewind;
 extern int      keyboardright;
 extern int      keyboardrun;
 extern int      keyboardscreenshot;
@@ -3229,7 +3229,7 @@ void M_Drawer(void)
         M_DarkBackground();
 
         if (vid_widescreen)
-            y = viewwindowy / 2 + (viewheight / 2 - M_StringHeight(messageString)) / 2 - 1;
+            y = viewwindowy / 2 + (scaledviewheight / 2 - M_StringHeight(messageString)) / 2 - 1;
         else
             y = (ORIGINALHEIGHT - M_StringHeight(messageString)) / 2 - 1;
         while (messageString[start] != '\0')
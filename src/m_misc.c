@@ -313,6 +313,35 @@ dboolean M_WriteFile(char *name, void *source, int length)
     return true;
 }
 
+//
+// M_WriteFileSafely
+// Writes to tempname first and then moves it over name, so name is either left as it was or
+// has all of source in it, even if the game crashes or the disk fills up part way through.
+//
+dboolean M_WriteFileSafely(char *name, char *tempname, void *source, size_t length)
+{
+    FILE        *handle = fopen(tempname, "wb");
+    dboolean    result;
+
+    if (!handle)
+        return false;
+
+    result = (fwrite(source, 1, length, handle) == length);
+    result = (!fclose(handle) && result);
+
+    if (!result)
+    {
+        remove(tempname);
+        return false;
+    }
+
+#if defined(WIN32)
+    return !!MoveFileExA(tempname, name, (MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH));
+#else
+    return !rename(tempname, name);
+#endif
+}
+
 // Return a newly-malloced string with all the strings given as arguments
 // concatenated together.
 char *M_StringJoin(char *s, ...)
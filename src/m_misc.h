@@ -49,6 +49,7 @@
 #include "doomtype.h"
 
 dboolean M_WriteFile(char *name, void *source, int length);
+dboolean M_WriteFileSafely(char *name, char *tempname, void *source, size_t length);
 void M_MakeDirectory(const char *dir);
 char *M_TempFile(char *s);
 dboolean M_FileExists(const char *file);
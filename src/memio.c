@@ -171,7 +171,7 @@ int mem_fseek(MEMFILE *stream, signed long position, mem_rel_t whence)
             return -1;
     }
 
-    if (newpos < stream->buflen)
+    if (newpos <= stream->buflen)
     {
         stream->position = newpos;
         return 0;
@@ -179,3 +179,215 @@ int mem_fseek(MEMFILE *stream, signed long position, mem_rel_t whence)
     else
         return -1;
 }
+
+long mem_ftell(MEMFILE *stream)
+{
+    return stream->position;
+}
+
+//
+// LZ compression
+// A small LZ77 compressor using the LZ4 block format: each sequence is a token byte holding
+// the number of literals and the match length, then the literals, then a 16-bit offset back
+// to the match. Neither function uses the zone memory allocator, so both are safe to call from
+// any thread.
+//
+#define LZ_MINMATCH     4
+#define LZ_HASHBITS     14
+#define LZ_MAXOFFSET    65535
+#define LZ_LASTLITERALS 5
+#define LZ_MFLIMIT      12
+
+static unsigned int lz_read32(const unsigned char *p)
+{
+    return (p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24));
+}
+
+static unsigned char *lz_write_length(unsigned char *op, size_t length)
+{
+    while (length >= 255)
+    {
+        *op++ = 255;
+        length -= 255;
+    }
+
+    *op++ = (unsigned char)length;
+    return op;
+}
+
+static unsigned char *lz_write_literals(unsigned char *op, unsigned char *token,
+    const unsigned char *literals, size_t length)
+{
+    *token = (unsigned char)((length < 15 ? length : 15) << 4);
+
+    if (length >= 15)
+        op = lz_write_length(op, length - 15);
+
+    memcpy(op, literals, length);
+    return (op + length);
+}
+
+// The most that compressing srclen bytes can produce
+size_t mem_compress_bound(size_t srclen)
+{
+    return (srclen + srclen / 255 + 16);
+}
+
+// Compress srclen bytes from src into dst, which must have room for at least
+// mem_compress_bound(srclen) bytes. Returns the compressed length, or 0 on failure.
+size_t mem_compress(const void *src, size_t srclen, void *dst, size_t dstlen)
+{
+    const unsigned char *base = src;
+    const unsigned char *ip = base;
+    const unsigned char *anchor = base;
+    const unsigned char *end = base + srclen;
+    unsigned char       *op = dst;
+    int                 *table;
+
+    if (dstlen < mem_compress_bound(srclen) || !(table = malloc((1 << LZ_HASHBITS) * sizeof(*table))))
+        return 0;
+
+    memset(table, 0xFF, (1 << LZ_HASHBITS) * sizeof(*table));
+
+    if (srclen > LZ_MFLIMIT)
+    {
+        const unsigned char *mflimit = end - LZ_MFLIMIT;
+        const unsigned char *matchlimit = end - LZ_LASTLITERALS;
+
+        while (ip < mflimit)
+        {
+            unsigned int        sequence = lz_read32(ip);
+            unsigned int        hash = (sequence * 2654435761u) >> (32 - LZ_HASHBITS);
+            int                 ref = table[hash];
+            const unsigned char *match;
+            unsigned char       *token;
+            size_t              length;
+            int                 offset;
+
+            table[hash] = (int)(ip - base);
+
+            if (ref < 0 || ip - (base + ref) > LZ_MAXOFFSET || lz_read32(base + ref) != sequence)
+            {
+                ip++;
+                continue;
+            }
+
+            match = base + ref;
+
+            while (ip > anchor && match > base && ip[-1] == match[-1])
+            {
+                ip--;
+                match--;
+            }
+
+            length = LZ_MINMATCH;
+
+            while (ip + length < matchlimit && ip[length] == match[length])
+                length++;
+
+            token = op++;
+            op = lz_write_literals(op, token, anchor, ip - anchor);
+
+            offset = (int)(ip - match);
+            *op++ = offset & 0xFF;
+            *op++ = (offset >> 8) & 0xFF;
+
+            length -= LZ_MINMATCH;
+            *token |= (length < 15 ? length : 15);
+
+            if (length >= 15)
+                op = lz_write_length(op, length - 15);
+
+            ip += length + LZ_MINMATCH;
+            anchor = ip;
+        }
+    }
+
+    // the rest is always literals
+    op = lz_write_literals(op + 1, op, anchor, end - anchor);
+
+    free(table);
+    return (op - (unsigned char *)dst);
+}
+
+// Decompress srclen bytes from src into dst, which has room for dstlen bytes. Returns the
+// decompressed length, or 0 if src is corrupt or dst is too small.
+size_t mem_decompress(const void *src, size_t srclen, void *dst, size_t dstlen)
+{
+    const unsigned char *ip = src;
+    const unsigned char *iend = ip + srclen;
+    unsigned char       *op = dst;
+    unsigned char       *oend = op + dstlen;
+
+    while (ip < iend)
+    {
+        unsigned int    token = *ip++;
+        size_t          length = token >> 4;
+        size_t          offset;
+
+        if (length == 15)
+        {
+            unsigned int    b;
+
+            do
+            {
+                if (ip >= iend)
+                    return 0;
+
+                b = *ip++;
+                length += b;
+            } while (b == 255);
+        }
+
+        if (length > (size_t)(iend - ip) || length > (size_t)(oend - op))
+            return 0;
+
+        memcpy(op, ip, length);
+        ip += length;
+        op += length;
+
+        // the last sequence has no match
+        if (ip == iend)
+            break;
+
+        if (iend - ip < 2)
+            return 0;
+
+        offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+
+        if (!offset || offset > (size_t)(op - (unsigned char *)dst))
+            return 0;
+
+        length = token & 15;
+
+        if (length == 15)
+        {
+            unsigned int    b;
+
+            do
+            {
+                if (ip >= iend)
+                    return 0;
+
+                b = *ip++;
+                length += b;
+            } while (b == 255);
+        }
+
+        length += LZ_MINMATCH;
+
+        if (length > (size_t)(oend - op))
+            return 0;
+
+        // the match may overlap what it is copying, so copy a byte at a time
+        {
+            const unsigned char *match = op - offset;
+
+            while (length--)
+                *op++ = *match++;
+        }
+    }
+
+    return (op - (unsigned char *)dst);
+}
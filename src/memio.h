@@ -57,5 +57,10 @@ size_t mem_fwrite(const void *ptr, size_t size, size_t nmemb, MEMFILE *stream);
 void mem_get_buf(MEMFILE *stream, void **buf, size_t *buflen);
 void mem_fclose(MEMFILE *stream);
 int mem_fseek(MEMFILE *stream, signed long offset, mem_rel_t whence);
+long mem_ftell(MEMFILE *stream);
+
+size_t mem_compress_bound(size_t srclen);
+size_t mem_compress(const void *src, size_t srclen, void *dst, size_t dstlen);
+size_t mem_decompress(const void *src, size_t srclen, void *dst, size_t dstlen);
 
 #endif
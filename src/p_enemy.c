@@ -41,6 +41,7 @@
 #include "c_console.h"
 #include "doomstat.h"
 #include "g_game.h"
+#include "i_system.h"
 #include "m_bbox.h"
 #include "m_misc.h"
 #include "m_random.h"
@@ -48,6 +49,7 @@
 #include "p_local.h"
 #include "p_tick.h"
 #include "s_sound.h"
+#include "z_zone.h"
 
 typedef enum
 {
@@ -90,6 +92,8 @@ extern dboolean con_obituaries;
 extern dboolean r_rockettrails;
 extern int      stat_monsterskilled;
 
+dboolean        threadedai = threadedai_default;
+
 //
 // ENEMY THINKING
 // Enemies are always spawned
@@ -99,44 +103,90 @@ extern int      stat_monsterskilled;
 //
 
 //
-// P_RecursiveSound
-// Called by P_NoiseAlert.
-// Recursively traverse adjacent sectors,
-// sound blocking lines cut off traversal.
+// SOUND PROPAGATION
+// [BH] Sound floods outwards from the sector it was made in through the graph of sectors
+// built by P_GroupLines(), a breadth-first search at a time. Sectors that can be reached
+// without crossing a sound blocking line are flooded first, and then those that can be
+// reached by crossing one. This wakes up the same monsters as the recursive flood it
+// replaces did, without the risk of overflowing the stack on large maps.
+//
+static sector_t         **soundqueue;
+static soundedge_t      **soundblocked;
+static int              soundqueuesize;
+static int              soundblockedsize;
+
 //
-// killough 5/5/98: reformatted, cleaned up
+// P_InitSoundQueue
+// Called by P_SetupLevel() once the sound graph of the current map has been built.
 //
-static void P_RecursiveSound(sector_t *sec, int soundblocks, mobj_t *soundtarget)
+void P_InitSoundQueue(void)
 {
     int i;
 
-    // wake up all monsters in this sector
-    if (sec->validcount == validcount && sec->soundtraversed <= soundblocks + 1)
-        return;         // already flooded
+    soundqueuesize = numsectors;
+    soundblockedsize = 0;
+
+    for (i = 0; i < numsectors; i++)
+        soundblockedsize += sectors[i].soundedgecount;
+
+    soundqueue = Z_Malloc(MAX(1, soundqueuesize) * sizeof(*soundqueue), PU_LEVEL, NULL);
+    soundblocked = Z_Malloc(MAX(1, soundblockedsize) * sizeof(*soundblocked), PU_LEVEL, NULL);
+}
+
+//
+// P_IsSoundEdgeOpen
+// Only check the opening of a line if the floor or ceiling of a sector on either side of it
+// has moved since the map was loaded.
+//
+static dboolean P_IsSoundEdgeOpen(const sector_t *sec, const soundedge_t *edge)
+{
+    if (!sec->moved && !sectors[edge->sector].moved)
+        return edge->open;
 
-    sec->validcount = validcount;
-    sec->soundtraversed = soundblocks + 1;
-    P_SetTarget(&sec->soundtarget, soundtarget);
+    P_LineOpening(edge->line);
+    return (openrange > 0);
+}
 
-    for (i = 0; i < sec->linecount; i++)
+//
+// P_FloodSound
+// Wake up all monsters in the sectors that can be reached from the sectors in the queue,
+// crossing no more sound blocking lines. Sound blocking lines that are crossed are added to
+// soundblocked.
+//
+static void P_FloodSound(int head, int tail, int soundblocks, int *numblocked, mobj_t *soundtarget)
+{
+    while (head < tail)
     {
-        sector_t        *other;
-        line_t          *check = sec->lines[i];
+        sector_t    *sec = soundqueue[head++];
+        int         i;
 
-        if (!(check->flags & ML_TWOSIDED))
-            continue;
+        for (i = 0; i < sec->soundedgecount; i++)
+        {
+            soundedge_t *edge = &sec->soundedges[i];
+            sector_t    *other;
+
+            if (edge->soundblock && soundblocks)
+                continue;
+
+            if (!P_IsSoundEdgeOpen(sec, edge))
+                continue;   // closed door
 
-        P_LineOpening(check);
+            if (edge->soundblock)
+            {
+                soundblocked[(*numblocked)++] = edge;
+                continue;
+            }
 
-        if (openrange <= 0)
-            continue;   // closed door
+            other = &sectors[edge->sector];
 
-        other = sides[check->sidenum[(sides[check->sidenum[0]].sector == sec)]].sector;
+            if (P_SectorVisited(&gamequery, other) && other->soundtraversed <= soundblocks + 1)
+                continue;   // already flooded
 
-        if (!(check->flags & ML_SOUNDBLOCK))
-            P_RecursiveSound(other, soundblocks, soundtarget);
-        else if (!soundblocks)
-            P_RecursiveSound(other, 1, soundtarget);
+            P_MarkSector(&gamequery, other);
+            other->soundtraversed = soundblocks + 1;
+            P_SetTarget(&other->soundtarget, soundtarget);
+            soundqueue[tail++] = other;
+        }
     }
 }
 
@@ -147,12 +197,38 @@ static void P_RecursiveSound(sector_t *sec, int soundblocks, mobj_t *soundtarget
 //
 void P_NoiseAlert(mobj_t *target, mobj_t *emmiter)
 {
+    sector_t    *sec = emmiter->subsector->sector;
+    int         numblocked = 0;
+    int         tail = 0;
+    int         i;
+
     // [BH] don't alert if notarget is enabled
     if (players[0].cheats & CF_NOTARGET)
         return;
 
-    ++validcount;
-    P_RecursiveSound(emmiter->subsector->sector, 0, target);
+    P_NewQuery(&gamequery);
+
+    P_MarkSector(&gamequery, sec);
+    sec->soundtraversed = 1;
+    P_SetTarget(&sec->soundtarget, target);
+    soundqueue[0] = sec;
+    P_FloodSound(0, 1, 0, &numblocked, target);
+
+    // flood again from the other side of each sound blocking line that was crossed
+    for (i = 0; i < numblocked; i++)
+    {
+        sector_t    *other = &sectors[soundblocked[i]->sector];
+
+        if (P_SectorVisited(&gamequery, other))
+            continue;   // already flooded
+
+        P_MarkSector(&gamequery, other);
+        other->soundtraversed = 2;
+        P_SetTarget(&other->soundtarget, target);
+        soundqueue[tail++] = other;
+    }
+
+    P_FloodSound(0, tail, 1, &numblocked, target);
 }
 
 //
@@ -683,10 +759,10 @@ static fixed_t P_AvoidDropoff(mobj_t *actor)
     dropoff_deltax = dropoff_deltay = 0;
 
     // check lines
-    ++validcount;
+    P_NewQuery(&gamequery);
     for (bx = xl; bx <= xh; ++bx)
         for (by = yl; by <= yh; ++by)
-            P_BlockLinesIterator(bx, by, PIT_AvoidDropoff);     // all contacted lines
+            P_BlockLinesIterator(&gamequery, bx, by, PIT_AvoidDropoff);     // all contacted lines
 
     return (dropoff_deltax | dropoff_deltay);                   // Non-zero if movement prescribed
 }
@@ -941,9 +1017,6 @@ void A_Chase(mobj_t *actor, player_t *player, pspdef_t *psp)
             actor->angle += ANG90 / 2;
     }
 
-    if (actor->shadow)
-        actor->shadow->angle = actor->angle;
-
     if (!actor->target || !(actor->target->flags & MF_SHOOTABLE))
     {
         // look for a new target
@@ -999,6 +1072,128 @@ nomissile:
         S_StartSound(actor, actor->info->activesound);
 }
 
+//
+// MONSTER SENSING
+// [BH] When threadedai is on, the lines of sight that monsters are about to check in A_Look()
+// and A_Chase() are traced in parallel before their thinkers run, and the results stored in
+// the sight cache. Nothing moves while they are traced, and the sight cache is keyed on the
+// positions of both mobjs, so a monster that has moved by the time it checks will just trace
+// its line of sight again. Either way, the result is the same as if threadedai was off.
+//
+typedef struct
+{
+    mobj_t              *t1;
+    mobj_t              *t2;
+    dboolean            result;
+} sensejob_t;
+
+static sensejob_t       *sensejobs;
+static int              numsensejobs;
+static int              maxsensejobs;
+
+static querycontext_t   *sensequeries;
+
+//
+// P_InitSensing
+// Called by P_SetupLevel() once the query contexts of the previous map have been freed.
+//
+void P_InitSensing(void)
+{
+    sensequeries = NULL;
+}
+
+static void P_AddSenseJob(mobj_t *t1, mobj_t *t2)
+{
+    if (!t2 || !t2->subsector)
+        return;
+
+    if (numsensejobs == maxsensejobs)
+    {
+        maxsensejobs = (maxsensejobs ? maxsensejobs * 2 : 1024);
+        sensejobs = Z_Realloc(sensejobs, maxsensejobs * sizeof(*sensejobs));
+    }
+
+    sensejobs[numsensejobs].t1 = t1;
+    sensejobs[numsensejobs++].t2 = t2;
+}
+
+static void P_SenseJob(void *data, int job, int worker)
+{
+    sensejob_t  *sensejob = (sensejob_t *)data + job;
+
+    sensejob->result = P_TraceSight(&sensequeries[worker], sensejob->t1, sensejob->t2);
+}
+
+//
+// P_SenseMonsters
+// Traces the lines of sight of the monsters from start up to but not including end in the
+// mobj thinker class list that will call A_Look() or A_Chase() when they next think.
+//
+void P_SenseMonsters(thinker_t *start, thinker_t *end)
+{
+    player_t    *player = &players[0];
+    dboolean    targetplayer = (player->mo && player->health > 0 && !(player->cheats & CF_NOTARGET)
+                    && !infight);
+    thinker_t   *th;
+    int         i;
+
+    if (!threadedai || I_GetNumWorkers() == 1)
+        return;
+
+    numsensejobs = 0;
+
+    for (th = start; th != end && th != &thinkerclasscap[th_mobj]; th = th->cnext)
+    {
+        mobj_t      *mo = (mobj_t *)th;
+        actionf_t   action;
+        mobj_t      *target;
+
+        if (th->function != P_MobjThinker || mo->tics != 1 || !mo->subsector || mo->player)
+            continue;
+
+        action = states[mo->state->nextstate].action;
+        target = mo->target;
+
+        if (action == A_Chase)
+        {
+            if (target && (target->flags & MF_SHOOTABLE))
+            {
+                P_AddSenseJob(mo, target);
+                continue;
+            }
+        }
+        else if (action == A_Look)
+        {
+            if ((target = mo->subsector->sector->soundtarget) && (target->flags & MF_SHOOTABLE)
+                && (mo->flags & MF_AMBUSH))
+                P_AddSenseJob(mo, target);
+        }
+        else
+            continue;
+
+        if (targetplayer)
+            P_AddSenseJob(mo, player->mo);
+    }
+
+    if (numsensejobs < 2)
+        return;
+
+    if (!sensequeries)
+    {
+        int numworkers = I_GetNumWorkers();
+
+        sensequeries = Z_Malloc(numworkers * sizeof(*sensequeries), PU_LEVEL, NULL);
+
+        for (i = 0; i < numworkers; i++)
+            P_InitQueryContext(&sensequeries[i]);
+    }
+
+    I_RunJobs(P_SenseJob, sensejobs, numsensejobs);
+
+    for (i = 0; i < numsensejobs; i++)
+        P_CacheSight(sensejobs[i].t1, sensejobs[i].t2, sensejobs[i].result);
+}
+
 //
 // A_FaceTarget
 //
@@ -1012,10 +1207,6 @@ void A_FaceTarget(mobj_t *actor, player_t *player, pspdef_t *psp)
 
     if (actor->target->flags & MF_FUZZ)
         actor->angle += (M_Random() - M_Random()) << 21;
-
-    // [BH] update shadow angle
-    if (actor->shadow)
-        actor->shadow->angle = actor->angle;
 }
 
 //
@@ -1043,9 +1234,13 @@ void A_SPosAttack(mobj_t *actor, player_t *player, pspdef_t *psp)
     A_FaceTarget(actor, NULL, NULL);
 
     S_StartSound(actor, sfx_shotgn);
+    P_BeginHitscanBatch(actor, actor->angle, 255 << 20, MISSILERANGE);
+
     for (i = 0; i < 3; i++)
         P_LineAttack(actor, actor->angle + ((M_Random() - M_Random()) << 20), MISSILERANGE,
             P_AimLineAttack(actor, actor->angle, MISSILERANGE), ((M_Random() % 5) + 1) * 3);
+
+    P_EndHitscanBatch();
 }
 
 void A_CPosAttack(mobj_t *actor, player_t *player, pspdef_t *psp)
@@ -1202,6 +1397,7 @@ void A_SkelMissile(mobj_t *actor, player_t *player, pspdef_t *psp)
 
     mo->x += mo->momx;
     mo->y += mo->momy;
+    P_UpdateBlockThing(mo);
     P_SetTarget(&mo->tracer, actor->target);
 }
 
@@ -1382,10 +1578,9 @@ void A_VileChase(mobj_t *actor, player_t *player, pspdef_t *psp)
                     // [BH] fix potential of corpse being resurrected as a "ghost"
                     corpsehit->height = info->height;
                     corpsehit->radius = info->radius;
+                    P_UpdateBlockThing(corpsehit);
                     corpsehit->flags = info->flags;
                     corpsehit->flags2 = info->flags2;
-                    if (corpsehit->shadow)
-                        corpsehit->shadow->flags2 &= ~MF2_MIRRORED;
                     corpsehit->health = info->spawnhealth;
                     P_SetTarget(&corpsehit->target, NULL);
                     P_SetTarget(&corpsehit->lastenemy, NULL);
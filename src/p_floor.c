@@ -60,6 +60,15 @@ result_e T_MovePlane(sector_t *sector, fixed_t speed, fixed_t dest, dboolean cru
 
     sector->oldgametic = gametic;
 
+    // [BH] lines of sight through this sector may change
+    P_ClearSightCache();
+
+    // [BH] and so may the openings that sound travels through
+    sector->moved = true;
+
+    // [BH] and the heights surrounding the adjacent sectors
+    P_InvalidateNeighborHeights(sector);
+
     switch (floorOrCeiling)
     {
         case 0:
@@ -1161,8 +1161,6 @@ void P_KillMobj(mobj_t *target, mobj_t *inflicter, mobj_t *source)
             {
                 prev--;
                 target->flags2 |= MF2_MIRRORED;
-                if (target->shadow)
-                    target->shadow->flags2 |= MF2_MIRRORED;
             }
             else
                 prev++;
@@ -1219,8 +1217,8 @@ void P_KillMobj(mobj_t *target, mobj_t *inflicter, mobj_t *source)
 
     target->tics = MAX(1, target->tics - (M_Random() & 3));
 
-    if ((type == MT_BARREL || type == MT_PAIN || type == MT_SKULL) && target->shadow)
-        P_RemoveMobjShadow(target);
+    if (type == MT_BARREL || type == MT_PAIN || type == MT_SKULL)
+        target->flags2 &= ~MF2_SHADOW;
 
     if (chex)
         return;
@@ -1278,11 +1276,7 @@ void P_KillMobj(mobj_t *target, mobj_t *inflicter, mobj_t *source)
     mo->angle = target->angle + ((M_Random() - M_Random()) << 20);
     mo->flags |= MF_DROPPED;    // special versions of items
     if (r_mirroredweapons && (rand() & 1))
-    {
         mo->flags2 |= MF2_MIRRORED;
-        if (mo->shadow)
-            mo->shadow->flags2 |= MF2_MIRRORED;
-    }
 }
 
 dboolean P_CheckMeleeRange(mobj_t *actor);
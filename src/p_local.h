@@ -135,17 +135,25 @@ void P_RespawnSpecials(void);
 
 void P_InitCards(player_t *player);
 
+void P_InitMobjPool(void);
+mobj_t *P_AllocMobj(void);
+void P_FreeMobj(mobj_t *mobj);
+unsigned int P_MobjGeneration(mobj_t *mobj);
+
 mobj_t *P_SpawnMobj(fixed_t x, fixed_t y, fixed_t z, mobjtype_t type);
 mobjtype_t P_FindDoomedNum(unsigned int type);
 
 void P_RemoveMobj(mobj_t *th);
-void P_RemoveMobjShadow(mobj_t *th);
 dboolean P_SetMobjState(mobj_t *mobj, statenum_t state);
 void P_MobjThinker(mobj_t *mobj);
 
 void P_SpawnPuff(fixed_t x, fixed_t y, fixed_t z, angle_t angle);
 void P_SpawnSmokeTrail(fixed_t x, fixed_t y, fixed_t z, angle_t angle);
 void P_SpawnBlood(fixed_t x, fixed_t y, fixed_t z, angle_t angle, int damage, mobj_t *target);
+void P_InitBloodSplats(void);
+void P_AddBloodSplat(sector_t *sec, fixed_t x, fixed_t y, int blood, int frame);
+void P_RemoveBloodSplats(sector_t *sec);
+void P_ResizeBloodSplats(void);
 void P_SpawnBloodSplat(fixed_t x, fixed_t y, int blood, int maxheight, mobj_t *target);
 void P_NullBloodSplatSpawner(fixed_t x, fixed_t y, int blood, int maxheight, mobj_t *target);
 mobj_t *P_SpawnMissile(mobj_t *source, mobj_t *dest, mobjtype_t type);
@@ -155,11 +163,34 @@ void P_InitExtraMobjs(void);
 //
 // P_ENEMY
 //
+extern dboolean         threadedai;
+
+void P_InitSoundQueue(void);
 void P_NoiseAlert(mobj_t *target, mobj_t *emmiter);
+void P_InitSensing(void);
+void P_SenseMonsters(thinker_t *start, thinker_t *end);
 
 //
 // P_MAPUTL
 //
+extern querycontext_t   gamequery;
+extern querycontext_t   renderquery;
+
+void P_InitQueryContext(querycontext_t *query);
+void P_NewQuery(querycontext_t *query);
+
+void P_InitBlockThings(void);
+void P_UpdateBlockThing(mobj_t *thing);
+
+void P_InitHitscanBatches(void);
+void P_BeginHitscanBatch(mobj_t *t1, angle_t angle, angle_t spread, fixed_t distance);
+void P_EndHitscanBatch(void);
+
+#define P_LineVisited(query, line)      ((query)->linestamps[(line) - lines] == (query)->stamp)
+#define P_MarkLine(query, line)         ((query)->linestamps[(line) - lines] = (query)->stamp)
+#define P_SectorVisited(query, sec)     ((query)->sectorstamps[(sec) - sectors] == (query)->stamp)
+#define P_MarkSector(query, sec)        ((query)->sectorstamps[(sec) - sectors] = (query)->stamp)
+
 typedef struct
 {
     fixed_t     x;
@@ -193,20 +224,20 @@ extern fixed_t          lowfloor;
 
 void P_LineOpening(line_t *linedef);
 
-dboolean P_BlockLinesIterator(int x, int y, dboolean func(line_t *));
+dboolean P_BlockLinesIterator(querycontext_t *query, int x, int y, dboolean func(line_t *));
 dboolean P_BlockThingsIterator(int x, int y, dboolean func(mobj_t *));
+dboolean P_BlockThingsIteratorBox(int x, int y, const fixed_t *bbox, dboolean func(mobj_t *));
 
 #define PT_ADDLINES     1
 #define PT_ADDTHINGS    2
 
 extern divline_t        dlTrace;
 
-dboolean P_PathTraverse(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2, int flags,
-    dboolean (*trav)(intercept_t *));
+dboolean P_PathTraverse(querycontext_t *query, fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
+    int flags, dboolean (*trav)(intercept_t *));
 
 void P_UnsetThingPosition(mobj_t *thing);
 void P_SetThingPosition(mobj_t *thing);
-void P_SetBloodSplatPosition(mobj_t *splat);
 
 //
 // P_MAP
@@ -233,6 +264,9 @@ dboolean P_CheckLineSide(mobj_t *actor, fixed_t x, fixed_t y);
 dboolean P_TeleportMove(mobj_t *thing, fixed_t x, fixed_t y, fixed_t z, dboolean boss);
 void P_SlideMove(mobj_t *mo);
 dboolean P_CheckSight(mobj_t *t1, mobj_t *t2);
+dboolean P_TraceSight(querycontext_t *query, mobj_t *t1, mobj_t *t2);
+void P_CacheSight(mobj_t *t1, mobj_t *t2, dboolean result);
+void P_ClearSightCache(void);
 void P_UseLines(player_t *player);
 
 dboolean P_ChangeSector(sector_t *sector, dboolean crunch);
@@ -240,6 +274,9 @@ void P_FreeSecNodeList(void);
 
 extern mobj_t           *linetarget;    // who got hit (or NULL)
 
+extern int64_t          sightchecks;
+extern int64_t          sightcachehits;
+
 fixed_t P_AimLineAttack(mobj_t *t1, angle_t angle, fixed_t distance);
 
 void P_LineAttack(mobj_t *t1, angle_t angle, fixed_t distance, fixed_t slope, int damage);
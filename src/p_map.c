@@ -247,7 +247,7 @@ dboolean P_TeleportMove(mobj_t *thing, fixed_t x, fixed_t y, fixed_t z, dboolean
     tmfloorz = tmdropoffz = newsec->floorheight;
     tmceilingz = newsec->ceilingheight;
 
-    ++validcount;
+    P_NewQuery(&gamequery);
     numspechit = 0;
 
     // stomp on any things contacted
@@ -283,17 +283,6 @@ dboolean P_TeleportMove(mobj_t *thing, fixed_t x, fixed_t y, fixed_t z, dboolean
     else
         thing->flags2 &= ~MF2_FEETARECLIPPED;
 
-    // [BH] update shadow position as well
-    if (thing->shadow)
-    {
-        P_UnsetThingPosition(thing->shadow);
-
-        thing->shadow->x = thing->x;
-        thing->shadow->y = thing->y;
-
-        P_SetThingPosition(thing->shadow);
-    }
-
     return true;
 }
 
@@ -626,10 +615,10 @@ dboolean P_CheckLineSide(mobj_t *actor, fixed_t x, fixed_t y)
     yl = (tmbbox[BOXBOTTOM] - bmaporgy) >> MAPBLOCKSHIFT;
     yh = (tmbbox[BOXTOP] - bmaporgy) >> MAPBLOCKSHIFT;
 
-    validcount++;               // prevents checking same line twice
+    P_NewQuery(&gamequery);    // prevents checking same line twice
     for (bx = xl; bx <= xh; bx++)
         for (by = yl; by <= yh; by++)
-            if (!P_BlockLinesIterator(bx, by, PIT_CrossLine))
+            if (!P_BlockLinesIterator(&gamequery, bx, by, PIT_CrossLine))
                 return true;
     return false;
 }
@@ -704,6 +693,7 @@ dboolean P_CheckPosition(mobj_t *thing, fixed_t x, fixed_t y)
     int         by;
     subsector_t *newsubsec;
     fixed_t     radius = thing->radius;
+    fixed_t     thingbbox[4];
 
     tmthing = thing;
 
@@ -729,7 +719,7 @@ dboolean P_CheckPosition(mobj_t *thing, fixed_t x, fixed_t y)
     tmfloorz = tmdropoffz = newsubsec->sector->floorheight;
     tmceilingz = newsubsec->sector->ceilingheight;
 
-    ++validcount;
+    P_NewQuery(&gamequery);
     numspechit = 0;
 
     if (tmthing->flags & MF_NOCLIP)
@@ -745,9 +735,16 @@ dboolean P_CheckPosition(mobj_t *thing, fixed_t x, fixed_t y)
     yl = (tmbbox[BOXBOTTOM] - bmaporgy - MAXRADIUS) >> MAPBLOCKSHIFT;
     yh = (tmbbox[BOXTOP] - bmaporgy + MAXRADIUS) >> MAPBLOCKSHIFT;
 
+    // [BH] only check things that reach the new position, or that are close enough to the
+    // current position to be nudged by PIT_CheckThing()
+    thingbbox[BOXLEFT] = MIN(tmbbox[BOXLEFT], thing->x - 16 * FRACUNIT);
+    thingbbox[BOXRIGHT] = MAX(tmbbox[BOXRIGHT], thing->x + 16 * FRACUNIT);
+    thingbbox[BOXBOTTOM] = MIN(tmbbox[BOXBOTTOM], thing->y - 16 * FRACUNIT);
+    thingbbox[BOXTOP] = MAX(tmbbox[BOXTOP], thing->y + 16 * FRACUNIT);
+
     for (bx = xl; bx <= xh; ++bx)
         for (by = yl; by <= yh; ++by)
-            if (!P_BlockThingsIterator(bx, by, PIT_CheckThing))
+            if (!P_BlockThingsIteratorBox(bx, by, thingbbox, PIT_CheckThing))
                 return false;
 
     // check lines
@@ -766,7 +763,7 @@ dboolean P_CheckPosition(mobj_t *thing, fixed_t x, fixed_t y)
 
     for (bx = xl; bx <= xh; ++bx)
         for (by = yl; by <= yh; ++by)
-            if (!P_BlockLinesIterator(bx, by, PIT_CheckLine))
+            if (!P_BlockLinesIterator(&gamequery, bx, by, PIT_CheckLine))
                 return false;
 
     return true;
@@ -811,7 +808,7 @@ mobj_t *P_CheckOnmobj(mobj_t * thing)
     tmfloorz = tmdropoffz = newsubsec->sector->floorheight;
     tmceilingz = newsubsec->sector->ceilingheight;
 
-    ++validcount;
+    P_NewQuery(&gamequery);
     numspechit = 0;
 
     if (tmthing->flags & MF_NOCLIP)
@@ -993,17 +990,6 @@ dboolean P_TryMove(mobj_t *thing, fixed_t x, fixed_t y, dboolean dropoff)
                 P_CrossSpecialLine(ld, oldside, thing);
         }
 
-    // [BH] update shadow position as well
-    if (thing->shadow)
-    {
-        P_UnsetThingPosition(thing->shadow);
-
-        thing->shadow->x = thing->x;
-        thing->shadow->y = thing->y;
-
-        P_SetThingPosition(thing->shadow);
-    }
-
     return true;
 }
 
@@ -1106,11 +1092,11 @@ void P_ApplyTorque(mobj_t *mo)
     int flags2 = mo->flags2;    // Remember the current state, for gear-change
 
     tmthing = mo;
-    validcount++;               // prevents checking same line twice
+    P_NewQuery(&gamequery);    // prevents checking same line twice
 
     for (bx = xl; bx <= xh; bx++)
         for (by = yl; by <= yh; by++)
-            P_BlockLinesIterator(bx, by, PIT_ApplyTorque);
+            P_BlockLinesIterator(&gamequery, bx, by, PIT_ApplyTorque);
 
     // If any momentum, mark object as 'falling' using engine-internal flags
     if (mo->momx | mo->momy)
@@ -1362,11 +1348,11 @@ void P_SlideMove(mobj_t *mo)
 
         bestslidefrac = FRACUNIT + 1;
 
-        P_PathTraverse(leadx, leady, leadx + mo->momx, leady + mo->momy,
+        P_PathTraverse(&gamequery, leadx, leady, leadx + mo->momx, leady + mo->momy,
             PT_ADDLINES, PTR_SlideTraverse);
-        P_PathTraverse(trailx, leady, trailx + mo->momx, leady + mo->momy,
+        P_PathTraverse(&gamequery, trailx, leady, trailx + mo->momx, leady + mo->momy,
             PT_ADDLINES, PTR_SlideTraverse);
-        P_PathTraverse(leadx, traily, leadx + mo->momx, traily + mo->momy,
+        P_PathTraverse(&gamequery, leadx, traily, leadx + mo->momx, traily + mo->momy,
             PT_ADDLINES, PTR_SlideTraverse);
 
         // move up to the wall
@@ -1688,7 +1674,7 @@ fixed_t P_AimLineAttack(mobj_t *t1, angle_t angle, fixed_t distance)
     attackrange = distance;
     linetarget = NULL;
 
-    P_PathTraverse(t1->x, t1->y, x2, y2, (PT_ADDLINES | PT_ADDTHINGS), PTR_AimTraverse);
+    P_PathTraverse(&gamequery, t1->x, t1->y, x2, y2, (PT_ADDLINES | PT_ADDTHINGS), PTR_AimTraverse);
 
     if (linetarget)
         return aimslope;
@@ -1715,7 +1701,7 @@ void P_LineAttack(mobj_t *t1, angle_t angle, fixed_t distance, fixed_t slope, in
     attackrange = distance;
     aimslope = slope;
 
-    P_PathTraverse(t1->x, t1->y, x2, y2, (PT_ADDLINES | PT_ADDTHINGS), PTR_ShootTraverse);
+    P_PathTraverse(&gamequery, t1->x, t1->y, x2, y2, (PT_ADDLINES | PT_ADDTHINGS), PTR_ShootTraverse);
 }
 
 //
@@ -1793,8 +1779,8 @@ void P_UseLines(player_t *player)
     y2 = y1 + (USERANGE >> FRACBITS) * finesine[angle];
 
     // This added test makes the "oof" sound work on 2s lines -- killough:
-    if (P_PathTraverse(x1, y1, x2, y2, PT_ADDLINES, PTR_UseTraverse))
-        if (!P_PathTraverse(x1, y1, x2, y2, PT_ADDLINES, PTR_NoWayTraverse))
+    if (P_PathTraverse(&gamequery, x1, y1, x2, y2, PT_ADDLINES, PTR_UseTraverse))
+        if (!P_PathTraverse(&gamequery, x1, y1, x2, y2, PT_ADDLINES, PTR_NoWayTraverse))
             S_StartSound(usething, sfx_noway);
 }
 
@@ -1884,14 +1870,21 @@ void P_RadiusAttack(mobj_t *spot, mobj_t *source, int damage)
     int         yl = (spot->y - dist - bmaporgy) >> MAPBLOCKSHIFT;
     int         xh = (spot->x + dist - bmaporgx) >> MAPBLOCKSHIFT;
     int         xl = (spot->x - dist - bmaporgx) >> MAPBLOCKSHIFT;
+    fixed_t     bbox[4];
 
     bombspot = spot;
     bombsource = source;
     bombdamage = damage;
 
+    // [BH] only check things that are close enough to be damaged
+    bbox[BOXLEFT] = spot->x - ((damage + 1) << FRACBITS);
+    bbox[BOXRIGHT] = spot->x + ((damage + 1) << FRACBITS);
+    bbox[BOXBOTTOM] = spot->y - ((damage + 1) << FRACBITS);
+    bbox[BOXTOP] = spot->y + ((damage + 1) << FRACBITS);
+
     for (y = yl; y <= yh; ++y)
         for (x = xl; x <= xh; ++x)
-            P_BlockThingsIterator(x, y, PIT_RadiusAttack);
+            P_BlockThingsIteratorBox(x, y, bbox, PIT_RadiusAttack);
 }
 
 //
@@ -1997,7 +1990,6 @@ dboolean P_ChangeSector(sector_t *sector, dboolean crunch)
 {
     msecnode_t  *n;
     mobj_t      *mobj;
-    mobjtype_t  type;
 
     nofit = false;
     crushchange = crunch;
@@ -2008,51 +2000,25 @@ dboolean P_ChangeSector(sector_t *sector, dboolean crunch)
         n->visited = false;
 
     if (isliquidsector)
-    {
-        do
-            for (n = sector->touching_thinglist; n; n = n->m_snext)     // go through list
-                if (!n->visited)                                        // unprocessed thing found
-                {
-                    n->visited = true;                                  // mark thing as processed
-                    mobj = n->m_thing;
-                    if (mobj)
-                    {
-                        type = mobj->type;
-                        if (type == MT_BLOODSPLAT)
-                        {
-                            P_UnsetThingPosition(mobj);
-                            --r_bloodsplats_total;
-                        }
-                        else if (type != MT_SHADOW && !(mobj->flags & MF_NOBLOCKMAP))
-                            PIT_ChangeSector(mobj);                     // process it
-                    }
-                    break;                                              // exit and start over
-                }
-        while (n);      // repeat from scratch until all things left are marked valid
-    }
+        P_RemoveBloodSplats(sector);
     else
     {
         sector->floor_xoffs = 0;
         sector->floor_yoffs = 0;
-
-        do
-            for (n = sector->touching_thinglist; n; n = n->m_snext)     // go through list
-                if (!n->visited)                                        // unprocessed thing found
-                {
-                    n->visited = true;                                  // mark thing as processed
-                    mobj = n->m_thing;
-                    if (mobj)
-                    {
-                        type = mobj->type;
-                        if (type != MT_BLOODSPLAT && type != MT_SHADOW
-                            && !(mobj->flags & MF_NOBLOCKMAP))
-                            PIT_ChangeSector(mobj);                     // process it
-                    }
-                    break;                                              // exit and start over
-                }
-        while (n);      // repeat from scratch until all things left are marked valid
     }
 
+    do
+        for (n = sector->touching_thinglist; n; n = n->m_snext)         // go through list
+            if (!n->visited)                                            // unprocessed thing found
+            {
+                n->visited = true;                                      // mark thing as processed
+                mobj = n->m_thing;
+                if (mobj && !(mobj->flags & MF_NOBLOCKMAP))
+                    PIT_ChangeSector(mobj);                             // process it
+                break;                                                  // exit and start over
+            }
+    while (n);          // repeat from scratch until all things left are marked valid
+
     return nofit;
 }
 
@@ -2256,7 +2222,7 @@ void P_CreateSecNodeList(mobj_t *thing, fixed_t x, fixed_t y)
     tmbbox[BOXRIGHT] = x + radius;
     tmbbox[BOXLEFT] = x - radius;
 
-    ++validcount;       // used to make sure we only process a line once
+    P_NewQuery(&gamequery);    // used to make sure we only process a line once
 
     xl = (tmbbox[BOXLEFT] - bmaporgx) >> MAPBLOCKSHIFT;
     xh = (tmbbox[BOXRIGHT] - bmaporgx) >> MAPBLOCKSHIFT;
@@ -2265,7 +2231,7 @@ void P_CreateSecNodeList(mobj_t *thing, fixed_t x, fixed_t y)
 
     for (bx = xl; bx <= xh; ++bx)
         for (by = yl; by <= yh; ++by)
-            P_BlockLinesIterator(bx, by, PIT_GetSectors);
+            P_BlockLinesIterator(&gamequery, bx, by, PIT_GetSectors);
 
     // Add the sector of the (x,y) point to sector_list.
     sector_list = P_AddSecnode(thing->subsector->sector, thing, sector_list);
@@ -36,12 +36,140 @@
 ========================================================================
 */
 
+#include <math.h>
+
 #include "m_bbox.h"
 #include "p_local.h"
 #include "z_zone.h"
 
 extern msecnode_t       *sector_list;   // phares 3/16/98
 
+// [BH] incremented whenever a thing is linked into or unlinked from the blockmap
+static unsigned int     blocklinkchanges;
+
+//
+// BLOCKMAP THING INDEX
+// [BH] As well as blocklinks, each mapblock has a compact array of the things linked into it,
+// with copies of their positions and how far they reach, so that P_BlockThingsIteratorBox()
+// can skip things that are too far away without reading their mobj_t. Things are appended when
+// they are linked, so iterating the array backwards visits them in the same order as
+// blocklinks. Any code that moves or resizes a thing without relinking it must call
+// P_UpdateBlockThing().
+//
+#define MAXBLOCKTHINGITERATORS  32
+
+typedef struct
+{
+    mobj_t              *mobj;
+    fixed_t             x, y;
+    fixed_t             reach;
+} blockthing_t;
+
+typedef struct
+{
+    blockthing_t        *things;
+    int                 numthings;
+    int                 maxthings;
+} blockthings_t;
+
+typedef struct
+{
+    int                 block;
+    int                 index;
+} blockthingiterator_t;
+
+static blockthings_t            *blockthings;
+static blockthingiterator_t     blockthingiterators[MAXBLOCKTHINGITERATORS];
+static int                      numblockthingiterators;
+
+//
+// P_InitBlockThings
+// Called by P_SetupLevel() once the blockmap of the current map has been loaded.
+//
+void P_InitBlockThings(void)
+{
+    blockthings = Z_Calloc(bmapwidth * bmapheight, sizeof(*blockthings), PU_LEVEL, NULL);
+    numblockthingiterators = 0;
+}
+
+static void P_SetBlockThing(blockthing_t *entry, mobj_t *thing)
+{
+    entry->mobj = thing;
+    entry->x = thing->x;
+    entry->y = thing->y;
+    entry->reach = MAX(thing->radius, mobjinfo[thing->type].pickupradius);
+}
+
+static void P_LinkBlockThing(mobj_t *thing, int block)
+{
+    blockthings_t   *list = &blockthings[block];
+
+    if (list->numthings == list->maxthings)
+    {
+        blockthing_t    *things;
+
+        list->maxthings = (list->maxthings ? list->maxthings * 2 : 8);
+        things = Z_Malloc(list->maxthings * sizeof(*things), PU_LEVEL, NULL);
+
+        if (list->things)
+        {
+            memcpy(things, list->things, list->numthings * sizeof(*things));
+            Z_Free(list->things);
+        }
+
+        list->things = things;
+    }
+
+    P_SetBlockThing(&list->things[list->numthings++], thing);
+    thing->blocknum = block;
+}
+
+static void P_UnlinkBlockThing(mobj_t *thing)
+{
+    blockthings_t   *list = &blockthings[thing->blocknum];
+    int             i = list->numthings;
+
+    while (--i >= 0)
+        if (list->things[i].mobj == thing)
+        {
+            int j;
+
+            memmove(&list->things[i], &list->things[i + 1],
+                (list->numthings - i - 1) * sizeof(*list->things));
+            list->numthings--;
+
+            // keep any iterators over this mapblock on the same thing
+            for (j = 0; j < numblockthingiterators; j++)
+                if (blockthingiterators[j].block == thing->blocknum && i < blockthingiterators[j].index)
+                    blockthingiterators[j].index--;
+
+            break;
+        }
+}
+
+//
+// P_UpdateBlockThing
+// Updates the copy of a thing's position and size in the blockmap after it has been moved or
+// resized without being relinked.
+//
+void P_UpdateBlockThing(mobj_t *thing)
+{
+    blockthings_t   *list;
+    int             i;
+
+    if ((thing->flags & MF_NOBLOCKMAP) || !thing->bprev)
+        return;
+
+    list = &blockthings[thing->blocknum];
+
+    for (i = list->numthings - 1; i >= 0; i--)
+        if (list->things[i].mobj == thing)
+        {
+            P_SetBlockThing(&list->things[i], thing);
+            break;
+        }
+}
+
 void P_CreateSecNodeList(mobj_t *thing, fixed_t x, fixed_t y);
 
 //
@@ -241,6 +369,11 @@ void P_UnsetThingPosition(mobj_t *thing)
 
         if (bprev && (*bprev = bnext = thing->bnext))   // unlink from block map
             bnext->bprev = bprev;
+
+        if (bprev)
+            P_UnlinkBlockThing(thing);
+
+        blocklinkchanges++;
     }
 }
 
@@ -304,6 +437,8 @@ void P_SetThingPosition(mobj_t *thing)
                 bnext->bprev = &thing->bnext;
             thing->bprev = link;
             *link = thing;
+            P_LinkBlockThing(thing, blocky * bmapwidth + blockx);
+            blocklinkchanges++;
         }
         else
         {
@@ -315,40 +450,54 @@ void P_SetThingPosition(mobj_t *thing)
 }
 
 //
-// P_SetBloodSplatPosition
+// BLOCK MAP ITERATORS
+// For each line/thing in the given mapblock,
+// call the passed PIT_* function.
+// If the function returns false,
+// exit with false without checking anything else.
 //
-void P_SetBloodSplatPosition(mobj_t *splat)
-{
-    mobj_t      **link = &splat->subsector->sector->thinglist;
-    mobj_t      *snext = *link;
 
-    if ((splat->snext = snext))
-        snext->sprev = &splat->snext;
-    splat->sprev = link;
-    *link = splat;
+//
+// QUERY CONTEXTS
+// gamequery is used by the game thread, and renderquery by the renderer.
+//
+querycontext_t  gamequery;
+querycontext_t  renderquery;
 
-    P_CreateSecNodeList(splat, splat->x, splat->y);
-    splat->touching_sectorlist = sector_list;
-    sector_list = NULL;
+//
+// P_InitQueryContext
+// Allocate the stamps of a query context for the current map.
+//
+void P_InitQueryContext(querycontext_t *query)
+{
+    query->stamp = 0;
+    query->linestamps = Z_Calloc(numlines, sizeof(*query->linestamps), PU_LEVEL, NULL);
+    query->sectorstamps = Z_Calloc(numsectors, sizeof(*query->sectorstamps), PU_LEVEL, NULL);
 }
 
 //
-// BLOCK MAP ITERATORS
-// For each line/thing in the given mapblock,
-// call the passed PIT_* function.
-// If the function returns false,
-// exit with false without checking anything else.
+// P_NewQuery
+// Start a new query, so that no lines or sectors are marked as visited.
 //
+void P_NewQuery(querycontext_t *query)
+{
+    // clear the stamps if the stamp wraps around
+    if (!++query->stamp)
+    {
+        memset(query->linestamps, 0, numlines * sizeof(*query->linestamps));
+        memset(query->sectorstamps, 0, numsectors * sizeof(*query->sectorstamps));
+        query->stamp = 1;
+    }
+}
 
 //
 // P_BlockLinesIterator
-// The validcount flags are used to avoid checking lines
-// that are marked in multiple mapblocks,
-// so increment validcount before the first call
-// to P_BlockLinesIterator, then make one or more calls
+// The lines visited are marked in query to avoid checking lines
+// that are in multiple mapblocks, so call P_NewQuery() before the
+// first call to P_BlockLinesIterator, then make one or more calls
 // to it.
 //
-dboolean P_BlockLinesIterator(int x, int y, dboolean func(line_t *))
+dboolean P_BlockLinesIterator(querycontext_t *query, int x, int y, dboolean func(line_t *))
 {
     if (x < 0 || y < 0 || x >= bmapwidth || y >= bmapheight)
         return true;
@@ -361,10 +510,10 @@ dboolean P_BlockLinesIterator(int x, int y, dboolean func(line_t *))
         {
             line_t          *ld = &lines[*list];
 
-            if (ld->validcount == validcount)
+            if (P_LineVisited(query, ld))
                 continue;       // line has already been checked
 
-            ld->validcount = validcount;
+            P_MarkLine(query, ld);
 
             if (!func(ld))
                 return false;
@@ -389,6 +538,45 @@ dboolean P_BlockThingsIterator(int x, int y, dboolean func(mobj_t *))
     return true;
 }
 
+//
+// P_BlockThingsIteratorBox
+// [BH] The same as P_BlockThingsIterator(), but only calls func for the things in the given
+// mapblock that reach into bbox.
+//
+dboolean P_BlockThingsIteratorBox(int x, int y, const fixed_t *bbox, dboolean func(mobj_t *))
+{
+    int                     block = y * bmapwidth + x;
+    blockthingiterator_t    *iterator;
+    dboolean                result = true;
+
+    if (x < 0 || y < 0 || x >= bmapwidth || y >= bmapheight)
+        return true;
+
+    if (numblockthingiterators == MAXBLOCKTHINGITERATORS)
+        return P_BlockThingsIterator(x, y, func);
+
+    iterator = &blockthingiterators[numblockthingiterators++];
+    iterator->block = block;
+
+    for (iterator->index = blockthings[block].numthings - 1; iterator->index >= 0; iterator->index--)
+    {
+        const blockthing_t  *thing = &blockthings[block].things[iterator->index];
+
+        if (thing->x + thing->reach < bbox[BOXLEFT] || thing->x - thing->reach > bbox[BOXRIGHT]
+            || thing->y + thing->reach < bbox[BOXBOTTOM] || thing->y - thing->reach > bbox[BOXTOP])
+            continue;
+
+        if (!func(thing->mobj))
+        {
+            result = false;
+            break;
+        }
+    }
+
+    numblockthingiterators--;
+    return result;
+}
+
 //
 // INTERCEPT ROUTINES
 //
@@ -553,15 +741,318 @@ static dboolean P_TraverseIntercepts(traverser_t func, fixed_t maxfrac)
     return true;                // everything was traversed
 }
 
+//
+// HITSCAN BATCHES
+// [BH] When a number of hitscan attacks are made from the same point in the same direction in
+// quick succession, such as the pellets of a shotgun, the lines and things in each block of the
+// blockmap that could be hit by any of them are only found once. Those that are out of range,
+// or outside the spread of the attacks, are left out so that each attack doesn't need to check
+// them. Everything that is left in is still checked in the same order, and everything that is
+// left out could only ever have been behind or beyond an attack, so the results are the same.
+//
+#define HITSCANMARGIN   64.0                    // map units
+#define HITSCANANGLE    (4.0 * M_PI / 180.0)    // 4 degrees
+
+typedef struct
+{
+    unsigned int        stamp;
+    int                 firstline;
+    int                 numlines;
+    int                 firstthing;
+    int                 numthings;
+} hitscanblock_t;
+
+static hitscanblock_t   *hitscanblocks;
+static unsigned int     hitscanstamp;
+static unsigned int     hitscanblocklinks;
+
+static line_t           **hitscanlines;
+static int              numhitscanlines;
+static int              maxhitscanlines;
+static mobj_t           **hitscanthings;
+static int              numhitscanthings;
+static int              maxhitscanthings;
+
+static dboolean         hitscanbatch;
+static fixed_t          hitscanx, hitscany;
+static double           hitscanangle;
+static double           hitscanspread;
+static double           hitscanrange;
+static double           hitscanbbox[4];
+
+//
+// P_InitHitscanBatches
+// Called by P_SetupLevel() once the blockmap of the current map has been loaded.
+//
+void P_InitHitscanBatches(void)
+{
+    hitscanblocks = Z_Calloc(bmapwidth * bmapheight, sizeof(*hitscanblocks), PU_LEVEL, NULL);
+    hitscanstamp = 0;
+    hitscanbatch = false;
+}
+
+static double P_HitscanAngleDiff(double angle)
+{
+    angle = fmod(angle - hitscanangle, 2.0 * M_PI);
+
+    if (angle > M_PI)
+        angle -= 2.0 * M_PI;
+    else if (angle <= -M_PI)
+        angle += 2.0 * M_PI;
+
+    return angle;
+}
+
+static void P_AddToHitscanBBox(double x, double y)
+{
+    hitscanbbox[BOXLEFT] = MIN(hitscanbbox[BOXLEFT], x - HITSCANMARGIN);
+    hitscanbbox[BOXRIGHT] = MAX(hitscanbbox[BOXRIGHT], x + HITSCANMARGIN);
+    hitscanbbox[BOXBOTTOM] = MIN(hitscanbbox[BOXBOTTOM], y - HITSCANMARGIN);
+    hitscanbbox[BOXTOP] = MAX(hitscanbbox[BOXTOP], y + HITSCANMARGIN);
+}
+
+static dboolean P_OutsideHitscanBBox(double left, double right, double bottom, double top)
+{
+    return (right < hitscanbbox[BOXLEFT] || left > hitscanbbox[BOXRIGHT]
+        || top < hitscanbbox[BOXBOTTOM] || bottom > hitscanbbox[BOXTOP]);
+}
+
+//
+// P_BeginHitscanBatch
+// Hitscan attacks made by t1 until P_EndHitscanBatch() is called, that are no further than
+// distance and within spread either side of angle, share the lines and things they check.
+//
+void P_BeginHitscanBatch(mobj_t *t1, angle_t angle, angle_t spread, fixed_t distance)
+{
+    double      x = (double)t1->x / FRACUNIT;
+    double      y = (double)t1->y / FRACUNIT;
+    double      a;
+    int         i;
+
+    if (!hitscanblocks)
+        return;
+
+    hitscanbatch = true;
+    hitscanx = t1->x;
+    hitscany = t1->y;
+    hitscanangle = (double)angle * M_PI / ANG180;
+    hitscanspread = (double)spread * M_PI / ANG180 + HITSCANANGLE;
+    hitscanrange = (double)distance / FRACUNIT;
+
+    if (!++hitscanstamp)
+    {
+        memset(hitscanblocks, 0, bmapwidth * bmapheight * sizeof(*hitscanblocks));
+        hitscanstamp = 1;
+    }
+
+    numhitscanlines = 0;
+    numhitscanthings = 0;
+    hitscanblocklinks = blocklinkchanges;
+
+    // find the bounding box of the spread
+    hitscanbbox[BOXLEFT] = hitscanbbox[BOXRIGHT] = x;
+    hitscanbbox[BOXBOTTOM] = hitscanbbox[BOXTOP] = y;
+    P_AddToHitscanBBox(x, y);
+
+    a = hitscanangle - hitscanspread;
+    P_AddToHitscanBBox(x + (hitscanrange + HITSCANMARGIN) * cos(a),
+        y + (hitscanrange + HITSCANMARGIN) * sin(a));
+    a = hitscanangle + hitscanspread;
+    P_AddToHitscanBBox(x + (hitscanrange + HITSCANMARGIN) * cos(a),
+        y + (hitscanrange + HITSCANMARGIN) * sin(a));
+
+    for (i = 0; i < 4; i++)
+    {
+        a = i * M_PI / 2.0;
+
+        if (fabs(P_HitscanAngleDiff(a)) <= hitscanspread)
+            P_AddToHitscanBBox(x + (hitscanrange + HITSCANMARGIN) * cos(a),
+                y + (hitscanrange + HITSCANMARGIN) * sin(a));
+    }
+}
+
+//
+// P_EndHitscanBatch
+//
+void P_EndHitscanBatch(void)
+{
+    hitscanbatch = false;
+}
+
+//
+// P_InHitscanBatch
+// Returns true if a trace from x1,y1 to x2,y2 is within the current hitscan batch.
+//
+static dboolean P_InHitscanBatch(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2)
+{
+    double      dx, dy;
+
+    if (!hitscanbatch || x1 != hitscanx || y1 != hitscany)
+        return false;
+
+    dx = (double)x2 / FRACUNIT - (double)x1 / FRACUNIT;
+    dy = (double)y2 / FRACUNIT - (double)y1 / FRACUNIT;
+
+    return (sqrt(dx * dx + dy * dy) <= hitscanrange + 1.0
+        && fabs(P_HitscanAngleDiff(atan2(dy, dx))) <= hitscanspread - HITSCANANGLE / 2.0);
+}
+
+//
+// P_LineInHitscanBatch
+// Returns false if a line can't be crossed by any attack in the current hitscan batch.
+//
+static dboolean P_LineInHitscanBatch(const line_t *line)
+{
+    double      x = (double)hitscanx / FRACUNIT;
+    double      y = (double)hitscany / FRACUNIT;
+    double      x1 = (double)line->v1->x / FRACUNIT - x;
+    double      y1 = (double)line->v1->y / FRACUNIT - y;
+    double      x2 = (double)line->v2->x / FRACUNIT - x;
+    double      y2 = (double)line->v2->y / FRACUNIT - y;
+    double      a1, a2;
+
+    if (P_OutsideHitscanBBox(MIN(x1, x2) + x, MAX(x1, x2) + x, MIN(y1, y2) + y, MAX(y1, y2) + y))
+        return false;
+
+    // keep lines that are too close to tell
+    if (MIN(x1, x2) <= HITSCANMARGIN && MAX(x1, x2) >= -HITSCANMARGIN
+        && MIN(y1, y2) <= HITSCANMARGIN && MAX(y1, y2) >= -HITSCANMARGIN)
+        return true;
+
+    a1 = P_HitscanAngleDiff(atan2(y1, x1));
+    a2 = P_HitscanAngleDiff(atan2(y2, x2));
+
+    if (fabs(a1) <= hitscanspread || fabs(a2) <= hitscanspread)
+        return true;
+
+    // the line is crossed by the center of the spread
+    return ((a1 < 0.0) != (a2 < 0.0) && fabs(a1) + fabs(a2) <= M_PI);
+}
+
+//
+// P_ThingInHitscanBatch
+// Returns false if a thing can't be hit by any attack in the current hitscan batch.
+//
+static dboolean P_ThingInHitscanBatch(const mobj_t *thing)
+{
+    double      radius = (double)thing->radius / FRACUNIT * 1.5;
+    double      x = (double)(thing->x - hitscanx) / FRACUNIT;
+    double      y = (double)(thing->y - hitscany) / FRACUNIT;
+    double      dist = sqrt(x * x + y * y);
+
+    if (P_OutsideHitscanBBox((double)thing->x / FRACUNIT - radius, (double)thing->x / FRACUNIT + radius,
+        (double)thing->y / FRACUNIT - radius, (double)thing->y / FRACUNIT + radius))
+        return false;
+
+    // keep things that are too close to tell
+    if (dist <= radius + HITSCANMARGIN)
+        return true;
+
+    return (fabs(P_HitscanAngleDiff(atan2(y, x))) <= hitscanspread + asin(radius / dist));
+}
+
+static void P_CacheHitscanBlock(hitscanblock_t *block, int x, int y)
+{
+    int         offset = *(blockmap + y * bmapwidth + x);
+    const int   *list;
+    mobj_t      *mobj;
+
+    block->stamp = hitscanstamp;
+    block->firstline = numhitscanlines;
+    block->numlines = 0;
+    block->firstthing = numhitscanthings;
+    block->numthings = 0;
+
+    for (list = blockmaplump + offset + 1; *list != -1; ++list)
+    {
+        line_t  *ld = &lines[*list];
+
+        if (!P_LineInHitscanBatch(ld))
+            continue;
+
+        if (numhitscanlines == maxhitscanlines)
+        {
+            maxhitscanlines = (maxhitscanlines ? maxhitscanlines * 2 : 256);
+            hitscanlines = Z_Realloc(hitscanlines, maxhitscanlines * sizeof(*hitscanlines));
+        }
+
+        hitscanlines[numhitscanlines++] = ld;
+        block->numlines++;
+    }
+
+    for (mobj = blocklinks[y * bmapwidth + x]; mobj; mobj = mobj->bnext)
+    {
+        if (!P_ThingInHitscanBatch(mobj))
+            continue;
+
+        if (numhitscanthings == maxhitscanthings)
+        {
+            maxhitscanthings = (maxhitscanthings ? maxhitscanthings * 2 : 256);
+            hitscanthings = Z_Realloc(hitscanthings, maxhitscanthings * sizeof(*hitscanthings));
+        }
+
+        hitscanthings[numhitscanthings++] = mobj;
+        block->numthings++;
+    }
+}
+
+//
+// P_AddHitscanIntercepts
+// Adds the intercepts of the lines and then the things in the given mapblock, the same as
+// P_BlockLinesIterator(query, x, y, PIT_AddLineIntercepts) and
+// P_BlockThingsIterator(x, y, PIT_AddThingIntercepts) would.
+//
+static void P_AddHitscanIntercepts(querycontext_t *query, int x, int y)
+{
+    hitscanblock_t  *block;
+    int             i;
+
+    if (x < 0 || y < 0 || x >= bmapwidth || y >= bmapheight)
+        return;
+
+    // start again if any things have moved since the blocks were cached
+    if (hitscanblocklinks != blocklinkchanges)
+    {
+        if (!++hitscanstamp)
+        {
+            memset(hitscanblocks, 0, bmapwidth * bmapheight * sizeof(*hitscanblocks));
+            hitscanstamp = 1;
+        }
+
+        numhitscanlines = 0;
+        numhitscanthings = 0;
+        hitscanblocklinks = blocklinkchanges;
+    }
+
+    block = &hitscanblocks[y * bmapwidth + x];
+
+    if (block->stamp != hitscanstamp)
+        P_CacheHitscanBlock(block, x, y);
+
+    for (i = 0; i < block->numlines; i++)
+    {
+        line_t  *ld = hitscanlines[block->firstline + i];
+
+        if (P_LineVisited(query, ld))
+            continue;   // line has already been checked
+
+        P_MarkLine(query, ld);
+        PIT_AddLineIntercepts(ld);
+    }
+
+    for (i = 0; i < block->numthings; i++)
+        PIT_AddThingIntercepts(hitscanthings[block->firstthing + i]);
+}
+
 //
 // P_PathTraverse
 // Traces a line from x1,y1 to x2,y2,
 // calling the traverser function for each.
 // Returns true if the traverser function returns true
-// for all lines.
+// for all lines. The lines visited are marked in query.
 //
-dboolean P_PathTraverse(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2, int flags,
-    dboolean (*trav)(intercept_t *))
+dboolean P_PathTraverse(querycontext_t *query, fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
+    int flags, dboolean (*trav)(intercept_t *))
 {
     fixed_t     xt1, yt1;
     fixed_t     xt2, yt2;
@@ -572,8 +1063,9 @@ dboolean P_PathTraverse(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2, int flag
     int         mapx1, mapy1;
     int         mapxstep, mapystep;
     int         count;
+    dboolean    batch = (flags == (PT_ADDLINES | PT_ADDTHINGS) && P_InHitscanBatch(x1, y1, x2, y2));
 
-    ++validcount;
+    P_NewQuery(query);
     intercept_p = intercepts;
 
     if (!((x1 - bmaporgx) & (MAPBLOCKSIZE - 1)))
@@ -650,13 +1142,18 @@ dboolean P_PathTraverse(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2, int flag
 
     for (count = 0; count < 64; ++count)
     {
-        if (flags & PT_ADDLINES)
-            if (!P_BlockLinesIterator(mapx, mapy, PIT_AddLineIntercepts))
-                return false;           // early out
+        if (batch)
+            P_AddHitscanIntercepts(query, mapx, mapy);
+        else
+        {
+            if (flags & PT_ADDLINES)
+                if (!P_BlockLinesIterator(query, mapx, mapy, PIT_AddLineIntercepts))
+                    return false;       // early out
 
-        if (flags & PT_ADDTHINGS)
-            if (!P_BlockThingsIterator(mapx, mapy, PIT_AddThingIntercepts))
-                return false;           // early out
+            if (flags & PT_ADDTHINGS)
+                if (!P_BlockThingsIterator(mapx, mapy, PIT_AddThingIntercepts))
+                    return false;       // early out
+        }
 
         if (mapx == xt2 && mapy == yt2)
             break;
@@ -50,7 +50,6 @@
 
 void G_PlayerReborn(void);
 void P_DelSeclist(msecnode_t *node);
-void P_SpawnShadow(mobj_t *actor);
 
 int                     r_blood = r_blood_default;
 int                     r_bloodsplats_max = r_bloodsplats_max_default;
@@ -104,7 +103,6 @@ dboolean P_SetMobjState(mobj_t *mobj, statenum_t state)
 {
     state_t     *st;
     int         cycle_counter = 0;
-    mobj_t      *shadow = mobj->shadow;
 
     do
     {
@@ -133,14 +131,6 @@ dboolean P_SetMobjState(mobj_t *mobj, statenum_t state)
             I_Error("P_SetMobjState: Infinite state cycle detected!");
     } while (!mobj->tics);
 
-    // [BH] Use same sprite frame for shadow as mobj
-    if (shadow)
-    {
-        shadow->sprite = mobj->sprite;
-        shadow->frame = mobj->frame;
-        shadow->angle = mobj->angle;
-    }
-
     return true;
 }
 
@@ -163,7 +153,7 @@ void P_ExplodeMissile(mobj_t *mo)
     if (mo->type == MT_ROCKET)
     {
         mo->colfunc = tlcolfunc;
-        P_RemoveMobjShadow(mo);
+        mo->flags2 &= ~MF2_SHADOW;
     }
 
     if (mo->info->deathsound)
@@ -586,7 +576,7 @@ void P_MobjThinker(mobj_t *mobj)
     {
         P_XYMovement(mobj);
 
-        if (mobj->thinker.function == P_RemoveThinkerDelayed)   // killough
+        if (mobj->thinker.function == P_RemoveMobjDelayed)      // killough
             return;             // mobj was removed
     }
 
@@ -637,7 +627,7 @@ void P_MobjThinker(mobj_t *mobj)
         else
             P_ZMovement(mobj);
 
-        if (mobj->thinker.function == P_RemoveThinkerDelayed)   // killough
+        if (mobj->thinker.function == P_RemoveMobjDelayed)      // killough
             return;             // mobj was removed
     }
     else if (!(mobj->momx | mobj->momy) && !sentient(mobj))
@@ -683,12 +673,106 @@ void P_MobjThinker(mobj_t *mobj)
     }
 }
 
+//
+// MOBJ POOL
+// [BH] mobjs are allocated from chunks of cache-line-aligned slots rather than
+// individually, and recycled through a free list when removed. The
+// chunks are allocated with PU_LEVEL, so the whole pool is released at the start of
+// each level. Each slot has a generation count that is odd while the slot is in use.
+//
+#define MOBJCHUNKSIZE   1024
+#define CACHELINESIZE   64
+
+typedef struct mobjslot_s
+{
+    mobj_t              mobj;
+    struct mobjslot_s   *nextfree;
+    unsigned int        generation;
+} mobjslot_t;
+
+#define MOBJSLOTSIZE    ((sizeof(mobjslot_t) + CACHELINESIZE - 1) & ~(CACHELINESIZE - 1))
+
+static mobjslot_t       *freemobjs;
+
+//
+// P_InitMobjPool
+// Called after the PU_LEVEL chunks have been freed at the start of a level.
+//
+void P_InitMobjPool(void)
+{
+    freemobjs = NULL;
+}
+
+static void P_AddMobjChunk(void)
+{
+    byte        *chunk = Z_Malloc(MOBJCHUNKSIZE * MOBJSLOTSIZE + CACHELINESIZE, PU_LEVEL, NULL);
+    int         i;
+
+    chunk = (byte *)(((uintptr_t)chunk + CACHELINESIZE - 1) & ~(uintptr_t)(CACHELINESIZE - 1));
+
+    // add the slots to the free list so they are handed out in address order
+    for (i = MOBJCHUNKSIZE - 1; i >= 0; i--)
+    {
+        mobjslot_t  *slot = (mobjslot_t *)(chunk + i * MOBJSLOTSIZE);
+
+        slot->generation = 0;
+        slot->nextfree = freemobjs;
+        freemobjs = slot;
+    }
+}
+
+//
+// P_AllocMobj
+// Returns a cleared mobj from the pool.
+//
+mobj_t *P_AllocMobj(void)
+{
+    mobjslot_t  *slot;
+
+    if (!freemobjs)
+        P_AddMobjChunk();
+
+    slot = freemobjs;
+    freemobjs = slot->nextfree;
+    slot->generation++;
+
+    return memset(&slot->mobj, 0, sizeof(slot->mobj));
+}
+
+//
+// P_FreeMobj
+// Returns a mobj to the pool. Its memory is left untouched until the slot is reused.
+//
+void P_FreeMobj(mobj_t *mobj)
+{
+    mobjslot_t  *slot = (mobjslot_t *)mobj;
+
+#if defined(_DEBUG)
+    if (!(slot->generation & 1))
+        I_Error("P_FreeMobj: Mobj %p has already been freed", (void *)mobj);
+#endif
+
+    slot->generation++;
+    slot->nextfree = freemobjs;
+    freemobjs = slot;
+}
+
+//
+// P_MobjGeneration
+// Returns the generation count of a mobj's slot, which changes each time the slot is
+// allocated or freed. A mobj is still in use if its generation is odd.
+//
+unsigned int P_MobjGeneration(mobj_t *mobj)
+{
+    return ((mobjslot_t *)mobj)->generation;
+}
+
 //
 // P_SpawnMobj
 //
 mobj_t *P_SpawnMobj(fixed_t x, fixed_t y, fixed_t z, mobjtype_t type)
 {
-    mobj_t      *mobj = Z_Calloc(1, sizeof(*mobj), PU_LEVEL, NULL);
+    mobj_t      *mobj = P_AllocMobj();
     state_t     *st;
     mobjinfo_t  *info = &mobjinfo[type];
     sector_t    *sector;
@@ -761,10 +845,6 @@ mobj_t *P_SpawnMobj(fixed_t x, fixed_t y, fixed_t z, mobjtype_t type)
     mobj->thinker.function = P_MobjThinker;
     P_AddThinker(&mobj->thinker);
 
-    // [BH] spawn the mobj's shadow
-    if (mobj->flags2 & MF2_SHADOW)
-        P_SpawnShadow(mobj);
-
     if (!(mobj->flags2 & MF2_NOFOOTCLIP) && isliquid[sector->floorpic] && sector->heightsec == -1)
         mobj->flags2 |= MF2_FEETARECLIPPED;
 
@@ -799,8 +879,6 @@ void P_RemoveMobj(mobj_t *mobj)
             iquetail = (iquetail + 1) & (ITEMQUEUESIZE - 1);
     }
 
-    P_RemoveMobjShadow(mobj);
-
     // unlink from sector and block lists
     P_UnsetThingPosition(mobj);
 
@@ -820,30 +898,9 @@ void P_RemoveMobj(mobj_t *mobj)
     P_SetTarget(&mobj->tracer, NULL);
     P_SetTarget(&mobj->lastenemy, NULL);
 
-    // free block
-    P_RemoveThinker((thinker_t *)mobj);
-}
-
-//
-// P_RemoveMobjShadow
-// [BH] Remove the shadow of a mobj
-//
-void P_RemoveMobjShadow(mobj_t *mobj)
-{
-    if (!mobj->shadow)
-        return;
-
-    // unlink from sector and block lists
-    P_UnsetThingPosition(mobj->shadow);
-
-    // Delete all nodes on the current sector_list
-    if (sector_list)
-    {
-        P_DelSeclist(sector_list);
-        sector_list = NULL;
-    }
-
-    mobj->shadow = NULL;
+    // free block, returning it to the mobj pool
+    mobj->thinker.function = P_RemoveMobjDelayed;
+    P_UpdateThinker(&mobj->thinker);
 }
 
 //
@@ -1111,8 +1168,6 @@ void P_SpawnMapThing(mapthing_t *mthing, int index)
 
     mobj->angle = ((mthing->angle % 45) ? mthing->angle * (ANG45 / 45) :
         ANG45 * (mthing->angle / 45));
-    if (mobj->shadow)
-        mobj->shadow->angle = mobj->angle;
 
     // [BH] randomly mirror corpses
     if ((flags & MF_CORPSE) && r_corpses_mirrored)
@@ -1124,8 +1179,6 @@ void P_SpawnMapThing(mapthing_t *mthing, int index)
         {
             prev--;
             mobj->flags2 |= MF2_MIRRORED;
-            if (mobj->shadow)
-                mobj->shadow->flags2 |= MF2_MIRRORED;
         }
         else
             prev++;
@@ -1219,7 +1272,7 @@ void P_SpawnBlood(fixed_t x, fixed_t y, fixed_t z, angle_t angle, int damage, mo
 
     for (i = (damage >> 2) + 1; i; i--)
     {
-        mobj_t      *th = Z_Calloc(1, sizeof(*th), PU_LEVEL, NULL);
+        mobj_t      *th = P_AllocMobj();
         state_t     *st;
 
         th->type = color;
@@ -1265,75 +1318,135 @@ void P_SpawnBlood(fixed_t x, fixed_t y, fixed_t z, angle_t angle, int damage, mo
 }
 
 //
-// P_SpawnBloodSplat
+// BLOOD SPLATS
+// [BH] Blood splats are kept in a ring buffer of r_bloodsplats_max decals, each linked into
+// the list of the sector it is in. Once the buffer is full, the oldest splat is recycled.
 //
-void P_SpawnBloodSplat(fixed_t x, fixed_t y, int blood, int maxheight, mobj_t *target)
+static bloodsplat_t     *bloodsplats;
+static int              bloodsplatsmax;
+static int              bloodsplathead;
+
+//
+// P_InitBloodSplats
+// Called after the PU_LEVEL buffer has been freed at the start of a level.
+//
+void P_InitBloodSplats(void)
 {
-    subsector_t *subsec = R_PointInSubsector(x, y);
-    sector_t    *sec = subsec->sector;
-    short       floorpic = sec->floorpic;
+    bloodsplats = NULL;
+    bloodsplatsmax = 0;
+    bloodsplathead = 0;
+    r_bloodsplats_total = 0;
+}
 
-    if (!isliquid[floorpic] && sec->floorheight <= maxheight && floorpic != skyflatnum)
-    {
-        mobj_t  *newsplat = Z_Calloc(1, sizeof(*newsplat), PU_LEVEL, NULL);
+static void P_UnlinkBloodSplat(bloodsplat_t *splat)
+{
+    bloodsplat_t    *snext = splat->snext;
 
-        newsplat->type = MT_BLOODSPLAT;
-        newsplat->sprite = SPR_BLD2;
-        newsplat->frame = rand() & 7;
+    if ((*splat->sprev = snext))
+        snext->sprev = splat->sprev;
 
-        newsplat->flags2 = (MF2_DONOTMAP | ((rand() & 1) * MF2_MIRRORED));
-        if (blood == FUZZYBLOOD)
-        {
-            newsplat->flags = MF_FUZZ;
-            newsplat->colfunc = fuzzcolfunc;
-        }
-        else
-            newsplat->colfunc = bloodsplatcolfunc;
-        newsplat->projectfunc = R_ProjectBloodSplat;
-        newsplat->blood = blood;
+    splat->sprev = NULL;
+    r_bloodsplats_total--;
+}
 
-        newsplat->x = x;
-        newsplat->y = y;
-        newsplat->subsector = subsec;
-        P_SetBloodSplatPosition(newsplat);
+//
+// P_AddBloodSplat
+//
+void P_AddBloodSplat(sector_t *sec, fixed_t x, fixed_t y, int blood, int frame)
+{
+    bloodsplat_t    *splat;
+    bloodsplat_t    **link = &sec->splatlist;
 
-        if (++r_bloodsplats_total >= r_bloodsplats_max)
-            P_BloodSplatSpawner = P_NullBloodSplatSpawner;
+    if (!bloodsplats)
+    {
+        if (!r_bloodsplats_max)
+            return;
 
-        if (target)
-            target->bloodsplats = MAX(0, target->bloodsplats - 1);
+        bloodsplatsmax = r_bloodsplats_max;
+        bloodsplats = Z_Calloc(bloodsplatsmax, sizeof(*bloodsplats), PU_LEVEL, NULL);
     }
+
+    splat = &bloodsplats[bloodsplathead];
+    bloodsplathead = (bloodsplathead + 1) % bloodsplatsmax;
+
+    // recycle the oldest splat
+    if (splat->sprev)
+        P_UnlinkBloodSplat(splat);
+
+    splat->x = x;
+    splat->y = y;
+    splat->blood = blood;
+    splat->frame = frame;
+
+    if ((splat->snext = *link))
+        (*link)->sprev = &splat->snext;
+    splat->sprev = link;
+    *link = splat;
+
+    r_bloodsplats_total++;
 }
 
-void P_NullBloodSplatSpawner(fixed_t x, fixed_t y, int blood, int maxheight, mobj_t *target) {}
+//
+// P_RemoveBloodSplats
+// Remove all the blood splats in a sector
+//
+void P_RemoveBloodSplats(sector_t *sec)
+{
+    while (sec->splatlist)
+        P_UnlinkBloodSplat(sec->splatlist);
+}
 
 //
-// P_SpawnShadow
+// P_ResizeBloodSplats
+// Called when r_bloodsplats_max changes, keeping the newest splats that still fit.
 //
-void P_SpawnShadow(mobj_t *actor)
+void P_ResizeBloodSplats(void)
 {
-    mobj_t      *mobj = Z_Calloc(1, sizeof(*mobj), PU_LEVEL, NULL);
+    bloodsplat_t    *oldsplats = bloodsplats;
+    int             oldmax = bloodsplatsmax;
+    int             oldhead = bloodsplathead;
+    int             skip = r_bloodsplats_total - r_bloodsplats_max;
+    int             i;
 
-    mobj->type = MT_SHADOW;
-    mobj->info = &mobjinfo[MT_SHADOW];
-    mobj->x = actor->x;
-    mobj->y = actor->y;
+    if (!oldsplats)
+        return;
 
-    mobj->sprite = actor->state->sprite;
-    mobj->frame = actor->state->frame;
+    for (i = 0; i < numsectors; ++i)
+        sectors[i].splatlist = NULL;
 
-    mobj->flags2 = MF2_DONOTMAP;
+    P_InitBloodSplats();
 
-    mobj->colfunc = ((actor->flags & MF_FUZZ) ? R_DrawFuzzyShadowColumn :
-        (r_translucency ? R_DrawShadowColumn : R_DrawSolidShadowColumn));
-    mobj->projectfunc = R_ProjectShadow;
+    for (i = 0; i < oldmax; ++i)
+    {
+        bloodsplat_t    *splat = &oldsplats[(oldhead + i) % oldmax];
 
-    P_SetThingPosition(mobj);
+        if (splat->sprev && skip-- <= 0)
+            P_AddBloodSplat(R_PointInSubsector(splat->x, splat->y)->sector, splat->x, splat->y,
+                splat->blood, splat->frame);
+    }
+
+    Z_Free(oldsplats);
+}
+
+//
+// P_SpawnBloodSplat
+//
+void P_SpawnBloodSplat(fixed_t x, fixed_t y, int blood, int maxheight, mobj_t *target)
+{
+    sector_t    *sec = R_PointInSubsector(x, y)->sector;
+    short       floorpic = sec->floorpic;
+
+    if (!isliquid[floorpic] && sec->floorheight <= maxheight && floorpic != skyflatnum)
+    {
+        P_AddBloodSplat(sec, x, y, blood, rand() & 7);
 
-    actor->shadow = mobj;
-    mobj->shadow = actor;
+        if (target)
+            target->bloodsplats = MAX(0, target->bloodsplats - 1);
+    }
 }
 
+void P_NullBloodSplatSpawner(fixed_t x, fixed_t y, int blood, int maxheight, mobj_t *target) {}
+
 //
 // P_CheckMissileSpawn
 // Moves the missile forward a bit
@@ -1348,6 +1461,7 @@ void P_CheckMissileSpawn(mobj_t *th)
     th->x += (th->momx >> 1);
     th->y += (th->momy >> 1);
     th->z += (th->momz >> 1);
+    P_UpdateBlockThing(th);
 
     if (!P_TryMove(th, th->x, th->y, false))
         P_ExplodeMissile(th);
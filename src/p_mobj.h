@@ -320,6 +320,7 @@ typedef struct mobj_s
     // Links in blocks (if needed).
     struct mobj_s       *bnext;
     struct mobj_s       **bprev;        // killough 8/11/98: change to ptr-to-ptr
+    int                 blocknum;       // [BH] mapblock it is linked into
 
     struct subsector_s  *subsector;
 
@@ -392,8 +393,6 @@ typedef struct mobj_s
 
     int                 bloodsplats;
 
-    struct mobj_s       *shadow;
-
     int                 blood;
 
     // [AM] If true, ok to interpolate this tic.
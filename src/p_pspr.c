@@ -692,9 +692,13 @@ void A_FireShotgun(mobj_t *actor, player_t *player, pspdef_t *psp)
 
     successfulshot = false;
 
+    P_BeginHitscanBatch(actor, actor->angle, 255 << 18, MISSILERANGE);
+
     for (i = 0; i < 7; i++)
         P_GunShot(actor, false);
 
+    P_EndHitscanBatch();
+
     if (successfulshot)
     {
         successfulshot = false;
@@ -728,6 +732,8 @@ void A_FireShotgun2(mobj_t *actor, player_t *player, pspdef_t *psp)
 
     successfulshot = false;
 
+    P_BeginHitscanBatch(actor, actor->angle, 255 << ANGLETOFINESHIFT, MISSILERANGE);
+
     for (i = 0; i < 20; i++)
     {
         int     damage = 5 * (M_Random() % 3 + 1);
@@ -737,6 +743,8 @@ void A_FireShotgun2(mobj_t *actor, player_t *player, pspdef_t *psp)
             damage);
     }
 
+    P_EndHitscanBatch();
+
     if (successfulshot)
     {
         successfulshot = false;
@@ -44,15 +44,41 @@
 #include "p_local.h"
 #include "p_saveg.h"
 #include "p_tick.h"
+#include "sounds.h"
 #include "version.h"
 #include "z_zone.h"
 
 #define SAVEGAME_EOF    0x1D
 
-FILE    *save_stream;
+// [BH] Since v2.3.3, everything after the header is stored in chunks, each of which can be
+// compressed. A chunk starts with its id, version, compression method, and its length before
+// and after compression.
+#define SAVEGAMEHEADERSIZE      (SAVESTRINGSIZE + VERSIONSIZE + 7)
+#define CHUNKHEADERSIZE         16
+
+#define CHUNKID(a, b, c, d)     ((a) | ((b) << 8) | ((c) << 16) | ((d) << 24))
+
+#define CHUNK_PLAYERS           CHUNKID('P', 'L', 'Y', 'R')
+#define CHUNK_WORLD             CHUNKID('W', 'R', 'L', 'D')
+#define CHUNK_THINKERS          CHUNKID('T', 'H', 'N', 'K')
+#define CHUNK_SPECIALS          CHUNKID('S', 'P', 'E', 'C')
+#define CHUNK_MAP               CHUNKID('M', 'A', 'P', ' ')
+#define CHUNK_END               CHUNKID('E', 'N', 'D', ' ')
+
+#define CHUNKVERSION            1
+
+#define CHUNK_STORED            0
+#define CHUNK_LZ                1
+
+MEMFILE *save_stream;
 int     savegamelength;
 
-void P_SpawnShadow(mobj_t *actor);
+static dboolean savegamechunks;         // false when loading a savegame from before v2.3.3
+static long     savegamepadbase;        // where padding is measured from
+static long     chunkstart;
+static MEMFILE  *savegamefile;
+static byte     *chunkbuffer;
+
 
 // Get the filename of a temporary file to write the savegame to. After
 // the file has been successfully saved, it will be renamed to the
@@ -87,60 +113,64 @@ char *P_SaveGameFile(int slot)
 }
 
 // Endian-safe integer read/write functions
+// [BH] Savegames are written to and read from memory, and only written to disk once they are
+// complete, so these don't go through stdio.
 static byte saveg_read8(void)
 {
-    byte        result;
+    byte        result = 0;
 
-    fread(&result, 1, 1, save_stream);
+    mem_fread(&result, 1, 1, save_stream);
 
     return result;
 }
 
 static void saveg_write8(byte value)
 {
-    fwrite(&value, 1, 1, save_stream);
+    mem_fwrite(&value, 1, 1, save_stream);
 }
 
 static short saveg_read16(void)
 {
-    int result;
+    byte        data[2] = { 0 };
 
-    result = saveg_read8();
-    result |= saveg_read8() << 8;
+    mem_fread(data, 1, 2, save_stream);
 
-    return result;
+    return (data[0] | (data[1] << 8));
 }
 
 static void saveg_write16(short value)
 {
-    saveg_write8(value & 0xFF);
-    saveg_write8((value >> 8) & 0xFF);
+    byte        data[2];
+
+    data[0] = value & 0xFF;
+    data[1] = (value >> 8) & 0xFF;
+    mem_fwrite(data, 1, 2, save_stream);
 }
 
 static int saveg_read32(void)
 {
-    int result;
+    byte        data[4] = { 0 };
 
-    result = saveg_read8();
-    result |= saveg_read8() << 8;
-    result |= saveg_read8() << 16;
-    result |= saveg_read8() << 24;
+    mem_fread(data, 1, 4, save_stream);
 
-    return result;
+    return (data[0] | (data[1] << 8) | (data[2] << 16) | (data[3] << 24));
 }
 
 static void saveg_write32(int value)
 {
-    saveg_write8(value & 0xFF);
-    saveg_write8((value >> 8) & 0xFF);
-    saveg_write8((value >> 16) & 0xFF);
-    saveg_write8((value >> 24) & 0xFF);
+    byte        data[4];
+
+    data[0] = value & 0xFF;
+    data[1] = (value >> 8) & 0xFF;
+    data[2] = (value >> 16) & 0xFF;
+    data[3] = (value >> 24) & 0xFF;
+    mem_fwrite(data, 1, 4, save_stream);
 }
 
 // Pad to 4-byte boundaries
 static void saveg_read_pad(void)
 {
-    unsigned long       pos = ftell(save_stream);
+    unsigned long       pos = mem_ftell(save_stream) - savegamepadbase;
     int                 padding = (4 - (pos & 3)) & 3;
     int                 i;
 
@@ -150,7 +180,7 @@ static void saveg_read_pad(void)
 
 static void saveg_write_pad(void)
 {
-    unsigned long       pos = ftell(save_stream);
+    unsigned long       pos = mem_ftell(save_stream) - savegamepadbase;
     int                 padding = (4 - (pos & 3)) & 3;
     int                 i;
 
@@ -349,9 +379,6 @@ static void saveg_read_mobj_t(mobj_t *str)
     // int bloodsplats
     str->bloodsplats = saveg_read32();
 
-    // struct mobj_s *shadow
-    str->shadow = NULL;
-
     // int blood
     str->blood = saveg_read32();
 
@@ -377,148 +404,366 @@ static void saveg_read_mobj_t(mobj_t *str)
     str->id = saveg_read32();
 }
 
-static void saveg_write_mobj_t(mobj_t *str)
+//
+// [BH] Since v2.3.3, each mobj is written as its type and position, followed by a set of bits
+// for the other fields that differ from what they are when that type of mobj is spawned, and
+// then just those fields. Fields that are always recreated when loading aren't written at all.
+//
+#define MOBJ_STATE          0x00000001
+#define MOBJ_TICS           0x00000002
+#define MOBJ_SPRITE         0x00000004
+#define MOBJ_FRAME          0x00000008
+#define MOBJ_ANGLE          0x00000010
+#define MOBJ_FLOORZ         0x00000020
+#define MOBJ_CEILINGZ       0x00000040
+#define MOBJ_DROPOFFZ       0x00000080
+#define MOBJ_RADIUS         0x00000100
+#define MOBJ_HEIGHT         0x00000200
+#define MOBJ_PASSHEIGHT     0x00000400
+#define MOBJ_MOMENTUM       0x00000800
+#define MOBJ_FLAGS          0x00001000
+#define MOBJ_FLAGS2         0x00002000
+#define MOBJ_HEALTH         0x00004000
+#define MOBJ_MOVEMENT       0x00008000
+#define MOBJ_TARGET         0x00010000
+#define MOBJ_REACTIONTIME   0x00020000
+#define MOBJ_THRESHOLD      0x00040000
+#define MOBJ_PLAYER         0x00080000
+#define MOBJ_SPAWNPOINT     0x00100000
+#define MOBJ_TRACER         0x00200000
+#define MOBJ_LASTENEMY      0x00400000
+#define MOBJ_FLOATBOB       0x00800000
+#define MOBJ_GEAR           0x01000000
+#define MOBJ_BLOODSPLATS    0x02000000
+#define MOBJ_BLOOD          0x04000000
+#define MOBJ_INTERP         0x08000000
+#define MOBJ_OLDPOSITION    0x10000000
+#define MOBJ_PITCH          0x20000000
+#define MOBJ_ID             0x40000000
+
+static void saveg_read_compact_mobj_t(mobj_t *str)
+{
+    mobjinfo_t  *info;
+    int         fields;
+
+    // mobjtype_t type
+    str->type = (mobjtype_t)saveg_read_enum();
+    info = &mobjinfo[str->type];
+
+    fields = saveg_read32();
+
+    // fixed_t x, y and z
+    str->x = saveg_read32();
+    str->y = saveg_read32();
+    str->z = saveg_read32();
+
+    str->snext = NULL;
+    str->sprev = NULL;
+    str->bnext = NULL;
+    str->bprev = NULL;
+    str->subsector = NULL;
+    str->info = NULL;
+    str->touching_sectorlist = NULL;
+
+    str->state = &states[(fields & MOBJ_STATE) ? saveg_read32() : info->spawnstate];
+    str->tics = ((fields & MOBJ_TICS) ? saveg_read32() : str->state->tics);
+    str->sprite = ((fields & MOBJ_SPRITE) ? (spritenum_t)saveg_read_enum() : str->state->sprite);
+    str->frame = ((fields & MOBJ_FRAME) ? saveg_read32() : str->state->frame);
+    str->angle = ((fields & MOBJ_ANGLE) ? saveg_read32() : 0);
+    str->floorz = ((fields & MOBJ_FLOORZ) ? saveg_read32() : str->z);
+    str->ceilingz = ((fields & MOBJ_CEILINGZ) ? saveg_read32() : 0);
+    str->dropoffz = ((fields & MOBJ_DROPOFFZ) ? saveg_read32() : str->floorz);
+    str->radius = ((fields & MOBJ_RADIUS) ? saveg_read32() : info->radius);
+    str->height = ((fields & MOBJ_HEIGHT) ? saveg_read32() : info->height);
+    str->projectilepassheight = ((fields & MOBJ_PASSHEIGHT) ? saveg_read32() :
+        info->projectilepassheight);
+
+    if (fields & MOBJ_MOMENTUM)
+    {
+        str->momx = saveg_read32();
+        str->momy = saveg_read32();
+        str->momz = saveg_read32();
+    }
+    else
+    {
+        str->momx = 0;
+        str->momy = 0;
+        str->momz = 0;
+    }
+
+    str->flags = ((fields & MOBJ_FLAGS) ? saveg_read32() : info->flags);
+    str->flags2 = ((fields & MOBJ_FLAGS2) ? saveg_read32() : info->flags2);
+    str->health = ((fields & MOBJ_HEALTH) ? saveg_read32() : info->spawnhealth);
+
+    if (fields & MOBJ_MOVEMENT)
+    {
+        str->movedir = saveg_read32();
+        str->movecount = saveg_read32();
+    }
+    else
+    {
+        str->movedir = 0;
+        str->movecount = 0;
+    }
+
+    str->target = (mobj_t *)(intptr_t)((fields & MOBJ_TARGET) ? saveg_read32() : 0);
+    str->reactiontime = ((fields & MOBJ_REACTIONTIME) ? saveg_read32() : info->reactiontime);
+    str->threshold = ((fields & MOBJ_THRESHOLD) ? saveg_read32() : 0);
+
+    if (fields & MOBJ_PLAYER)
+    {
+        str->player = &players[saveg_read32() - 1];
+        str->player->mo = str;
+    }
+    else
+        str->player = NULL;
+
+    if (fields & MOBJ_SPAWNPOINT)
+        saveg_read_mapthing_t(&str->spawnpoint);
+    else
+        memset(&str->spawnpoint, 0, sizeof(str->spawnpoint));
+
+    str->tracer = (mobj_t *)(intptr_t)((fields & MOBJ_TRACER) ? saveg_read32() : 0);
+    str->lastenemy = (mobj_t *)(intptr_t)((fields & MOBJ_LASTENEMY) ? saveg_read32() : 0);
+    str->floatbob = ((fields & MOBJ_FLOATBOB) ? saveg_read32() : 0);
+    str->gear = ((fields & MOBJ_GEAR) ? saveg_read16() : 0);
+    str->bloodsplats = ((fields & MOBJ_BLOODSPLATS) ? saveg_read32() : 0);
+    str->blood = ((fields & MOBJ_BLOOD) ? saveg_read32() : info->blood);
+    str->interp = ((fields & MOBJ_INTERP) ? saveg_read32() : false);
+
+    if (fields & MOBJ_OLDPOSITION)
+    {
+        str->oldx = saveg_read32();
+        str->oldy = saveg_read32();
+        str->oldz = saveg_read32();
+        str->oldangle = saveg_read32();
+    }
+    else
+    {
+        str->oldx = str->x;
+        str->oldy = str->y;
+        str->oldz = str->z;
+        str->oldangle = str->angle;
+    }
+
+    str->pitch = ((fields & MOBJ_PITCH) ? saveg_read32() : NORM_PITCH);
+    str->id = ((fields & MOBJ_ID) ? saveg_read32() : 0);
+}
+
+static void saveg_write_compact_mobj_t(mobj_t *str)
 {
-    // fixed_t x
-    saveg_write32(str->x);
+    mobjinfo_t  *info = &mobjinfo[str->type];
+    int         target = P_ThinkerToIndex((thinker_t *)str->target);
+    int         tracer = P_ThinkerToIndex((thinker_t *)str->tracer);
+    int         lastenemy = P_ThinkerToIndex((thinker_t *)str->lastenemy);
+    int         state = str->state - states;
+    int         fields = 0;
 
-    // fixed_t y
-    saveg_write32(str->y);
+    if (state != info->spawnstate)
+        fields |= MOBJ_STATE;
 
-    // fixed_t z
-    saveg_write32(str->z);
+    if (str->tics != str->state->tics)
+        fields |= MOBJ_TICS;
 
-    // struct mobj_s *snext
-    saveg_writep(str->snext);
+    if (str->sprite != str->state->sprite)
+        fields |= MOBJ_SPRITE;
 
-    // struct mobj_s *sprev
-    saveg_writep(str->sprev);
+    if (str->frame != str->state->frame)
+        fields |= MOBJ_FRAME;
 
-    // angle_t angle
-    saveg_write32(str->angle);
+    if (str->angle)
+        fields |= MOBJ_ANGLE;
 
-    // spritenum_t sprite
-    saveg_write_enum(str->sprite);
+    if (str->floorz != str->z)
+        fields |= MOBJ_FLOORZ;
 
-    // int frame
-    saveg_write32(str->frame);
+    if (str->ceilingz)
+        fields |= MOBJ_CEILINGZ;
 
-    // struct mobj_s *bnext
-    saveg_writep(str->bnext);
+    if (str->dropoffz != str->floorz)
+        fields |= MOBJ_DROPOFFZ;
 
-    // struct mobj_s *bprev
-    saveg_writep(str->bprev);
+    if (str->radius != info->radius)
+        fields |= MOBJ_RADIUS;
 
-    // struct subsector_s *subsector
-    saveg_writep(str->subsector);
+    if (str->height != info->height)
+        fields |= MOBJ_HEIGHT;
 
-    // fixed_t floorz
-    saveg_write32(str->floorz);
+    if (str->projectilepassheight != info->projectilepassheight)
+        fields |= MOBJ_PASSHEIGHT;
 
-    // fixed_t ceilingz
-    saveg_write32(str->ceilingz);
+    if (str->momx || str->momy || str->momz)
+        fields |= MOBJ_MOMENTUM;
 
-    // fixed_t dropoffz
-    saveg_write32(str->dropoffz);
+    if (str->flags != info->flags)
+        fields |= MOBJ_FLAGS;
 
-    // fixed_t radius;
-    saveg_write32(str->radius);
+    if (str->flags2 != info->flags2)
+        fields |= MOBJ_FLAGS2;
 
-    // fixed_t height
-    saveg_write32(str->height);
+    if (str->health != info->spawnhealth)
+        fields |= MOBJ_HEALTH;
 
-    // fixed_t projectilepassheight
-    saveg_write32(str->projectilepassheight);
+    if (str->movedir || str->movecount)
+        fields |= MOBJ_MOVEMENT;
 
-    // fixed_t momx
-    saveg_write32(str->momx);
+    if (target)
+        fields |= MOBJ_TARGET;
 
-    // fixed_t momy
-    saveg_write32(str->momy);
+    if (str->reactiontime != info->reactiontime)
+        fields |= MOBJ_REACTIONTIME;
 
-    // fixed_t momz
-    saveg_write32(str->momz);
+    if (str->threshold)
+        fields |= MOBJ_THRESHOLD;
+
+    if (str->player)
+        fields |= MOBJ_PLAYER;
+
+    if (str->spawnpoint.x || str->spawnpoint.y || str->spawnpoint.angle || str->spawnpoint.type
+        || str->spawnpoint.options)
+        fields |= MOBJ_SPAWNPOINT;
+
+    if (tracer)
+        fields |= MOBJ_TRACER;
+
+    if (lastenemy)
+        fields |= MOBJ_LASTENEMY;
+
+    if (str->floatbob)
+        fields |= MOBJ_FLOATBOB;
+
+    if (str->gear)
+        fields |= MOBJ_GEAR;
+
+    if (str->bloodsplats)
+        fields |= MOBJ_BLOODSPLATS;
+
+    if (str->blood != info->blood)
+        fields |= MOBJ_BLOOD;
+
+    if (str->interp)
+        fields |= MOBJ_INTERP;
+
+    if (str->oldx != str->x || str->oldy != str->y || str->oldz != str->z
+        || str->oldangle != str->angle)
+        fields |= MOBJ_OLDPOSITION;
+
+    if (str->pitch != NORM_PITCH)
+        fields |= MOBJ_PITCH;
+
+    if (str->id)
+        fields |= MOBJ_ID;
 
-    // mobjtype_t type
     saveg_write_enum(str->type);
+    saveg_write32(fields);
+    saveg_write32(str->x);
+    saveg_write32(str->y);
+    saveg_write32(str->z);
 
-    // mobjinfo_t *info
-    saveg_writep(str->info);
+    if (fields & MOBJ_STATE)
+        saveg_write32(state);
 
-    // int tics
-    saveg_write32(str->tics);
+    if (fields & MOBJ_TICS)
+        saveg_write32(str->tics);
 
-    // state_t *state
-    saveg_write32(str->state - states);
+    if (fields & MOBJ_SPRITE)
+        saveg_write_enum(str->sprite);
 
-    // int flags
-    saveg_write32(str->flags);
+    if (fields & MOBJ_FRAME)
+        saveg_write32(str->frame);
 
-    // int flags2
-    saveg_write32(str->flags2);
+    if (fields & MOBJ_ANGLE)
+        saveg_write32(str->angle);
 
-    // int health
-    saveg_write32(str->health);
+    if (fields & MOBJ_FLOORZ)
+        saveg_write32(str->floorz);
 
-    // int movedir
-    saveg_write32(str->movedir);
+    if (fields & MOBJ_CEILINGZ)
+        saveg_write32(str->ceilingz);
 
-    // int movecount
-    saveg_write32(str->movecount);
+    if (fields & MOBJ_DROPOFFZ)
+        saveg_write32(str->dropoffz);
 
-    // struct mobj_s *target
-    saveg_writep((void *)(uintptr_t)P_ThinkerToIndex((thinker_t *)str->target));
+    if (fields & MOBJ_RADIUS)
+        saveg_write32(str->radius);
 
-    // int reactiontime
-    saveg_write32(str->reactiontime);
+    if (fields & MOBJ_HEIGHT)
+        saveg_write32(str->height);
 
-    // int threshold
-    saveg_write32(str->threshold);
+    if (fields & MOBJ_PASSHEIGHT)
+        saveg_write32(str->projectilepassheight);
 
-    // struct player_s *player
-    saveg_write32(str->player ? str->player - players + 1 : 0);
+    if (fields & MOBJ_MOMENTUM)
+    {
+        saveg_write32(str->momx);
+        saveg_write32(str->momy);
+        saveg_write32(str->momz);
+    }
 
-    // mapthing_t spawnpoint
-    saveg_write_mapthing_t(&str->spawnpoint);
+    if (fields & MOBJ_FLAGS)
+        saveg_write32(str->flags);
 
-    // struct mobj_s *tracer
-    saveg_writep((void *)(uintptr_t)P_ThinkerToIndex((thinker_t *)str->tracer));
+    if (fields & MOBJ_FLAGS2)
+        saveg_write32(str->flags2);
 
-    // struct mobj_s *lastenemy
-    saveg_writep((void *)(uintptr_t)P_ThinkerToIndex((thinker_t *)str->lastenemy));
+    if (fields & MOBJ_HEALTH)
+        saveg_write32(str->health);
 
-    // int floatbob
-    saveg_write32(str->floatbob);
+    if (fields & MOBJ_MOVEMENT)
+    {
+        saveg_write32(str->movedir);
+        saveg_write32(str->movecount);
+    }
 
-    // short gear
-    saveg_write16(str->gear);
+    if (fields & MOBJ_TARGET)
+        saveg_write32(target);
 
-    // int bloodsplats
-    saveg_write32(str->bloodsplats);
+    if (fields & MOBJ_REACTIONTIME)
+        saveg_write32(str->reactiontime);
 
-    // int blood
-    saveg_write32(str->blood);
+    if (fields & MOBJ_THRESHOLD)
+        saveg_write32(str->threshold);
 
-    // dboolean interp
-    saveg_write32(str->interp);
+    if (fields & MOBJ_PLAYER)
+        saveg_write32(str->player - players + 1);
 
-    // int oldx
-    saveg_write32(str->oldx);
+    if (fields & MOBJ_SPAWNPOINT)
+        saveg_write_mapthing_t(&str->spawnpoint);
 
-    // int oldy
-    saveg_write32(str->oldy);
+    if (fields & MOBJ_TRACER)
+        saveg_write32(tracer);
 
-    // int oldz
-    saveg_write32(str->oldz);
+    if (fields & MOBJ_LASTENEMY)
+        saveg_write32(lastenemy);
 
-    // angle_t oldangle
-    saveg_write32(str->oldangle);
+    if (fields & MOBJ_FLOATBOB)
+        saveg_write32(str->floatbob);
 
-    // int pitch
-    saveg_write32(str->pitch);
+    if (fields & MOBJ_GEAR)
+        saveg_write16(str->gear);
 
-    // int id
-    saveg_write32(str->id);
+    if (fields & MOBJ_BLOODSPLATS)
+        saveg_write32(str->bloodsplats);
+
+    if (fields & MOBJ_BLOOD)
+        saveg_write32(str->blood);
+
+    if (fields & MOBJ_INTERP)
+        saveg_write32(str->interp);
+
+    if (fields & MOBJ_OLDPOSITION)
+    {
+        saveg_write32(str->oldx);
+        saveg_write32(str->oldy);
+        saveg_write32(str->oldz);
+        saveg_write32(str->oldangle);
+    }
+
+    if (fields & MOBJ_PITCH)
+        saveg_write32(str->pitch);
+
+    if (fields & MOBJ_ID)
+        saveg_write32(str->id);
 }
 
 //
@@ -798,7 +1043,9 @@ static void saveg_write_player_t(player_t *str)
     int i;
 
     // mobj_t *mo
-    saveg_writep(str->mo);
+    // [BH] these pointers are never read back, so they are written as NULL to keep the
+    //  archive of the same game the same
+    saveg_writep(NULL);
 
     // playerstate_t playerstate
     saveg_write_enum(str->playerstate);
@@ -893,7 +1140,7 @@ static void saveg_write_player_t(player_t *str)
     saveg_write32(str->secretcount);
 
     // char *message
-    saveg_writep(str->message);
+    saveg_writep(NULL);
 
     // int damagecount
     saveg_write32(str->damagecount);
@@ -902,7 +1149,7 @@ static void saveg_write_player_t(player_t *str)
     saveg_write32(str->bonuscount);
 
     // mobj_t *attacker
-    saveg_writep(str->attacker);
+    saveg_writep(NULL);
 
     // int extralight
     saveg_write32(str->extralight);
@@ -1643,6 +1890,9 @@ void P_WriteSaveGameHeader(char *description)
     saveg_write8((leveltime >> 16) & 0xFF);
     saveg_write8((leveltime >> 8) & 0xFF);
     saveg_write8(leveltime & 0xFF);
+
+    savegamechunks = true;
+    savegamepadbase = 0;
 }
 
 //
@@ -1663,7 +1913,14 @@ dboolean P_ReadSaveGameHeader(char *description)
 
     memset(vcheck, 0, sizeof(vcheck));
     strcpy(vcheck, PACKAGE_SAVEGAMEVERSIONSTRING);
-    if (strcmp(read_vcheck, vcheck))
+    savegamechunks = !strcmp(read_vcheck, vcheck);
+    savegamepadbase = 0;
+
+    // [BH] savegames from before chunks were added can still be loaded
+    memset(vcheck, 0, sizeof(vcheck));
+    strcpy(vcheck, PACKAGE_OLDSAVEGAMEVERSIONSTRING);
+
+    if (!savegamechunks && strcmp(read_vcheck, vcheck))
     {
         menuactive = false;
         C_ShowConsole();
@@ -1686,11 +1943,134 @@ dboolean P_ReadSaveGameHeader(char *description)
     return true;
 }
 
+//
+// P_BeginSaveGameChunk
+// Writes the header of a chunk, to be filled in by P_EndSaveGameChunk().
+//
+static void P_BeginSaveGameChunk(int id)
+{
+    chunkstart = mem_ftell(save_stream);
+
+    saveg_write32(id);
+    saveg_write16(CHUNKVERSION);
+    saveg_write8(CHUNK_STORED);
+    saveg_write8(0);
+    saveg_write32(0);
+    saveg_write32(0);
+
+    savegamepadbase = mem_ftell(save_stream);
+}
+
+//
+// P_EndSaveGameChunk
+// Fills in the length of the chunk just written. It isn't compressed until P_PackSaveGame().
+//
+static void P_EndSaveGameChunk(void)
+{
+    long        end = mem_ftell(save_stream);
+    int         length = end - savegamepadbase;
+
+    mem_fseek(save_stream, chunkstart + 8, MEM_SEEK_SET);
+    saveg_write32(length);
+    saveg_write32(length);
+    mem_fseek(save_stream, end, MEM_SEEK_SET);
+
+    savegamepadbase = 0;
+}
+
+//
+// P_BeginLoadChunk
+// Skips ahead to the chunk with the given id, and then reads from it until
+// P_EndLoadChunk() is called.
+//
+static void P_BeginLoadChunk(int id)
+{
+    if (!savegamechunks)
+        return;
+
+    while (true)
+    {
+        int     chunkid = saveg_read32();
+        int     version = (unsigned short)saveg_read16();
+        int     compression = saveg_read8();
+        int     length;
+        int     storedlength;
+        byte    *stored;
+
+        saveg_read8();
+        length = saveg_read32();
+        storedlength = saveg_read32();
+
+        if (chunkid == CHUNK_END || length < 0 || storedlength < 0)
+            I_Error("Bad savegame");
+
+        if (chunkid != id)
+        {
+            if (mem_fseek(save_stream, storedlength, MEM_SEEK_CUR))
+                I_Error("Bad savegame");
+
+            continue;
+        }
+
+        if (version > CHUNKVERSION || (compression != CHUNK_STORED && compression != CHUNK_LZ))
+            I_Error("This savegame requires a newer version of " PACKAGE_NAME ".");
+
+        stored = malloc(storedlength + 1);
+        chunkbuffer = malloc(length + 1);
+
+        if (!stored || !chunkbuffer
+            || mem_fread(stored, 1, storedlength, save_stream) != (size_t)storedlength)
+            I_Error("Bad savegame");
+
+        if (compression == CHUNK_STORED)
+            memcpy(chunkbuffer, stored, length);
+        else if (mem_decompress(stored, storedlength, chunkbuffer, length) != (size_t)length)
+            I_Error("Bad savegame");
+
+        free(stored);
+
+        savegamefile = save_stream;
+        save_stream = mem_fopen_read(chunkbuffer, length);
+        return;
+    }
+}
+
+//
+// P_EndLoadChunk
+//
+static void P_EndLoadChunk(void)
+{
+    if (!savegamechunks)
+        return;
+
+    mem_fclose(save_stream);
+    free(chunkbuffer);
+    chunkbuffer = NULL;
+    save_stream = savegamefile;
+}
+
 //
 // Read the end of file marker. Returns true if read successfully.
 //
 dboolean P_ReadSaveGameEOF(void)
 {
+    // skip any chunks that aren't needed
+    while (savegamechunks)
+    {
+        int     id = saveg_read32();
+        int     storedlength;
+
+        saveg_read32();
+        saveg_read32();
+        storedlength = saveg_read32();
+
+        if (id == CHUNK_END)
+            break;
+
+        if (storedlength < 0 || mem_fseek(save_stream, storedlength, MEM_SEEK_CUR))
+            return false;
+    }
+
     return (saveg_read8() == SAVEGAME_EOF);
 }
 
@@ -1699,17 +2079,112 @@ dboolean P_ReadSaveGameEOF(void)
 //
 void P_WriteSaveGameEOF(void)
 {
+    P_BeginSaveGameChunk(CHUNK_END);
+    P_EndSaveGameChunk();
+
     saveg_write8(SAVEGAME_EOF);
 }
 
+static int P_ReadLong(const byte *data)
+{
+    return (data[0] | (data[1] << 8) | (data[2] << 16) | (data[3] << 24));
+}
+
+static void P_WriteLong(byte *data, int value)
+{
+    data[0] = value & 0xFF;
+    data[1] = (value >> 8) & 0xFF;
+    data[2] = (value >> 16) & 0xFF;
+    data[3] = (value >> 24) & 0xFF;
+}
+
+//
+// P_PackSaveGame
+// Compresses each chunk of a savegame that has been written to memory, and returns the result
+// in a new buffer that must be freed by the caller. Returns false if it can't, in which case
+// the savegame can still be written as it is. Doesn't use the zone memory allocator, so can be
+// called from a background thread.
+//
+dboolean P_PackSaveGame(const byte *data, size_t length, byte **packed, size_t *packedlength)
+{
+    byte        *output = malloc(length);
+    byte        *scratch = NULL;
+    size_t      scratchlength = 0;
+    size_t      in = SAVEGAMEHEADERSIZE;
+    size_t      out = SAVEGAMEHEADERSIZE;
+
+    if (!output || length < SAVEGAMEHEADERSIZE)
+    {
+        free(output);
+        return false;
+    }
+
+    memcpy(output, data, SAVEGAMEHEADERSIZE);
+
+    while (in + CHUNKHEADERSIZE <= length)
+    {
+        const byte  *header = data + in;
+        int         id = P_ReadLong(header);
+        size_t      chunklength = (size_t)P_ReadLong(header + 8);
+        size_t      compressedlength = 0;
+
+        if (id == CHUNK_END)
+        {
+            memcpy(output + out, header, length - in);
+            *packed = output;
+            *packedlength = out + length - in;
+            free(scratch);
+            return true;
+        }
+
+        if (header[6] != CHUNK_STORED || chunklength > length - in - CHUNKHEADERSIZE)
+            break;
+
+        if (scratchlength < mem_compress_bound(chunklength))
+        {
+            free(scratch);
+            scratchlength = mem_compress_bound(chunklength);
+
+            if (!(scratch = malloc(scratchlength)))
+                break;
+        }
+
+        compressedlength = mem_compress(header + CHUNKHEADERSIZE, chunklength, scratch, scratchlength);
+        memcpy(output + out, header, CHUNKHEADERSIZE);
+
+        if (compressedlength && compressedlength < chunklength)
+        {
+            output[out + 6] = CHUNK_LZ;
+            P_WriteLong(output + out + 12, (int)compressedlength);
+            memcpy(output + out + CHUNKHEADERSIZE, scratch, compressedlength);
+        }
+        else
+        {
+            compressedlength = chunklength;
+            memcpy(output + out + CHUNKHEADERSIZE, header + CHUNKHEADERSIZE, chunklength);
+        }
+
+        in += CHUNKHEADERSIZE + chunklength;
+        out += CHUNKHEADERSIZE + compressedlength;
+    }
+
+    free(scratch);
+    free(output);
+    return false;
+}
+
 //
 // P_ArchivePlayers
 //
 void P_ArchivePlayers(void)
 {
+    P_BeginSaveGameChunk(CHUNK_PLAYERS);
+
     saveg_write_pad();
 
     saveg_write_player_t(&players[0]);
+
+    P_EndSaveGameChunk();
 }
 
 //
@@ -1717,12 +2192,16 @@ void P_ArchivePlayers(void)
 //
 void P_UnArchivePlayers(void)
 {
+    P_BeginLoadChunk(CHUNK_PLAYERS);
+
     saveg_read_pad();
 
     P_InitCards(&players[0]);
 
     saveg_read_player_t(&players[0]);
 
+    P_EndLoadChunk();
+
     // will be set when unarchiving thinker
     players[0].mo = NULL;
     players[0].message = NULL;
@@ -1740,6 +2219,8 @@ void P_ArchiveWorld(void)
     line_t      *li;
     side_t      *si;
 
+    P_BeginSaveGameChunk(CHUNK_WORLD);
+
     // do sectors
     for (i = 0, sec = sectors; i < numsectors; i++, sec++)
     {
@@ -1772,6 +2253,8 @@ void P_ArchiveWorld(void)
             saveg_write16(si->midtexture);
         }
     }
+
+    P_EndSaveGameChunk();
 }
 
 //
@@ -1785,11 +2268,29 @@ void P_UnArchiveWorld(void)
     line_t      *li;
     side_t      *si;
 
+    P_BeginLoadChunk(CHUNK_WORLD);
+
     // do sectors
     for (i = 0, sec = sectors; i < numsectors; i++, sec++)
     {
-        sec->floorheight = saveg_read16() << FRACBITS;
-        sec->ceilingheight = saveg_read16() << FRACBITS;
+        fixed_t floorheight = saveg_read16() << FRACBITS;
+        fixed_t ceilingheight = saveg_read16() << FRACBITS;
+
+        if (floorheight != sec->floorheight || ceilingheight != sec->ceilingheight)
+        {
+            sec->floorheight = floorheight;
+            sec->ceilingheight = ceilingheight;
+            sec->moved = true;
+
+            // don't interpolate from where the sector was before it was restored
+            sec->oldfloorheight = floorheight;
+            sec->interpfloorheight = floorheight;
+            sec->oldceilingheight = ceilingheight;
+            sec->interpceilingheight = ceilingheight;
+        }
+
+        sec->neighborheightsvalid = false;
+
         sec->floorpic = saveg_read16();
         sec->ceilingpic = saveg_read16();
         sec->lightlevel = saveg_read16();
@@ -1821,6 +2322,8 @@ void P_UnArchiveWorld(void)
             si->midtexture = saveg_read16();
         }
     }
+
+    P_EndLoadChunk();
 }
 
 //
@@ -1833,6 +2336,69 @@ typedef enum
     tc_bloodsplat
 } thinkerclass_t;
 
+//
+// THINKER INDEXES
+// [BH] Mobjs are referred to in savegames by their position in the list of mobjs. Rather than
+// searching the list for every reference, it's numbered once into a table before the mobjs are
+// archived or their targets restored, along with a hash table to find each mobj's number.
+//
+static thinker_t    **indexthinkers;    // mobjs by their number, starting from 1
+static uint32_t     *thinkerhash;       // numbers of the mobjs, hashed by their address
+static uint32_t     thinkerhashmask;
+static uint32_t     numindexthinkers;
+
+static uint32_t P_HashThinker(thinker_t *thinker)
+{
+    return ((uint32_t)((uintptr_t)thinker >> 4) * 2654435761u) & thinkerhashmask;
+}
+
+static void P_FreeThinkerIndex(void)
+{
+    free(indexthinkers);
+    free(thinkerhash);
+    indexthinkers = NULL;
+    thinkerhash = NULL;
+    numindexthinkers = 0;
+}
+
+static void P_BuildThinkerIndex(void)
+{
+    thinker_t   *th;
+    uint32_t    size = 1;
+    uint32_t    i = 0;
+
+    for (th = thinkerclasscap[th_mobj].cnext; th != &thinkerclasscap[th_mobj]; th = th->cnext)
+        ++i;
+
+    while (size < i * 2)
+        size <<= 1;
+
+    if (!(indexthinkers = malloc((i + 1) * sizeof(*indexthinkers)))
+        || !(thinkerhash = calloc(size, sizeof(*thinkerhash))))
+    {
+        // fall back to searching the list
+        P_FreeThinkerIndex();
+        return;
+    }
+
+    numindexthinkers = i;
+    thinkerhashmask = size - 1;
+    indexthinkers[0] = NULL;
+    i = 0;
+
+    for (th = thinkerclasscap[th_mobj].cnext; th != &thinkerclasscap[th_mobj]; th = th->cnext)
+    {
+        uint32_t    hash = P_HashThinker(th);
+
+        indexthinkers[++i] = th;
+
+        while (thinkerhash[hash])
+            hash = (hash + 1) & thinkerhashmask;
+
+        thinkerhash[hash] = i;
+    }
+}
+
 //
 // P_ArchiveThinkers
 //
@@ -1841,33 +2407,49 @@ void P_ArchiveThinkers(void)
     thinker_t   *th;
     int         i;
 
+    P_BeginSaveGameChunk(CHUNK_THINKERS);
+    P_BuildThinkerIndex();
+
     // save off the current thinkers
     for (th = thinkerclasscap[th_mobj].cnext; th != &thinkerclasscap[th_mobj]; th = th->cnext)
     {
         saveg_write8(tc_mobj);
         saveg_write_pad();
-        saveg_write_mobj_t((mobj_t *)th);
+        saveg_write_compact_mobj_t((mobj_t *)th);
     }
 
-    // save off the bloodsplats
+    P_FreeThinkerIndex();
+
+    // save off the bloodsplats, oldest first so they are in the same order once added back
     for (i = 0; i < numsectors; ++i)
     {
-        mobj_t   *mo = sectors[i].thinglist;
+        bloodsplat_t    *splat = sectors[i].splatlist;
+
+        if (!splat)
+            continue;
+
+        while (splat->snext)
+            splat = splat->snext;
 
-        while (mo)
+        while (1)
         {
-            if (mo->type == MT_BLOODSPLAT)
-            {
-                saveg_write8(tc_bloodsplat);
-                saveg_write_pad();
-                saveg_write_mobj_t(mo);
-            }
-            mo = mo->snext;
+            saveg_write8(tc_bloodsplat);
+            saveg_write32(splat->x);
+            saveg_write32(splat->y);
+            saveg_write32(splat->blood);
+            saveg_write32(splat->frame);
+
+            if (splat->sprev == &sectors[i].splatlist)
+                break;
+
+            splat = (bloodsplat_t *)((byte *)splat->sprev - offsetof(bloodsplat_t, snext));
         }
     }
 
     // add a terminating marker
     saveg_write8(tc_end);
+
+    P_EndSaveGameChunk();
 }
 
 //
@@ -1888,40 +2470,40 @@ static void P_SetNewTarget(mobj_t **mop, mobj_t *targ)
 //
 void P_UnArchiveThinkers(void)
 {
-    thinker_t   *currentthinker = thinkercap.next;
+    thinker_t   *currentthinker;
     thinker_t   *next;
+    int         savediquehead = iquehead;
+    int         savediquetail = iquetail;
     int i;
 
-    // remove all the current thinkers
-    while (currentthinker != &thinkercap)
+    // unlink all the current mobjs from the map
+    for (currentthinker = thinkercap.next; currentthinker != &thinkercap;
+        currentthinker = currentthinker->next)
+        if (currentthinker->function == P_MobjThinker)
+            P_RemoveMobj((mobj_t *)currentthinker);
+
+    // [BH] the items removed above weren't picked up, so don't respawn them
+    iquehead = savediquehead;
+    iquetail = savediquetail;
+
+    // then free all the current thinkers, including those already waiting to be removed
+    for (currentthinker = thinkercap.next; currentthinker != &thinkercap; currentthinker = next)
     {
         next = currentthinker->next;
 
-        if (currentthinker->function == P_MobjThinker)
-        {
-            P_RemoveMobj((mobj_t *)currentthinker);
-            P_RemoveThinkerDelayed(currentthinker);     // fix mobj leak
-        }
+        if (currentthinker->function == P_MobjThinker || currentthinker->function == P_RemoveMobjDelayed)
+            P_FreeMobj((mobj_t *)currentthinker);
         else
             Z_Free(currentthinker);
-
-        currentthinker = next;
     }
 
     P_InitThinkers();
 
-    // remove the remaining bloodsplats and shadows
+    // remove the remaining bloodsplats
     for (i = 0; i < numsectors; ++i)
-    {
-        mobj_t   *mo = sectors[i].thinglist;
+        P_RemoveBloodSplats(&sectors[i]);
 
-        while (mo)
-        {
-            P_RemoveMobj(mo);
-            mo = mo->snext;
-        }
-    }
-    r_bloodsplats_total = 0;
+    P_BeginLoadChunk(CHUNK_THINKERS);
 
     // read in saved thinkers
     while (1)
@@ -1932,52 +2514,49 @@ void P_UnArchiveThinkers(void)
         switch (tclass)
         {
             case tc_end:
+                P_EndLoadChunk();
                 return;         // end of list
 
             case tc_mobj:
                 saveg_read_pad();
-                mobj = Z_Malloc(sizeof(*mobj), PU_LEVEL, NULL);
-                saveg_read_mobj_t(mobj);
+                mobj = P_AllocMobj();
+
+                if (savegamechunks)
+                    saveg_read_compact_mobj_t(mobj);
+                else
+                    saveg_read_mobj_t(mobj);
 
-                P_SetThingPosition(mobj);
                 mobj->info = &mobjinfo[mobj->type];
+                P_SetThingPosition(mobj);
 
                 mobj->thinker.function = P_MobjThinker;
                 mobj->colfunc = mobj->info->colfunc;
                 mobj->projectfunc = R_ProjectSprite;
 
-                if (mobj->flags2 & MF2_SHADOW)
-                {
-                    P_SpawnShadow(mobj);
-
-                    if (mobj->flags2 & MF2_MIRRORED)
-                        mobj->shadow->flags2 |= MF2_MIRRORED;
-                }
                 P_AddThinker(&mobj->thinker);
                 break;
 
             case tc_bloodsplat:
-                saveg_read_pad();
-                mobj = Z_Malloc(sizeof(*mobj), PU_LEVEL, NULL);
-                saveg_read_mobj_t(mobj);
+            {
+                mobj_t  splat;
 
-                if (r_bloodsplats_total < r_bloodsplats_max)
+                if (savegamechunks)
+                {
+                    splat.x = saveg_read32();
+                    splat.y = saveg_read32();
+                    splat.blood = saveg_read32();
+                    splat.frame = saveg_read32();
+                }
+                else
                 {
-                    P_SetThingPosition(mobj);
-                    mobj->info = &mobjinfo[mobj->type];
-
-                    if (mobj->blood == FUZZYBLOOD)
-                    {
-                        mobj->flags = MF_FUZZ;
-                        mobj->colfunc = fuzzcolfunc;
-                    }
-                    else
-                        mobj->colfunc = bloodsplatcolfunc;
-                    mobj->projectfunc = R_ProjectBloodSplat;
-
-                    ++r_bloodsplats_total;
+                    saveg_read_pad();
+                    saveg_read_mobj_t(&splat);
                 }
+
+                P_AddBloodSplat(R_PointInSubsector(splat.x, splat.y)->sector, splat.x, splat.y,
+                    splat.blood, splat.frame);
                 break;
+            }
 
             default:
                 I_Error("P_UnArchiveThinkers: Unknown tclass %i in savegame", tclass);
@@ -1994,6 +2573,22 @@ uint32_t P_ThinkerToIndex(thinker_t *thinker)
     if (!thinker)
         return 0;
 
+    if (thinkerhash)
+    {
+        uint32_t    hash = P_HashThinker(thinker);
+
+        // a mobj that isn't in the list, such as one that has been removed, has no number
+        while ((i = thinkerhash[hash]))
+        {
+            if (indexthinkers[i] == thinker)
+                return i;
+
+            hash = (hash + 1) & thinkerhashmask;
+        }
+
+        return 0;
+    }
+
     for (th = thinkerclasscap[th_mobj].cnext; th != &thinkerclasscap[th_mobj]; th = th->cnext)
     {
         ++i;
@@ -2012,6 +2607,9 @@ thinker_t *P_IndexToThinker(uint32_t index)
     if (!index)
         return NULL;
 
+    if (indexthinkers)
+        return (index <= numindexthinkers ? indexthinkers[index] : NULL);
+
     for (th = thinkerclasscap[th_mobj].cnext; th != &thinkerclasscap[th_mobj]; th = th->cnext)
         if (++i == index)
             return th;
@@ -2023,6 +2621,8 @@ void P_RestoreTargets(void)
 {
     thinker_t   *th;
 
+    P_BuildThinkerIndex();
+
     for (th = thinkerclasscap[th_mobj].cnext; th != &thinkerclasscap[th_mobj]; th = th->cnext)
     {
         mobj_t      *mo = (mobj_t *)th;
@@ -2031,6 +2631,8 @@ void P_RestoreTargets(void)
         P_SetNewTarget(&mo->tracer, (mobj_t *)P_IndexToThinker((uintptr_t)mo->tracer));
         P_SetNewTarget(&mo->lastenemy, (mobj_t *)P_IndexToThinker((uintptr_t)mo->lastenemy));
     }
+
+    P_FreeThinkerIndex();
 }
 
 //
@@ -2059,6 +2661,8 @@ void P_ArchiveSpecials(void)
     int         i;
     button_t    *button_ptr;
 
+    P_BeginSaveGameChunk(CHUNK_SPECIALS);
+
     // save off the current thinkers
     for (th = thinkerclasscap[th_misc].cnext; th != &thinkerclasscap[th_misc]; th = th->cnext)
     {
@@ -2198,6 +2802,8 @@ void P_ArchiveSpecials(void)
 
     // add a terminating marker
     saveg_write8(tc_endspecials);
+
+    P_EndSaveGameChunk();
 }
 
 void P_StartButton(line_t *line, bwhere_e w, int texture, int time);
@@ -2218,7 +2824,17 @@ void P_UnArchiveSpecials(void)
     elevator_t          *elevator;
     scroll_t            *scroll;
     pusher_t            *pusher;
-    button_t            *button;
+    button_t            button;
+    int                 i;
+
+    // the thinkers these referred to have already been freed by P_UnArchiveThinkers()
+    P_RemoveAllActiveCeilings();
+    P_RemoveAllActivePlats();
+
+    for (i = 0; i < MAXBUTTONS; i++)
+        memset(&buttonlist[i], 0, sizeof(button_t));
+
+    P_BeginLoadChunk(CHUNK_SPECIALS);
 
     // read in saved thinkers
     while (1)
@@ -2228,6 +2844,7 @@ void P_UnArchiveSpecials(void)
         switch (tclass)
         {
             case tc_endspecials:
+                P_EndLoadChunk();
                 return;          // end of list
 
             case tc_ceiling:
@@ -2327,9 +2944,8 @@ void P_UnArchiveSpecials(void)
 
             case tc_button:
                 saveg_read_pad();
-                button = Z_Malloc(sizeof(*button), PU_LEVEL, NULL);
-                saveg_read_button_t(button);
-                P_StartButton(button->line, button->where, button->btexture, button->btimer);
+                saveg_read_button_t(&button);
+                P_StartButton(button.line, button.where, button.btexture, button.btimer);
                 break;
 
             default:
@@ -2343,6 +2959,8 @@ void P_UnArchiveSpecials(void)
 //
 void P_ArchiveMap(void)
 {
+    P_BeginSaveGameChunk(CHUNK_MAP);
+
     saveg_write32(automapactive);
     saveg_write32(markpointnum);
     saveg_write32(pathpointnum);
@@ -2368,6 +2986,8 @@ void P_ArchiveMap(void)
             saveg_write32(pathpoints[i].y);
         }
     }
+
+    P_EndSaveGameChunk();
 }
 
 //
@@ -2375,6 +2995,8 @@ void P_ArchiveMap(void)
 //
 void P_UnArchiveMap(void)
 {
+    P_BeginLoadChunk(CHUNK_MAP);
+
     automapactive = saveg_read32();
     markpointnum = saveg_read32();
     pathpointnum = saveg_read32();
@@ -2415,4 +3037,6 @@ void P_UnArchiveMap(void)
             pathpoints[i].y = saveg_read32();
         }
     }
+
+    P_EndLoadChunk();
 }
@@ -39,6 +39,8 @@
 #if !defined(__P_SAVEG_H__)
 #define __P_SAVEG_H__
 
+#include "memio.h"
+
 // maximum size of a savegame description
 #define SAVESTRINGSIZE          256
 #define SAVESTRINGPIXELWIDTH    186
@@ -58,6 +60,9 @@ void P_WriteSaveGameHeader(char *description);
 dboolean P_ReadSaveGameEOF(void);
 void P_WriteSaveGameEOF(void);
 
+// Compress the chunks of a savegame written to memory
+dboolean P_PackSaveGame(const byte *data, size_t length, byte **packed, size_t *packedlength);
+
 // Persistent storage/archiving.
 // These are the load / save game routines.
 void P_ArchivePlayers(void);
@@ -75,6 +80,6 @@ uint32_t P_ThinkerToIndex(thinker_t *thinker);
 thinker_t *P_IndexToThinker(uint32_t index);
 void P_RestoreTargets(void);
 
-extern FILE     *save_stream;
+extern MEMFILE  *save_stream;
 
 #endif
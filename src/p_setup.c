@@ -37,6 +37,7 @@
 */
 
 #include <ctype.h>
+#include <math.h>
 
 #include "am_map.h"
 #include "c_console.h"
@@ -44,8 +45,10 @@
 #include "doomstat.h"
 #include "i_swap.h"
 #include "i_system.h"
+#include "i_timer.h"
 #include "m_argv.h"
 #include "m_bbox.h"
+#include "m_config.h"
 #include "m_menu.h"
 #include "m_misc.h"
 #include "m_random.h"
@@ -147,6 +150,7 @@ int             *blockmap;
 
 // offsets in blockmap are from here
 int             *blockmaplump;
+static int      blockmaplength;
 
 // origin of block map
 fixed_t         bmaporgx;
@@ -221,6 +225,8 @@ extern fixed_t  animatedliquidyoffs;
 extern menu_t   MainDef;
 extern menu_t   NewDef;
 
+extern texture_t **textures;
+
 static fixed_t GetOffset(vertex_t *v1, vertex_t *v2)
 {
     fixed_t     dx = (v1->x - v2->x) >> FRACBITS;
@@ -254,12 +260,12 @@ static void *calloc_IfSameLevel(void *p, size_t n1, size_t n2)
 }
 
 //
-// P_LoadVertexes
+// P_CacheVertexes
+// Allocates the vertices and returns the lump that P_ParseVertexes() converts.
 //
-void P_LoadVertexes(int lump)
+static const mapvertex_t *P_CacheVertexes(int lump)
 {
     const mapvertex_t   *data;
-    int                 i;
 
     // Determine number of lumps:
     //  total lump length / vertex record length.
@@ -275,6 +281,16 @@ void P_LoadVertexes(int lump)
     if (!data || !numvertexes)
         I_Error("There are no vertices in this map.");
 
+    return data;
+}
+
+//
+// P_ParseVertexes
+//
+static void P_ParseVertexes(const mapvertex_t *data)
+{
+    int i;
+
     // Copy and convert vertex coordinates,
     // internal representation as fixed.
     for (i = 0; i < numvertexes; i++)
@@ -307,9 +323,6 @@ void P_LoadVertexes(int lump)
             }
         }
     }
-
-    // Free buffer memory.
-    W_ReleaseLumpNum(lump);
 }
 
 //
@@ -616,12 +629,11 @@ static void P_LoadSegs_V4(int lump)
 }
 
 //
-// P_LoadSubsectors
+// P_CacheSubsectors
 //
-void P_LoadSubsectors(int lump)
+static const mapsubsector_t *P_CacheSubsectors(int lump)
 {
-    const mapsubsector_t        *data;
-    int                         i;
+    const mapsubsector_t    *data;
 
     sizesubsectors = W_LumpLength(lump);
     numsubsectors = sizesubsectors / sizeof(mapsubsector_t);
@@ -631,19 +643,26 @@ void P_LoadSubsectors(int lump)
     if (!data || !numsubsectors)
         I_Error("This map has no subsectors.");
 
+    return data;
+}
+
+//
+// P_ParseSubsectors
+//
+static void P_ParseSubsectors(const mapsubsector_t *data)
+{
+    int i;
+
     for (i = 0; i < numsubsectors; i++)
     {
         subsectors[i].numlines = (unsigned short)SHORT(data[i].numsegs);
         subsectors[i].firstline = (unsigned short)SHORT(data[i].firstseg);
     }
-
-    W_ReleaseLumpNum(lump);
 }
 
-static void P_LoadSubsectors_V4(int lump)
+static const mapsubsector_v4_t *P_CacheSubsectors_V4(int lump)
 {
-    const mapsubsector_v4_t     *data;
-    int                         i;
+    const mapsubsector_v4_t *data;
 
     sizesubsectors = W_LumpLength(lump);
     numsubsectors = sizesubsectors / sizeof(mapsubsector_v4_t);
@@ -653,37 +672,49 @@ static void P_LoadSubsectors_V4(int lump)
     if (!data || !numsubsectors)
         I_Error("This map has no subsectors.");
 
+    return data;
+}
+
+static void P_ParseSubsectors_V4(const mapsubsector_v4_t *data)
+{
+    int i;
+
     for (i = 0; i < numsubsectors; i++)
     {
         subsectors[i].numlines = (int)data[i].numsegs;
         subsectors[i].firstline = (int)data[i].firstseg;
     }
-
-    W_ReleaseLumpNum(lump);
 }
 
 //
-// P_LoadSectors
+// P_CacheSectors
 //
-void P_LoadSectors(int lump)
+static const mapsector_t *P_CacheSectors(int lump)
 {
-    const byte  *data;
-    int         i;
-
     sizesectors = W_LumpLength(lump);
     numsectors = sizesectors / sizeof(mapsector_t);
     sectors = calloc_IfSameLevel(sectors, numsectors, sizeof(sector_t));
-    data = (byte *)W_CacheLumpNum(lump, PU_STATIC);
+
+    return (const mapsector_t *)W_CacheLumpNum(lump, PU_STATIC);
+}
+
+//
+// P_ParseSectors
+// [BH] Flats that can't be found are left as -1, for P_CheckSectors() to warn about.
+//
+static void P_ParseSectors(const mapsector_t *data)
+{
+    int i;
 
     for (i = 0; i < numsectors; i++)
     {
-        sector_t        *ss = sectors + i;
-        mapsector_t     *ms = (mapsector_t *)data + i;
+        sector_t            *ss = sectors + i;
+        const mapsector_t   *ms = data + i;
 
         ss->floorheight = SHORT(ms->floorheight) << FRACBITS;
         ss->ceilingheight = SHORT(ms->ceilingheight) << FRACBITS;
-        ss->floorpic = R_FlatNumForName(ms->floorpic);
-        ss->ceilingpic = R_FlatNumForName(ms->ceilingpic);
+        ss->floorpic = R_CheckFlatNumForName((char *)ms->floorpic);
+        ss->ceilingpic = R_CheckFlatNumForName((char *)ms->ceilingpic);
         ss->lightlevel = SHORT(ms->lightlevel);
         ss->special = SHORT(ms->special);
         ss->tag = SHORT(ms->tag);
@@ -765,17 +796,35 @@ void P_LoadSectors(int lump)
         ss->oldceilingheight = ss->ceilingheight;
         ss->interpceilingheight = ss->ceilingheight;
     }
+}
 
-    W_ReleaseLumpNum(lump);
+//
+// P_CheckSectors
+// Warns about, and replaces, any flats that P_ParseSectors() couldn't find.
+//
+static void P_CheckSectors(const mapsector_t *data)
+{
+    int i;
+
+    for (i = 0; i < numsectors; i++)
+    {
+        sector_t            *ss = sectors + i;
+        const mapsector_t   *ms = data + i;
+
+        if (ss->floorpic == -1)
+            ss->floorpic = R_FlatNumForName((char *)ms->floorpic);
+
+        if (ss->ceilingpic == -1)
+            ss->ceilingpic = R_FlatNumForName((char *)ms->ceilingpic);
+    }
 }
 
 //
-// P_LoadNodes
+// P_CacheNodes
 //
-void P_LoadNodes(int lump)
+static const mapnode_t *P_CacheNodes(int lump)
 {
     const byte  *data;
-    int         i;
 
     sizenodes = W_LumpLength(lump);
     numnodes = sizenodes / sizeof(mapnode_t);
@@ -790,10 +839,21 @@ void P_LoadNodes(int lump)
             I_Error("This map has no nodes.");
     }
 
+    return (const mapnode_t *)data;
+}
+
+//
+// P_ParseNodes
+// [BH] References to invalid subsectors are left for P_CheckNodes() to warn about.
+//
+static void P_ParseNodes(const mapnode_t *data)
+{
+    int i;
+
     for (i = 0; i < numnodes; i++)
     {
         node_t          *no = nodes + i;
-        const mapnode_t *mn = (const mapnode_t *)data + i;
+        const mapnode_t *mn = data + i;
         int             j;
 
         no->x = SHORT(mn->x) << FRACBITS;
@@ -813,15 +873,6 @@ void P_LoadNodes(int lump)
             {
                 // Convert to extended type
                 no->children[j] &= ~0x8000;
-
-                // haleyjd 11/06/10: check for invalid subsector reference
-                if (no->children[j] >= numsubsectors)
-                {
-                    C_Warning("Node %s references an invalid subsector of %s.",
-                        commify(i), commify(no->children[j]));
-                    no->children[j] = 0;
-                }
-
                 no->children[j] |= NF_SUBSECTOR;
             }
 
@@ -829,14 +880,38 @@ void P_LoadNodes(int lump)
                 no->bbox[j][k] = SHORT(mn->bbox[j][k]) << FRACBITS;
         }
     }
+}
 
-    W_ReleaseLumpNum(lump);
+//
+// P_CheckNodes
+//
+static void P_CheckNodes(void)
+{
+    int i;
+
+    for (i = 0; i < numnodes; i++)
+    {
+        node_t  *no = nodes + i;
+        int     j;
+
+        for (j = 0; j < 2; j++)
+        {
+            int child = no->children[j];
+
+            // haleyjd 11/06/10: check for invalid subsector reference
+            if (child != -1 && (child & NF_SUBSECTOR) && (child & ~NF_SUBSECTOR) >= numsubsectors)
+            {
+                C_Warning("Node %s references an invalid subsector of %s.",
+                    commify(i), commify((int)(child & ~NF_SUBSECTOR)));
+                no->children[j] = NF_SUBSECTOR;
+            }
+        }
+    }
 }
 
-static void P_LoadNodes_V4(int lump)
+static const mapnode_v4_t *P_CacheNodes_V4(int lump)
 {
     const byte  *data;
-    int         i;
 
     sizenodes = W_LumpLength(lump);
     numnodes = (sizenodes - 8) / sizeof(mapnode_v4_t);
@@ -854,10 +929,17 @@ static void P_LoadNodes_V4(int lump)
             I_Error("This map has no nodes.");
     }
 
+    return (const mapnode_v4_t *)data;
+}
+
+static void P_ParseNodes_V4(const mapnode_v4_t *data)
+{
+    int i;
+
     for (i = 0; i < numnodes; i++)
     {
         node_t                  *no = nodes + i;
-        const mapnode_v4_t      *mn = (const mapnode_v4_t *)data + i;
+        const mapnode_v4_t      *mn = data + i;
         int                     j;
 
         no->x = SHORT(mn->x) << FRACBITS;
@@ -874,8 +956,6 @@ static void P_LoadNodes_V4(int lump)
                 no->bbox[j][k] = SHORT(mn->bbox[j][k]) << FRACBITS;
         }
     }
-
-    W_ReleaseLumpNum(lump);
 }
 
 static void P_LoadZSegs(const byte *data)
@@ -1006,7 +1086,7 @@ static void P_LoadZNodes(int lump)
     {
         data += newVerts * (sizeof(newvertarray[0].x) + sizeof(newvertarray[0].y));
 
-        // P_LoadVertexes reset numvertexes, need to increase it again
+        // P_CacheVertexes reset numvertexes, need to increase it again
         numvertexes = orgVerts + newVerts;
     }
 
@@ -1397,6 +1477,71 @@ static void P_LoadSideDefs2(int lump)
     W_ReleaseLumpNum(lump);
 }
 
+//
+// P_AddLineToBlockMap
+// Walks linedef i from block to block, either counting it in each block it crosses, or, if
+// blocklist isn't NULL, storing it in the next free slot of each block's list.
+//
+static void P_AddLineToBlockMap(int i, int minx, int miny, unsigned int tot, int *count, int *blocklist)
+{
+    // starting coordinates
+    int x = (lines[i].v1->x >> FRACBITS) - minx;
+    int y = (lines[i].v1->y >> FRACBITS) - miny;
+
+    // x - y deltas
+    int adx = lines[i].dx >> FRACBITS;
+    int dx = (adx < 0 ? -1 : 1);
+    int ady = lines[i].dy >> FRACBITS;
+    int dy = (ady < 0 ? -1 : 1);
+
+    // difference in preferring to move across y (>0) instead of x (<0)
+    int diff = (!adx ? 1 : (!ady ? -1 :
+        (((x >> MAPBTOFRAC) << MAPBTOFRAC)
+        + (dx > 0 ? MAPBLOCKUNITS - 1 : 0) - x) * (ady = abs(ady)) * dx
+        - (((y >> MAPBTOFRAC) << MAPBTOFRAC)
+        + (dy > 0 ? MAPBLOCKUNITS - 1 : 0) - y) * (adx = abs(adx)) * dy));
+
+    // starting block
+    int b = (y >> MAPBTOFRAC) * bmapwidth + (x >> MAPBTOFRAC);
+
+    // ending block
+    int bend = (((lines[i].v2->y >> FRACBITS) - miny) >> MAPBTOFRAC) * bmapwidth
+        + (((lines[i].v2->x >> FRACBITS) - minx) >> MAPBTOFRAC);
+
+    // delta for pointer when moving across y
+    dy *= bmapwidth;
+
+    // deltas for diff inside the loop
+    adx <<= MAPBTOFRAC;
+    ady <<= MAPBTOFRAC;
+
+    // Now we simply iterate block-by-block until we reach the end block.
+    while ((unsigned int)b < tot)       // failsafe -- should ALWAYS be true
+    {
+        // Count the linedef, or add it to the block's list
+        if (blocklist)
+            blocklist[count[b]--] = i;
+        else
+            count[b]++;
+
+        // If we have reached the last block, exit
+        if (b == bend)
+            break;
+
+        // Move in either the x or y direction to the next block
+        if (diff < 0)
+        {
+            diff += ady;
+            b += dx;
+        }
+        else
+        {
+            diff -= adx;
+            b += dy;
+        }
+    }
+}
+
 //
 // killough 10/98:
 //
@@ -1410,6 +1555,10 @@ static void P_LoadSideDefs2(int lump)
 // Please note: This section of code is not interchangeable with TeamTNT's
 // code which attempts to fix the same problem.
 //
+// [BH] Rewritten again to walk the linedefs twice, first counting how many
+// are in each block, and then storing them straight into the blockmap, rather
+// than growing a separate list for each block.
+//
 static void P_CreateBlockMap(void)
 {
     int         i;
@@ -1444,7 +1593,7 @@ static void P_CreateBlockMap(void)
     bmapwidth = ((maxx - minx) >> MAPBTOFRAC) + 1;
     bmapheight = ((maxy - miny) >> MAPBTOFRAC) + 1;
 
-    // Compute blockmap, which is stored as a 2d array of variable-sized lists.
+    // Compute blockmap.
     //
     // Pseudocode:
     //
@@ -1454,88 +1603,25 @@ static void P_CreateBlockMap(void)
     //
     //   Starting in the starting vertex's block, do:
     //
-    //     Add linedef to current block's list, dynamically resizing it.
+    //     Count linedef in current block.
     //
     //     If current block is the same as the ending vertex's block, exit loop.
     //
     //     Move to an adjacent block by moving towards the ending block in
     //     either the x or y direction, to the block which contains the linedef.
+    //
+    // Then lay out the blocklists from the counts, and walk each linedef again
+    // to fill them in.
     {
-        // blocklist structure
-        typedef struct
-        {
-            int n, nalloc, *list;
-        } bmap_t;
-
         unsigned int    tot = bmapwidth * bmapheight;           // size of blockmap
-        bmap_t          *bmap = calloc(sizeof(*bmap), tot);     // array of blocklists
+        int             *count = calloc(tot, sizeof(*count));   // number of linedefs in each block
+        int             ndx;
 
-        if (!bmap)
+        if (!count)
             I_Error("Unable to create blockmap.");
 
         for (i = 0; i < numlines; i++)
-        {
-            // starting coordinates
-            int x = (lines[i].v1->x >> FRACBITS) - minx;
-            int y = (lines[i].v1->y >> FRACBITS) - miny;
-
-            // x - y deltas
-            int adx = lines[i].dx >> FRACBITS;
-            int dx = (adx < 0 ? -1 : 1);
-            int ady = lines[i].dy >> FRACBITS;
-            int dy = (ady < 0 ? -1 : 1);
-
-            // difference in preferring to move across y (>0) instead of x (<0)
-            int diff = (!adx ? 1 : (!ady ? -1 :
-                (((x >> MAPBTOFRAC) << MAPBTOFRAC)
-                + (dx > 0 ? MAPBLOCKUNITS - 1 : 0) - x) * (ady = abs(ady)) * dx
-                - (((y >> MAPBTOFRAC) << MAPBTOFRAC)
-                + (dy > 0 ? MAPBLOCKUNITS - 1 : 0) - y) * (adx = abs(adx)) * dy));
-
-            // starting block, and pointer to its blocklist structure
-            int b = (y >> MAPBTOFRAC) * bmapwidth + (x >> MAPBTOFRAC);
-
-            // ending block
-            int bend = (((lines[i].v2->y >> FRACBITS) - miny) >> MAPBTOFRAC) * bmapwidth
-                + (((lines[i].v2->x >> FRACBITS) - minx) >> MAPBTOFRAC);
-
-            // delta for pointer when moving across y
-            dy *= bmapwidth;
-
-            // deltas for diff inside the loop
-            adx <<= MAPBTOFRAC;
-            ady <<= MAPBTOFRAC;
-
-            // Now we simply iterate block-by-block until we reach the end block.
-            while ((unsigned int)b < tot)       // failsafe -- should ALWAYS be true
-            {
-                bmap_t  *bp = &bmap[b];
-
-                // Increase size of allocated list if necessary
-                if (bp->n >= bp->nalloc && !(bp->list = Z_Realloc(bp->list,
-                    (bp->nalloc = bp->nalloc ? bp->nalloc * 2 : 8) * sizeof(*bp->list))))
-                    I_Error("Unable to create blockmap.");
-
-                // Add linedef to end of list
-                bp->list[bp->n++] = i;
-
-                // If we have reached the last block, exit
-                if (b == bend)
-                    break;
-
-                // Move in either the x or y direction to the next block
-                if (diff < 0)
-                {
-                    diff += ady;
-                    b += dx;
-                }
-                else
-                {
-                    diff -= adx;
-                    b += dy;
-                }
-            }
-        }
+            P_AddLineToBlockMap(i, minx, miny, tot, count, NULL);
 
         // Compute the total size of the blockmap.
         //
@@ -1544,45 +1630,47 @@ static void P_CreateBlockMap(void)
         //
         // 4 words, unused if this routine is called, are reserved at the start.
         {
-            int count = tot + 6;  // we need at least 1 word per block, plus reserved's
+            int size = tot + 6;  // we need at least 1 word per block, plus reserved's
 
             for (i = 0; (unsigned int)i < tot; i++)
-                if (bmap[i].n)
-                    count += bmap[i].n + 2;     // 1 header word + 1 trailer word + blocklist
+                if (count[i])
+                    size += count[i] + 2;       // 1 header word + 1 trailer word + blocklist
 
             // Allocate blockmap lump with computed count
-            blockmaplump = malloc_IfSameLevel(blockmaplump, sizeof(*blockmaplump) * count);
+            blockmaplump = malloc_IfSameLevel(blockmaplump, sizeof(*blockmaplump) * size);
+            blockmaplength = size;
         }
 
-        // Now compress the blockmap.
-        {
-            int         ndx = tot += 4; // Advance index to start of linedef lists
-            bmap_t      *bp = bmap;     // Start of uncompressed blockmap
+        // Now lay out the compressed blockmap. Each linedef is stored from the end
+        // of its blocklist backwards, so the linedefs in each blocklist are in the
+        // same descending order as before.
+        ndx = tot + 4;                  // Advance index to start of linedef lists
 
-            blockmaplump[ndx++] = 0;    // Store an empty blockmap list at start
-            blockmaplump[ndx++] = -1;   // (Used for compression)
+        blockmaplump[ndx++] = 0;        // Store an empty blockmap list at start
+        blockmaplump[ndx++] = -1;       // (Used for compression)
 
-            for (i = 4; (unsigned int)i < tot; i++, bp++)
-                if (bp->n)                                              // Non-empty blocklist
-                {
-                    blockmaplump[blockmaplump[i] = ndx++] = 0;          // Store index & header
-                    do
-                        blockmaplump[ndx++] = bp->list[--bp->n];        // Copy linedef list
-                    while (bp->n);
-                    blockmaplump[ndx++] = -1;                           // Store trailer
-                    free(bp->list);                                     // Free linedef list
-                }
-                else
-                    // Empty blocklist: point to reserved empty blocklist
-                    blockmaplump[i] = tot;
+        for (i = 0; (unsigned int)i < tot; i++)
+            if (count[i])                                               // Non-empty blocklist
+            {
+                blockmaplump[blockmaplump[i + 4] = ndx] = 0;            // Store index & header
+                ndx += count[i] + 1;
+                blockmaplump[ndx] = -1;                                 // Store trailer
+                count[i] = ndx++ - 1;                                   // Last slot in blocklist
+            }
+            else
+                // Empty blocklist: point to reserved empty blocklist
+                blockmaplump[i + 4] = tot + 4;
 
-            free(bmap);                 // Free uncompressed blockmap
-        }
+        // Fill in the linedef lists
+        for (i = 0; i < numlines; i++)
+            P_AddLineToBlockMap(i, minx, miny, tot, count, blockmaplump);
+
+        free(count);
     }
 }
 
 //
-// P_LoadBlockMap
+// P_CacheBlockMap
 //
 // killough 3/1/98: substantially modified to work
 // towards removing blockmap limit (a wad limitation)
@@ -1590,7 +1678,10 @@ static void P_CreateBlockMap(void)
 // killough 3/30/98: Rewritten to remove blockmap limit,
 // though current algorithm is brute-force and non-optimal.
 //
-void P_LoadBlockMap(int lump)
+// [BH] Returns the blockmap lump for P_ParseBlockMap() to expand, or NULL if the blockmap
+// needs to be created by P_CreateBlockMap() instead.
+//
+static short *P_CacheBlockMap(int lump)
 {
     int count;
     int lumplen;
@@ -1598,42 +1689,58 @@ void P_LoadBlockMap(int lump)
     blockmaprecreated = false;
     if (lump >= numlumps || (lumplen = W_LumpLength(lump)) < 8 || (count = lumplen / 2) >= 0x10000)
     {
-        P_CreateBlockMap();
         blockmaprecreated = true;
+        return NULL;
     }
-    else
-    {
-        short   *wadblockmaplump = W_CacheLumpNum(lump, PU_LEVEL);
-        int      i;
-
-        blockmaplump = malloc_IfSameLevel(blockmaplump, sizeof(*blockmaplump) * count);
 
-        // killough 3/1/98: Expand wad blockmap into larger internal one,
-        // by treating all offsets except -1 as unsigned and zero-extending
-        // them. This potentially doubles the size of blockmaps allowed,
-        // because DOOM originally considered the offsets as always signed.
-        blockmaplump[0] = SHORT(wadblockmaplump[0]);
-        blockmaplump[1] = SHORT(wadblockmaplump[1]);
-        blockmaplump[2] = (uint32_t)(SHORT(wadblockmaplump[2])) & 0xFFFF;
-        blockmaplump[3] = (uint32_t)(SHORT(wadblockmaplump[3])) & 0xFFFF;
+    blockmaplength = count;
+    blockmaplump = malloc_IfSameLevel(blockmaplump, sizeof(*blockmaplump) * count);
 
-        // Swap all short integers to native byte ordering.
-        for (i = 4; i < count; i++)
-        {
-            short   t = SHORT(wadblockmaplump[i]);
+    return W_CacheLumpNum(lump, PU_LEVEL);
+}
 
-            blockmaplump[i] = (t == -1 ? -1l : ((uint32_t)t & 0xFFFF));
-        }
+//
+// P_ParseBlockMap
+//
+static void P_ParseBlockMap(const short *wadblockmaplump)
+{
+    int i;
 
-        Z_Free(wadblockmaplump);
+    // killough 3/1/98: Expand wad blockmap into larger internal one,
+    // by treating all offsets except -1 as unsigned and zero-extending
+    // them. This potentially doubles the size of blockmaps allowed,
+    // because DOOM originally considered the offsets as always signed.
+    blockmaplump[0] = SHORT(wadblockmaplump[0]);
+    blockmaplump[1] = SHORT(wadblockmaplump[1]);
+    blockmaplump[2] = (uint32_t)(SHORT(wadblockmaplump[2])) & 0xFFFF;
+    blockmaplump[3] = (uint32_t)(SHORT(wadblockmaplump[3])) & 0xFFFF;
+
+    // Swap all short integers to native byte ordering.
+    for (i = 4; i < blockmaplength; i++)
+    {
+        short   t = SHORT(wadblockmaplump[i]);
 
-        // Read the header
-        bmaporgx = blockmaplump[0] << FRACBITS;
-        bmaporgy = blockmaplump[1] << FRACBITS;
-        bmapwidth = blockmaplump[2];
-        bmapheight = blockmaplump[3];
+        blockmaplump[i] = (t == -1 ? -1l : ((uint32_t)t & 0xFFFF));
     }
 
+    // Read the header
+    bmaporgx = blockmaplump[0] << FRACBITS;
+    bmaporgy = blockmaplump[1] << FRACBITS;
+    bmapwidth = blockmaplump[2];
+    bmapheight = blockmaplump[3];
+}
+
+static int P_CreateBlockMapThread(thread_t *thread, void *data)
+{
+    P_CreateBlockMap();
+    return 0;
+}
+
+//
+// P_FinishBlockMap
+//
+static void P_FinishBlockMap(void)
+{
     // Clear out mobj chains
     blocklinks = calloc_IfSameLevel(blocklinks, bmapwidth * bmapheight, sizeof(*blocklinks));
     blockmap = blockmaplump + 4;
@@ -1662,236 +1769,1951 @@ void RejectOverrun(int rejectlump, const byte **rejectmatrix, int totallines)
     }
 }
 //
-// P_LoadReject - load the reject table
+// REJECT BUILDER
+// [BH] Most modern nodebuilders leave the REJECT lump empty, so P_CheckSight() can never skip a
+// trace. If buildreject is on, a table is worked out for such maps on a background thread, and
+// cached in the reject folder so each map only needs it once. Starting from each portal (a
+// two-sided line, or a vertex where walls of different sectors meet) out of a sector, the
+// part of each further portal that a straight line could still reach is clipped down until
+// nothing is left. Heights are ignored and every portal is widened a little to allow for the
+// rounding in P_DivlineSide(), so two sectors are only marked as unable to see each other if
+// the trace between them would always fail anyway.
 //
-static void P_LoadReject(int lumpnum, int totallines)
+#define REJECTEPSILON   4.0
+#define REJECTBUDGET    (1 << 16)
+#define REJECTMAXDEPTH  1024
+#define REJECTVERSION   1
+
+typedef struct
 {
-    // dump any old cached reject lump, then cache the new one
-    if (rejectlump != -1)
-        W_ReleaseLumpNum(rejectlump);
-    rejectlump = lumpnum + ML_REJECT;
-    rejectmatrix = W_CacheLumpNum(rejectlump, PU_STATIC);
+    double              x1, y1;
+    double              x2, y2;
+    int                 id;
+    int                 sector;
+    dboolean            point;
+} rejectportal_t;
+
+typedef struct
+{
+    double              x1, y1;
+    double              x2, y2;
+    const rejectportal_t *portal;
+} rejectwinding_t;
 
-    //e6y: check for overflow
-    RejectOverrun(rejectlump, &rejectmatrix, totallines);
-}
+typedef struct
+{
+    int                 numsectors;
+    int                 numportals;
+    int                 numids;
+    rejectportal_t      *portals;
+    int                 *firstportal;
+    byte                *instack;
+    byte                *visible;
+    byte                *matrix;
+    int                 source;
+    int                 budget;
+    char                *filename;
+} rejectbuild_t;
+
+dboolean                buildreject = buildreject_default;
+
+static rejectbuild_t    *rejectbuild;
+static thread_t         *rejectthread;
+static char             *rejectfolder;
+
+#define REJECTBIT(b, n, i, j)       ((b)[((size_t)(i) * (n) + (j)) >> 3] \
+                                    & (1 << (((size_t)(i) * (n) + (j)) & 7)))
+#define SETREJECTBIT(b, n, i, j)    ((b)[((size_t)(i) * (n) + (j)) >> 3] \
+                                    |= (1 << (((size_t)(i) * (n) + (j)) & 7)))
 
 //
-// P_GroupLines
-// Builds sector line lists and subsector sector numbers.
-// Finds block bounding boxes for sectors.
+// P_IsRejectEmpty
+// Returns true if the REJECT lump is too short for the map or doesn't reject anything.
 //
-// killough 5/3/98: reformatted, cleaned up
-// cph 18/8/99: rewritten to avoid O(numlines * numsectors) section
-// It makes things more complicated, but saves seconds on big levels
-
-// cph - convenient sub-function
-static void P_AddLineToSector(line_t *li, sector_t *sector)
+static dboolean P_IsRejectEmpty(int lump)
 {
-    fixed_t     *bbox = (void *)sector->blockbox;
+    size_t      required = ((size_t)numsectors * numsectors + 7) / 8;
+    size_t      i;
 
-    sector->lines[sector->linecount++] = li;
-    M_AddToBox(bbox, li->v1->x, li->v1->y);
-    M_AddToBox(bbox, li->v2->x, li->v2->y);
+    if ((size_t)W_LumpLength(lump) < required)
+        return true;
+
+    for (i = 0; i < required; i++)
+        if (rejectmatrix[i])
+            return false;
+
+    return true;
 }
 
-// modified to return totallines (needed by P_LoadReject)
-static int P_GroupLines(void)
+//
+// P_IsMapClosed
+// The portals only cover every way out of a sector if its lines form closed loops and the
+// subsectors inside it agree which sector they are in.
+//
+static dboolean P_IsMapClosed(void)
 {
-    line_t      *li;
-    sector_t    *sector;
-    int         i, j, total = numlines;
+    byte        *parity = calloc(numvertexes, 1);
+    dboolean    closed = true;
+    int         i;
 
-    // figgi
-    for (i = 0; i < numsubsectors; i++)
+    if (!parity)
+        return false;
+
+    for (i = 0; i < numsubsectors && closed; i++)
     {
-        seg_t   *seg = &segs[subsectors[i].firstline];
+        const subsector_t   *subsector = &subsectors[i];
+        int                 j;
 
-        subsectors[i].sector = NULL;
-        for (j = 0; j < subsectors[i].numlines; j++)
-        {
-            if (seg->sidedef)
+        for (j = 0; j < subsector->numlines; j++)
+            if (segs[subsector->firstline + j].frontsector != subsector->sector)
             {
-                subsectors[i].sector = seg->sidedef->sector;
+                closed = false;
                 break;
             }
-            seg++;
-        }
-        if (!subsectors[i].sector)
-            I_Error("Subsector %s is not a part of any sector.", commify(i));
     }
 
-    // count number of lines in each sector
-    for (i = 0, li = lines; i < numlines; i++, li++)
+    for (i = 0; i < numsectors && closed; i++)
     {
-        li->frontsector->linecount++;
-        if (li->backsector && li->backsector != li->frontsector)
+        const sector_t  *sector = &sectors[i];
+        int             j;
+
+        for (j = 0; j < sector->linecount; j++)
         {
-            li->backsector->linecount++;
-            total++;
-        }
-    }
+            const line_t    *line = sector->lines[j];
 
-    // allocate line tables for each sector
-    {
-        line_t  **linebuffer = Z_Malloc(total * sizeof(line_t *), PU_LEVEL, NULL);
+            if (line->frontsector != line->backsector)
+            {
+                parity[line->v1 - vertexes] ^= 1;
+                parity[line->v2 - vertexes] ^= 1;
+            }
+        }
 
-        for (i = 0, sector = sectors; i < numsectors; i++, sector++)
+        for (j = 0; j < sector->linecount; j++)
         {
-            sector->lines = linebuffer;
-            linebuffer += sector->linecount;
-            sector->linecount = 0;
-            M_ClearBox(sector->blockbox);
+            const line_t    *line = sector->lines[j];
+
+            if (parity[line->v1 - vertexes] || parity[line->v2 - vertexes])
+                closed = false;
+
+            parity[line->v1 - vertexes] = 0;
+            parity[line->v2 - vertexes] = 0;
         }
     }
 
-    // Enter those lines
-    for (i = 0, li = lines; i < numlines; i++, li++)
+    free(parity);
+    return closed;
+}
+
+//
+// P_AddRejectPortal
+// Adds a portal into sector "to", with that sector on its left if it's a line. Called twice
+// for each portal, first to count them and then to fill them in.
+//
+static void P_AddRejectPortal(rejectbuild_t *build, int *count, int from, int to, int id,
+    const vertex_t *v1, const vertex_t *v2)
+{
+    if (build->portals)
     {
-        P_AddLineToSector(li, li->frontsector);
-        if (li->backsector && li->backsector != li->frontsector)
-            P_AddLineToSector(li, li->backsector);
+        rejectportal_t  *portal = &build->portals[build->firstportal[from] + count[from]];
+
+        portal->x1 = (double)v1->x / FRACUNIT;
+        portal->y1 = (double)v1->y / FRACUNIT;
+        portal->x2 = (double)v2->x / FRACUNIT;
+        portal->y2 = (double)v2->y / FRACUNIT;
+        portal->id = id;
+        portal->sector = to;
+        portal->point = (v1 == v2);
     }
 
-    for (i = 0, sector = sectors; i < numsectors; i++, sector++)
-    {
-        fixed_t *bbox = (void*)sector->blockbox; // cph - For convenience, so
-        int     block;                           // I can use the old code unchanged
+    count[from]++;
+    build->numportals++;
+}
 
-        //e6y: fix sound origin for large levels
-        sector->soundorg.x = bbox[BOXRIGHT] / 2 + bbox[BOXLEFT] / 2;
-        sector->soundorg.y = bbox[BOXTOP] / 2 + bbox[BOXBOTTOM] / 2;
+//
+// P_IsRepeatedSector
+// Returns true if the sector at vertexsectors[i] is also earlier in the list for its vertex.
+//
+static dboolean P_IsRepeatedSector(const int *vertexsectors, int first, int i)
+{
+    int j;
 
-        // adjust bounding box to map blocks
-        block = (bbox[BOXTOP] - bmaporgy + MAXRADIUS) >> MAPBLOCKSHIFT;
-        block = (block >= bmapheight ? bmapheight - 1 : block);
+    for (j = first; j < i; j++)
+        if (vertexsectors[j] == vertexsectors[i])
+            return true;
+
+    return false;
+}
+
+//
+// P_FindRejectPortals
+// Fills in the portals out of each sector, grouped by sector.
+//
+static void P_FindRejectPortals(rejectbuild_t *build)
+{
+    int         *count = calloc(numsectors, sizeof(*count));
+    int         *firstsector = calloc(numvertexes + 1, sizeof(*firstsector));
+    int         *vertexsectors = malloc((size_t)numlines * 4 * sizeof(*vertexsectors));
+    byte        *onesided = calloc(numvertexes, 1);
+    int         numids = 0;
+    int         pass;
+    int         i;
+
+    // list the sectors that touch each vertex
+    for (i = 0; i < numlines; i++)
+    {
+        const line_t    *line = &lines[i];
+        int             n = 1 + (line->backsector && line->backsector != line->frontsector);
+
+        firstsector[line->v1 - vertexes + 1] += n;
+        firstsector[line->v2 - vertexes + 1] += n;
+
+        if (!(line->flags & ML_TWOSIDED) || !line->backsector)
+        {
+            onesided[line->v1 - vertexes] = true;
+            onesided[line->v2 - vertexes] = true;
+        }
+    }
+
+    for (i = 0; i < numvertexes; i++)
+        firstsector[i + 1] += firstsector[i];
+
+    for (i = 0; i < numlines; i++)
+    {
+        const line_t    *line = &lines[i];
+        int             v;
+
+        for (v = 0; v < 2; v++)
+        {
+            int vertex = (v ? line->v2 : line->v1) - vertexes;
+
+            vertexsectors[firstsector[vertex]++] = line->frontsector - sectors;
+
+            if (line->backsector && line->backsector != line->frontsector)
+                vertexsectors[firstsector[vertex]++] = line->backsector - sectors;
+        }
+    }
+
+    for (i = numvertexes; i > 0; i--)
+        firstsector[i] = firstsector[i - 1];
+
+    firstsector[0] = 0;
+
+    for (pass = 0; pass < 2; pass++)
+    {
+        memset(count, 0, numsectors * sizeof(*count));
+        build->numportals = 0;
+        numids = 0;
+
+        for (i = 0; i < numlines; i++)
+        {
+            const line_t    *line = &lines[i];
+
+            if ((line->flags & ML_TWOSIDED) && line->backsector
+                && line->backsector != line->frontsector)
+            {
+                int front = line->frontsector - sectors;
+                int back = line->backsector - sectors;
+
+                P_AddRejectPortal(build, count, front, back, numids, line->v1, line->v2);
+                P_AddRejectPortal(build, count, back, front, numids++, line->v2, line->v1);
+            }
+        }
+
+        // traces that graze the corner of a wall can slip past it, so also let the sight of
+        // each sector that touches such a vertex pass through it
+        for (i = 0; i < numvertexes; i++)
+            if (onesided[i])
+            {
+                int j, k;
+
+                for (j = firstsector[i]; j < firstsector[i + 1]; j++)
+                    for (k = firstsector[i]; k < firstsector[i + 1]; k++)
+                        if (vertexsectors[j] != vertexsectors[k]
+                            && !P_IsRepeatedSector(vertexsectors, firstsector[i], j)
+                            && !P_IsRepeatedSector(vertexsectors, firstsector[i], k))
+                            P_AddRejectPortal(build, count, vertexsectors[j], vertexsectors[k],
+                                numids, &vertexes[i], &vertexes[i]);
+
+                numids++;
+            }
+
+        if (!pass)
+        {
+            build->portals = malloc(build->numportals * sizeof(*build->portals));
+
+            for (i = 0; i < numsectors; i++)
+                build->firstportal[i + 1] = build->firstportal[i] + count[i];
+        }
+    }
+
+    free(count);
+    free(firstsector);
+    free(vertexsectors);
+    free(onesided);
+
+    build->numids = numids;
+}
+
+//
+// P_RejectSide
+// Returns how far x, y is to the left of the line through x1, y1 and x2, y2.
+//
+static double P_RejectSide(double x1, double y1, double x2, double y2, double x, double y)
+{
+    return ((x2 - x1) * (y - y1) - (y2 - y1) * (x - x1)) / sqrt((x2 - x1) * (x2 - x1)
+        + (y2 - y1) * (y2 - y1));
+}
+
+//
+// P_ClipRejectWinding
+// Clips the winding to the part that is on the given side of the line through x1, y1 and
+// x2, y2, give or take REJECTEPSILON. Returns false if nothing is left.
+//
+static dboolean P_ClipRejectWinding(rejectwinding_t *winding, double x1, double y1, double x2,
+    double y2, double side)
+{
+    double      d1, d2;
+    double      frac;
+
+    if (fabs(x2 - x1) + fabs(y2 - y1) < 0.001)
+        return true;
+
+    d1 = side * P_RejectSide(x1, y1, x2, y2, winding->x1, winding->y1);
+    d2 = side * P_RejectSide(x1, y1, x2, y2, winding->x2, winding->y2);
+
+    if (d1 >= -REJECTEPSILON && d2 >= -REJECTEPSILON)
+        return true;
+
+    if (d1 < -REJECTEPSILON && d2 < -REJECTEPSILON)
+        return false;
+
+    frac = (d1 + REJECTEPSILON) / (d1 - d2);
+
+    if (d1 < -REJECTEPSILON)
+    {
+        winding->x1 += frac * (winding->x2 - winding->x1);
+        winding->y1 += frac * (winding->y2 - winding->y1);
+    }
+    else
+    {
+        winding->x2 = winding->x1 + frac * (winding->x2 - winding->x1);
+        winding->y2 = winding->y1 + frac * (winding->y2 - winding->y1);
+    }
+
+    return true;
+}
+
+//
+// P_ClipToSeparators
+// Every straight line through source and then pass stays on the far side of each line that
+// joins an end of source to an end of pass and has the rest of source and pass on opposite
+// sides of it. Clips target to the part that can be reached that way.
+//
+static dboolean P_ClipToSeparators(const rejectwinding_t *source, const rejectwinding_t *pass,
+    rejectwinding_t *target)
+{
+    const double    sx[2] = { source->x1, source->x2 };
+    const double    sy[2] = { source->y1, source->y2 };
+    const double    px[2] = { pass->x1, pass->x2 };
+    const double    py[2] = { pass->y1, pass->y2 };
+    int             i, j;
+
+    for (i = 0; i < 2; i++)
+        for (j = 0; j < 2; j++)
+        {
+            double  ds, dp;
+
+            if (fabs(px[j] - sx[i]) + fabs(py[j] - sy[i]) < 0.001)
+                continue;
+
+            ds = P_RejectSide(sx[i], sy[i], px[j], py[j], sx[!i], sy[!i]);
+
+            if (fabs(ds) <= REJECTEPSILON)
+                continue;
+
+            dp = P_RejectSide(sx[i], sy[i], px[j], py[j], px[!j], py[!j]);
+
+            if ((ds > 0.0 && dp > 0.000001) || (ds < 0.0 && dp < -0.000001))
+                continue;
+
+            if (!P_ClipRejectWinding(target, sx[i], sy[i], px[j], py[j], (ds > 0.0 ? -1.0 : 1.0)))
+                return false;
+        }
+
+    return true;
+}
+
+//
+// P_InitRejectWinding
+// Starts a winding from the whole of a portal, lengthened by REJECTEPSILON at each end.
+//
+static void P_InitRejectWinding(rejectwinding_t *winding, const rejectportal_t *portal)
+{
+    double      dx = portal->x2 - portal->x1;
+    double      dy = portal->y2 - portal->y1;
+    double      length = sqrt(dx * dx + dy * dy);
+
+    winding->portal = portal;
+
+    if (length < 0.001)
+    {
+        winding->x1 = portal->x1;
+        winding->y1 = portal->y1;
+        winding->x2 = portal->x2;
+        winding->y2 = portal->y2;
+        return;
+    }
+
+    dx *= REJECTEPSILON / length;
+    dy *= REJECTEPSILON / length;
+    winding->x1 = portal->x1 - dx;
+    winding->y1 = portal->y1 - dy;
+    winding->x2 = portal->x2 + dx;
+    winding->y2 = portal->y2 + dy;
+}
+
+//
+// P_FlowReject
+// Marks the sector that pass leads into as visible from the source sector, then follows each
+// portal out of it that a line through source and pass can still reach. Returns false if the
+// chain gets too long or the budget runs out.
+//
+static dboolean P_FlowReject(rejectbuild_t *build, const rejectwinding_t *source,
+    const rejectwinding_t *pass, int depth)
+{
+    const rejectportal_t    *portal = pass->portal;
+    int                     i;
+
+    SETREJECTBIT(build->visible, build->numsectors, build->source, portal->sector);
+
+    if (depth >= REJECTMAXDEPTH)
+        return false;
+
+    for (i = build->firstportal[portal->sector]; i < build->firstportal[portal->sector + 1]; i++)
+    {
+        const rejectportal_t    *next = &build->portals[i];
+        rejectwinding_t         target;
+        rejectwinding_t         newsource = *source;
+
+        if (build->instack[next->id])
+            continue;
+
+        if (--build->budget < 0)
+            return false;
+
+        P_InitRejectWinding(&target, next);
+
+        // the line of sight must go forward through each portal
+        if (!portal->point && !P_ClipRejectWinding(&target, portal->x1, portal->y1, portal->x2,
+            portal->y2, 1.0))
+            continue;
+
+        if (source != pass)
+        {
+            if (!source->portal->point && !P_ClipRejectWinding(&target, source->portal->x1,
+                source->portal->y1, source->portal->x2, source->portal->y2, 1.0))
+                continue;
+
+            if (!portal->point && (!P_ClipToSeparators(source, pass, &target)
+                || !P_ClipToSeparators(&target, pass, &newsource)))
+                continue;
+        }
+
+        build->instack[next->id] = true;
+
+        if (!P_FlowReject(build, &newsource, &target, depth + 1))
+            return false;
+
+        build->instack[next->id] = false;
+    }
+
+    return true;
+}
+
+//
+// P_FloodReject
+// Marks every sector that can be reached from the source sector at all as visible from it.
+// Used when P_FlowReject() gives up.
+//
+static void P_FloodReject(rejectbuild_t *build, int *queue)
+{
+    int head = 0;
+    int tail = 0;
+
+    queue[tail++] = build->source;
+    SETREJECTBIT(build->visible, build->numsectors, build->source, build->source);
+
+    while (head < tail)
+    {
+        int sector = queue[head++];
+        int i;
+
+        for (i = build->firstportal[sector]; i < build->firstportal[sector + 1]; i++)
+        {
+            int next = build->portals[i].sector;
+
+            if (!REJECTBIT(build->visible, build->numsectors, build->source, next))
+            {
+                SETREJECTBIT(build->visible, build->numsectors, build->source, next);
+                queue[tail++] = next;
+            }
+        }
+    }
+}
+
+//
+// P_BuildReject
+// Works out which sectors can be seen from each sector, and then rejects every pair of
+// sectors that can't see each other either way.
+//
+static int P_BuildReject(thread_t *thread, void *data)
+{
+    rejectbuild_t   *build = data;
+    int             numsectors = build->numsectors;
+    int             *queue = malloc(numsectors * sizeof(*queue));
+    char            *tempfile;
+    int             i, j;
+
+    for (build->source = 0; build->source < numsectors; build->source++)
+    {
+        dboolean    flowed = true;
+
+        if (thread && I_ThreadCancelled(thread))
+        {
+            free(queue);
+            return false;
+        }
+
+        SETREJECTBIT(build->visible, build->numsectors, build->source, build->source);
+        build->budget = REJECTBUDGET;
+
+        for (i = build->firstportal[build->source]; i < build->firstportal[build->source + 1]; i++)
+        {
+            const rejectportal_t    *portal = &build->portals[i];
+            rejectwinding_t         winding;
+
+            P_InitRejectWinding(&winding, portal);
+            build->instack[portal->id] = true;
+            flowed = P_FlowReject(build, &winding, &winding, 0);
+            build->instack[portal->id] = false;
+
+            if (!flowed)
+                break;
+        }
+
+        if (!flowed)
+        {
+            memset(build->instack, 0, build->numids);
+            P_FloodReject(build, queue);
+        }
+    }
+
+    free(queue);
+
+    for (i = 0; i < numsectors; i++)
+        for (j = 0; j < numsectors; j++)
+            if (!REJECTBIT(build->visible, numsectors, i, j) && !REJECTBIT(build->visible, numsectors, j, i))
+                SETREJECTBIT(build->matrix, numsectors, i, j);
+
+    // write to a temporary file first, so a partly written table is never read back
+    tempfile = M_StringJoin(build->filename, ".tmp", NULL);
+    M_WriteFileSafely(build->filename, tempfile, build->matrix, ((size_t)numsectors * numsectors + 7) / 8);
+    free(tempfile);
+    return true;
+}
+
+//
+// P_HashReject
+// Returns a hash of everything that the table built for the current map depends on.
+//
+static uint64_t P_HashReject(void)
+{
+    uint64_t    hash = 14695981039346656037ULL;
+    int         values[7];
+    int         i;
+
+    for (i = -1; i < numlines; i++)
+    {
+        int j;
+
+        if (i < 0)
+        {
+            values[0] = REJECTVERSION;
+            values[1] = numsectors;
+            values[2] = numvertexes;
+            values[3] = values[4] = values[5] = values[6] = 0;
+        }
+        else
+        {
+            const line_t    *line = &lines[i];
+
+            values[0] = line->v1->x;
+            values[1] = line->v1->y;
+            values[2] = line->v2->x;
+            values[3] = line->v2->y;
+            values[4] = line->frontsector - sectors;
+            values[5] = (line->backsector ? line->backsector - sectors : -1);
+            values[6] = line->flags & ML_TWOSIDED;
+        }
+
+        for (j = 0; j < (int)sizeof(values); j++)
+        {
+            hash ^= ((byte *)values)[j];
+            hash *= 1099511628211ULL;
+        }
+    }
+
+    return hash;
+}
+
+//
+// P_FreeRejectBuild
+//
+static void P_FreeRejectBuild(void)
+{
+    if (!rejectbuild)
+        return;
+
+    free(rejectbuild->portals);
+    free(rejectbuild->firstportal);
+    free(rejectbuild->instack);
+    free(rejectbuild->visible);
+    free(rejectbuild->matrix);
+    free(rejectbuild->filename);
+    free(rejectbuild);
+    rejectbuild = NULL;
+}
+
+//
+// P_ApplyReject
+// Adds the sectors that matrix rejects to the REJECT lump's own table.
+//
+static void P_ApplyReject(const byte *matrix)
+{
+    size_t  required = ((size_t)numsectors * numsectors + 7) / 8;
+    byte    *reject = Z_Malloc(required, PU_LEVEL, NULL);
+    size_t  i;
+
+    for (i = 0; i < required; i++)
+        reject[i] = rejectmatrix[i] | matrix[i];
+
+    rejectmatrix = reject;
+}
+
+//
+// P_StartRejectBuilder
+// Uses the cached table for the current map if there is one, or otherwise starts building it.
+//
+static void P_StartRejectBuilder(void)
+{
+    size_t      required = ((size_t)numsectors * numsectors + 7) / 8;
+    uint64_t    hash;
+    char        name[32];
+    FILE        *file;
+
+    if (!numsectors || !P_IsMapClosed())
+        return;
+
+    if (!rejectfolder)
+    {
+        char    *appdatafolder = M_GetAppDataFolder();
+
+        M_MakeDirectory(appdatafolder);
+        rejectfolder = M_StringJoin(appdatafolder, DIR_SEPARATOR_S, "reject", DIR_SEPARATOR_S, NULL);
+        M_MakeDirectory(rejectfolder);
+    }
+
+    hash = P_HashReject();
+    M_snprintf(name, sizeof(name), "%08X%08X.reject", (unsigned int)(hash >> 32),
+        (unsigned int)hash);
+
+    if (!(rejectbuild = calloc(1, sizeof(*rejectbuild))))
+        return;
+
+    rejectbuild->numsectors = numsectors;
+    rejectbuild->filename = M_StringJoin(rejectfolder, name, NULL);
+
+    if ((file = fopen(rejectbuild->filename, "rb")))
+    {
+        byte    *matrix = malloc(required);
+
+        if (matrix && (size_t)M_FileLength(file) == required && fread(matrix, 1, required, file) == required)
+        {
+            fclose(file);
+            P_ApplyReject(matrix);
+            free(matrix);
+            P_FreeRejectBuild();
+            return;
+        }
+
+        fclose(file);
+        free(matrix);
+    }
+
+    rejectbuild->firstportal = calloc(numsectors + 1, sizeof(*rejectbuild->firstportal));
+    P_FindRejectPortals(rejectbuild);
+    rejectbuild->instack = calloc(rejectbuild->numids + 1, 1);
+    rejectbuild->visible = calloc(((size_t)numsectors * numsectors + 7) / 8, 1);
+    rejectbuild->matrix = calloc(required, 1);
+
+    if (!rejectbuild->portals || !rejectbuild->instack || !rejectbuild->visible || !rejectbuild->matrix)
+    {
+        P_FreeRejectBuild();
+        return;
+    }
+
+    if (!(rejectthread = I_StartThread(P_BuildReject, "Reject builder", rejectbuild)))
+    {
+        P_BuildReject(NULL, rejectbuild);
+        P_ApplyReject(rejectbuild->matrix);
+        P_FreeRejectBuild();
+    }
+}
+
+//
+// P_UpdateReject
+// Starts using the table built for the current map once it is ready. Called between tics, so
+// it never changes while sight is being checked.
+//
+void P_UpdateReject(void)
+{
+    if (!rejectthread || !I_ThreadDone(rejectthread))
+        return;
+
+    if (I_WaitThread(rejectthread, false))
+        P_ApplyReject(rejectbuild->matrix);
+
+    rejectthread = NULL;
+    P_FreeRejectBuild();
+}
+
+//
+// P_StopRejectBuilder
+// Abandons the table being built for the previous map.
+//
+static void P_StopRejectBuilder(void)
+{
+    if (rejectthread)
+    {
+        I_WaitThread(rejectthread, true);
+        rejectthread = NULL;
+    }
+
+    P_FreeRejectBuild();
+}
+
+//
+// P_LoadReject - load the reject table
+//
+static void P_LoadReject(int lumpnum, int totallines)
+{
+    dboolean    empty;
+
+    // dump any old cached reject lump, then cache the new one
+    if (rejectlump != -1)
+        W_ReleaseLumpNum(rejectlump);
+    rejectlump = lumpnum + ML_REJECT;
+    rejectmatrix = W_CacheLumpNum(rejectlump, PU_STATIC);
+    empty = (buildreject && P_IsRejectEmpty(rejectlump));
+
+    //e6y: check for overflow
+    RejectOverrun(rejectlump, &rejectmatrix, totallines);
+
+    // [BH] build a table of our own if the map doesn't have one
+    if (empty)
+        P_StartRejectBuilder();
+}
+
+//
+// P_GroupLines
+// Builds sector line lists and subsector sector numbers.
+// Finds block bounding boxes for sectors.
+//
+// killough 5/3/98: reformatted, cleaned up
+// cph 18/8/99: rewritten to avoid O(numlines * numsectors) section
+// It makes things more complicated, but saves seconds on big levels
+
+// cph - convenient sub-function
+static void P_AddLineToSector(line_t *li, sector_t *sector)
+{
+    fixed_t     *bbox = (void *)sector->blockbox;
+
+    sector->lines[sector->linecount++] = li;
+    M_AddToBox(bbox, li->v1->x, li->v1->y);
+    M_AddToBox(bbox, li->v2->x, li->v2->y);
+}
+
+// modified to return totallines (needed by P_LoadReject)
+static int P_GroupLines(void)
+{
+    line_t      *li;
+    sector_t    *sector;
+    int         i, j, total = numlines;
+
+    // figgi
+    for (i = 0; i < numsubsectors; i++)
+    {
+        seg_t   *seg = &segs[subsectors[i].firstline];
+
+        subsectors[i].sector = NULL;
+        for (j = 0; j < subsectors[i].numlines; j++)
+        {
+            if (seg->sidedef)
+            {
+                subsectors[i].sector = seg->sidedef->sector;
+                break;
+            }
+            seg++;
+        }
+        if (!subsectors[i].sector)
+            I_Error("Subsector %s is not a part of any sector.", commify(i));
+    }
+
+    // count number of lines in each sector
+    for (i = 0, li = lines; i < numlines; i++, li++)
+    {
+        li->frontsector->linecount++;
+        if (li->backsector && li->backsector != li->frontsector)
+        {
+            li->backsector->linecount++;
+            total++;
+        }
+    }
+
+    // allocate line tables for each sector
+    {
+        line_t  **linebuffer = Z_Malloc(total * sizeof(line_t *), PU_LEVEL, NULL);
+
+        for (i = 0, sector = sectors; i < numsectors; i++, sector++)
+        {
+            sector->lines = linebuffer;
+            linebuffer += sector->linecount;
+            sector->linecount = 0;
+            M_ClearBox(sector->blockbox);
+        }
+    }
+
+    // Enter those lines
+    for (i = 0, li = lines; i < numlines; i++, li++)
+    {
+        P_AddLineToSector(li, li->frontsector);
+        if (li->backsector && li->backsector != li->frontsector)
+            P_AddLineToSector(li, li->backsector);
+    }
+
+    // [BH] find the unique sectors adjacent to each sector
+    {
+        int     *neighborbuffer = Z_Malloc(total * sizeof(*neighborbuffer), PU_LEVEL, NULL);
+        int     *lastneighbor = Z_Malloc(numsectors * sizeof(*lastneighbor), PU_STATIC, NULL);
+
+        for (i = 0; i < numsectors; i++)
+            lastneighbor[i] = -1;
+
+        for (i = 0, sector = sectors; i < numsectors; i++, sector++)
+        {
+            sector->neighbors = neighborbuffer;
+            sector->neighborcount = 0;
+            sector->neighborheightsvalid = false;
+
+            for (j = 0; j < sector->linecount; j++)
+            {
+                sector_t    *other = getNextSector(sector->lines[j], sector);
+
+                if (other && lastneighbor[other - sectors] != i)
+                {
+                    lastneighbor[other - sectors] = i;
+                    sector->neighbors[sector->neighborcount++] = (int)(other - sectors);
+                }
+            }
+
+            neighborbuffer += sector->neighborcount;
+        }
+
+        Z_Free(lastneighbor);
+    }
+
+    // [BH] build the graph of sectors that sound travels through
+    {
+        int             totaledges = 0;
+        soundedge_t     *edgebuffer;
+
+        for (i = 0, sector = sectors; i < numsectors; i++, sector++)
+        {
+            sector->soundedgecount = 0;
+            sector->moved = false;
+
+            for (j = 0; j < sector->linecount; j++)
+            {
+                li = sector->lines[j];
+
+                if ((li->flags & ML_TWOSIDED) && li->sidenum[1] != NO_INDEX)
+                    totaledges++;
+            }
+        }
+
+        edgebuffer = Z_Malloc(MAX(1, totaledges) * sizeof(*edgebuffer), PU_LEVEL, NULL);
+
+        for (i = 0, sector = sectors; i < numsectors; i++, sector++)
+        {
+            sector->soundedges = edgebuffer;
+
+            for (j = 0; j < sector->linecount; j++)
+            {
+                line_t  *line = sector->lines[j];
+
+                if ((line->flags & ML_TWOSIDED) && line->sidenum[1] != NO_INDEX)
+                {
+                    soundedge_t *edge = &sector->soundedges[sector->soundedgecount++];
+
+                    P_LineOpening(line);
+                    edge->sector = (int)(sides[line->sidenum[sides[line->sidenum[0]].sector == sector]].sector
+                        - sectors);
+                    edge->line = line;
+                    edge->soundblock = !!(line->flags & ML_SOUNDBLOCK);
+                    edge->open = (openrange > 0);
+                }
+            }
+
+            edgebuffer += sector->soundedgecount;
+        }
+    }
+
+    for (i = 0, sector = sectors; i < numsectors; i++, sector++)
+    {
+        fixed_t *bbox = (void*)sector->blockbox; // cph - For convenience, so
+        int     block;                           // I can use the old code unchanged
+
+        //e6y: fix sound origin for large levels
+        sector->soundorg.x = bbox[BOXRIGHT] / 2 + bbox[BOXLEFT] / 2;
+        sector->soundorg.y = bbox[BOXTOP] / 2 + bbox[BOXBOTTOM] / 2;
+
+        // adjust bounding box to map blocks
+        block = (bbox[BOXTOP] - bmaporgy + MAXRADIUS) >> MAPBLOCKSHIFT;
+        block = (block >= bmapheight ? bmapheight - 1 : block);
         sector->blockbox[BOXTOP] = block;
 
-        block = (bbox[BOXBOTTOM] - bmaporgy - MAXRADIUS) >> MAPBLOCKSHIFT;
-        block = (block < 0 ? 0 : block);
-        sector->blockbox[BOXBOTTOM] = block;
+        block = (bbox[BOXBOTTOM] - bmaporgy - MAXRADIUS) >> MAPBLOCKSHIFT;
+        block = (block < 0 ? 0 : block);
+        sector->blockbox[BOXBOTTOM] = block;
+
+        block = (bbox[BOXRIGHT] - bmaporgx + MAXRADIUS) >> MAPBLOCKSHIFT;
+        block = (block >= bmapwidth ? bmapwidth - 1 : block);
+        sector->blockbox[BOXRIGHT] = block;
+
+        block = (bbox[BOXLEFT] - bmaporgx - MAXRADIUS) >> MAPBLOCKSHIFT;
+        block = (block < 0 ? 0 : block);
+        sector->blockbox[BOXLEFT] = block;
+    }
+
+    return total;       // this value is needed by the reject overrun emulation code
+}
+
+//
+// killough 10/98
+//
+// Remove slime trails.
+//
+// Slime trails are inherent to DOOM's coordinate system -- i.e. there is
+// nothing that a node builder can do to prevent slime trails ALL of the time,
+// because it's a product of the integer coordinate system, and just because
+// two lines pass through exact integer coordinates, doesn't necessarily mean
+// that they will intersect at integer coordinates. Thus we must allow for
+// fractional coordinates if we are to be able to split segs with node lines,
+// as a node builder must do when creating a BSP tree.
+//
+// A wad file does not allow fractional coordinates, so node builders are out
+// of luck except that they can try to limit the number of splits (they might
+// also be able to detect the degree of roundoff error and try to avoid splits
+// with a high degree of roundoff error). But we can use fractional coordinates
+// here, inside the engine. It's like the difference between square inches and
+// square miles, in terms of granularity.
+//
+// For each vertex of every seg, check to see whether it's also a vertex of
+// the linedef associated with the seg (i.e, it's an endpoint). If it's not
+// an endpoint, and it wasn't already moved, move the vertex towards the
+// linedef by projecting it using the law of cosines. Formula:
+//
+//      2        2                         2        2
+//    dx  x0 + dy  x1 + dx dy (y0 - y1)  dy  y0 + dx  y1 + dx dy (x0 - x1)
+//   {---------------------------------, ---------------------------------}
+//                  2     2                            2     2
+//                dx  + dy                           dx  + dy
+//
+// (x0,y0) is the vertex being moved, and (x1,y1)-(x1+dx,y1+dy) is the
+// reference linedef.
+//
+// Segs corresponding to orthogonal linedefs (exactly vertical or horizontal
+// linedefs), which comprise at least half of all linedefs in most wads, don't
+// need to be considered, because they almost never contribute to slime trails
+// (because then any roundoff error is parallel to the linedef, which doesn't
+// cause slime). Skipping simple orthogonal lines lets the code finish quicker.
+//
+// Please note: This section of code is not interchangeable with TeamTNT's
+// code which attempts to fix the same problem.
+//
+// Firelines (TM) is a Registered Trademark of MBF Productions
+//
+
+static void P_RemoveSlimeTrails(void)                   // killough 10/98
+{
+    byte        *hit = calloc(1, numvertexes);          // Hitlist for vertices
+    int         i;
+
+    for (i = 0; i < numsegs; i++)                       // Go through each seg
+    {
+        const line_t    *l = segs[i].linedef;              // The parent linedef
+
+        if (l->dx && l->dy)                             // We can ignore orthogonal lines
+        {
+            vertex_t    *v = segs[i].v1;
+
+            do
+            {
+                if (!hit[v - vertexes])                 // If we haven't processed vertex
+                {
+                    hit[v - vertexes] = 1;              // Mark this vertex as processed
+
+                    if (v != l->v1 && v != l->v2)       // Exclude endpoints of linedefs
+                    {
+                        // Project the vertex back onto the parent linedef
+                        int64_t dx2 = (l->dx >> FRACBITS) * (l->dx >> FRACBITS);
+                        int64_t dy2 = (l->dy >> FRACBITS) * (l->dy >> FRACBITS);
+                        int64_t dxy = (l->dx >> FRACBITS) * (l->dy >> FRACBITS);
+                        int64_t s = dx2 + dy2;
+                        int     x0 = v->x, y0 = v->y, x1 = l->v1->x, y1 = l->v1->y;
+
+                        v->x = (fixed_t)((dx2 * x0 + dy2 * x1 + dxy * (y0 - y1)) / s);
+                        v->y = (fixed_t)((dy2 * y0 + dx2 * y1 + dxy * (x0 - x1)) / s);
+
+                        // [crispy] wait a minute... moved more than 8 map units?
+                        // maybe that's a linguortal then, back to the original coordinates
+                        if (ABS(v->x - x0) > 8 * FRACUNIT || ABS(v->y - y0) > 8 * FRACUNIT)
+                        {
+                            v->x = x0;
+                            v->y = y0;
+                        }
+                    }
+                }  // Obfuscated C contest entry:   :)
+            }
+            while (v != segs[i].v2 && (v = segs[i].v2));
+        }
+    }
+    free(hit);
+}
+
+// Precalc values for use later in long wall error fix in R_StoreWallRange()
+static void P_CalcSegsLength(void)
+{
+    int i;
+
+    for (i = 0; i < numsegs; i++)
+    {
+        seg_t   *li = segs + i;
+        int64_t dx = (int64_t)li->v2->x - li->v1->x;
+        int64_t dy = (int64_t)li->v2->y - li->v1->y;
+
+        li->length = (int64_t)sqrt((double)dx * dx + (double)dy * dy);
+
+        // [crispy] re-calculate angle used for rendering
+        li->angle = R_PointToAngleEx2(li->v1->x, li->v1->y, li->v2->x, li->v2->y);
+    }
+}
+
+//
+// LEVEL CACHE
+// [BH] The nodes, segs and subsectors of a map, its vertices both before and after slime trails
+// are removed, and any blockmap that had to be created are kept in a file in the levels folder
+// once the map has been loaded, named after a hash of its lumps. When the same map is loaded
+// again, these are read back in one go, and their pointers are fixed up, rather than being
+// built all over again.
+//
+#define LEVELCACHEVERSION       1
+
+typedef struct
+{
+    char        id[4];
+    int         version;
+    int         sizes[4];
+    int         numlines;
+    int         numsides;
+    int         numsectors;
+    int         numlumpvertexes;
+    int         numvertexes;
+    int         numsegs;
+    int         numsubsectors;
+    int         numnodes;
+    int         blockmaplength;
+    fixed_t     bmaporgx;
+    fixed_t     bmaporgy;
+    int         bmapwidth;
+    int         bmapheight;
+    int         boomlinespecials;
+} levelcacheheader_t;
+
+typedef struct
+{
+    fixed_t     x;
+    fixed_t     y;
+} levelcachevertex_t;
+
+typedef struct
+{
+    levelcacheheader_t  header;
+    byte                *data;
+    levelcachevertex_t  *vertexes;
+    levelcachevertex_t  *slimevertexes;
+    seg_t               *segs;
+    subsector_t         *subsectors;
+    node_t              *nodes;
+    unsigned short      *lineflags;
+    int                 *blockmaplump;
+} levelcache_t;
+
+dboolean                levelcache = levelcache_default;
+
+static char             *levelcachefolder;
+static char             *levelcachefile;
+static levelcachevertex_t *levelcachevertexes;
+
+//
+// P_HashLevel
+// Returns a hash of the lumps of the map that the cached data is built from.
+//
+static uint64_t P_HashLevel(int lumpnum)
+{
+    uint64_t    hash = 14695981039346656037ULL;
+    int         values[6] = { LEVELCACHEVERSION, mapformat, sizeof(vertex_t), sizeof(seg_t),
+                    sizeof(subsector_t), sizeof(node_t) };
+    int         lumps[] = { ML_LINEDEFS, ML_SIDEDEFS, ML_VERTEXES, ML_SEGS, ML_SSECTORS,
+                    ML_NODES, ML_SECTORS, ML_BLOCKMAP };
+    int         i;
+
+    for (i = 0; i < (int)sizeof(values); i++)
+    {
+        hash ^= ((byte *)values)[i];
+        hash *= 1099511628211ULL;
+    }
+
+    for (i = 0; i < (int)(sizeof(lumps) / sizeof(lumps[0])); i++)
+    {
+        int         lump = lumpnum + lumps[i];
+        int         length;
+        const byte  *data;
+        int         j;
+
+        if (lump >= numlumps || !(length = W_LumpLength(lump)))
+        {
+            hash ^= 0xFF;
+            hash *= 1099511628211ULL;
+            continue;
+        }
+
+        data = W_CacheLumpNum(lump, PU_STATIC);
+
+        for (j = 0; j < length; j++)
+        {
+            hash ^= data[j];
+            hash *= 1099511628211ULL;
+        }
+
+        for (j = 0; j < (int)sizeof(length); j++)
+        {
+            hash ^= ((byte *)&length)[j];
+            hash *= 1099511628211ULL;
+        }
+
+        W_ReleaseLumpNum(lump);
+    }
+
+    return hash;
+}
+
+//
+// P_ValidateLevelCache
+// Checks that every index in the cached data is in range before any of it is used.
+//
+static dboolean P_ValidateLevelCache(const levelcache_t *cache)
+{
+    const levelcacheheader_t    *header = &cache->header;
+    int                         i;
+
+    for (i = 0; i < header->numsegs; i++)
+    {
+        const seg_t *seg = &cache->segs[i];
+        intptr_t    v1 = (intptr_t)seg->v1;
+        intptr_t    v2 = (intptr_t)seg->v2;
+        intptr_t    sidedef = (intptr_t)seg->sidedef;
+        intptr_t    linedef = (intptr_t)seg->linedef;
+        intptr_t    frontsector = (intptr_t)seg->frontsector;
+        intptr_t    backsector = (intptr_t)seg->backsector;
+
+        if (v1 < 0 || v1 >= header->numvertexes || v2 < 0 || v2 >= header->numvertexes
+            || sidedef < 0 || sidedef >= header->numsides || linedef < 0 || linedef >= header->numlines
+            || frontsector < -1 || frontsector >= header->numsectors
+            || backsector < -1 || backsector >= header->numsectors)
+            return false;
+    }
+
+    for (i = 0; i < header->numsubsectors; i++)
+    {
+        const subsector_t   *subsector = &cache->subsectors[i];
+
+        if (subsector->firstline < 0 || subsector->numlines < 0
+            || subsector->firstline > header->numsegs - subsector->numlines)
+            return false;
+    }
+
+    for (i = 0; i < header->numnodes; i++)
+    {
+        int j;
+
+        for (j = 0; j < 2; j++)
+        {
+            int child = cache->nodes[i].children[j];
+
+            if (child != -1 && (child & NF_SUBSECTOR ? (child & ~NF_SUBSECTOR) >= header->numsubsectors :
+                child >= header->numnodes))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+//
+// P_ReadLevelCache
+// Reads the cached data for the current map, if there is any that can be used.
+//
+static levelcache_t *P_ReadLevelCache(int lumpnum)
+{
+    uint64_t            hash = P_HashLevel(lumpnum);
+    char                name[32];
+    FILE                *file;
+    levelcache_t        *cache;
+    levelcacheheader_t  *header;
+    long                length;
+    size_t              expected;
+    byte                *data;
+
+    if (!levelcachefolder)
+    {
+        char    *appdatafolder = M_GetAppDataFolder();
+
+        M_MakeDirectory(appdatafolder);
+        levelcachefolder = M_StringJoin(appdatafolder, DIR_SEPARATOR_S, "levels", DIR_SEPARATOR_S, NULL);
+        M_MakeDirectory(levelcachefolder);
+    }
+
+    M_snprintf(name, sizeof(name), "%08X%08X.level", (unsigned int)(hash >> 32), (unsigned int)hash);
+    free(levelcachefile);
+    levelcachefile = M_StringJoin(levelcachefolder, name, NULL);
+
+    if (!(file = fopen(levelcachefile, "rb")))
+        return NULL;
+
+    if ((length = M_FileLength(file)) < (long)sizeof(*header) || !(cache = calloc(1, sizeof(*cache))))
+    {
+        fclose(file);
+        return NULL;
+    }
+
+    if (!(cache->data = malloc(length)) || fread(cache->data, 1, length, file) != (size_t)length)
+    {
+        fclose(file);
+        free(cache->data);
+        free(cache);
+        return NULL;
+    }
+
+    fclose(file);
+
+    memcpy(&cache->header, cache->data, sizeof(cache->header));
+    header = &cache->header;
+
+    if (memcmp(header->id, "DRLC", 4) || header->version != LEVELCACHEVERSION
+        || header->sizes[0] != sizeof(vertex_t) || header->sizes[1] != sizeof(seg_t)
+        || header->sizes[2] != sizeof(subsector_t) || header->sizes[3] != sizeof(node_t)
+        || header->numlines != (int)(W_LumpLength(lumpnum + ML_LINEDEFS) / sizeof(maplinedef_t))
+        || header->numsides != (int)(W_LumpLength(lumpnum + ML_SIDEDEFS) / sizeof(mapsidedef_t))
+        || header->numsectors != (int)(W_LumpLength(lumpnum + ML_SECTORS) / sizeof(mapsector_t))
+        || header->numlumpvertexes != (int)(W_LumpLength(lumpnum + ML_VERTEXES) / sizeof(mapvertex_t))
+        || header->numvertexes < header->numlumpvertexes || header->numsegs <= 0 || header->numsubsectors <= 0
+        || header->numnodes < 0 || header->blockmaplength < 0)
+    {
+        free(cache->data);
+        free(cache);
+        return NULL;
+    }
+
+    expected = sizeof(*header) + (size_t)header->numvertexes * 2 * sizeof(levelcachevertex_t)
+        + (size_t)header->numsegs * sizeof(seg_t) + (size_t)header->numsubsectors * sizeof(subsector_t)
+        + (size_t)header->numnodes * sizeof(node_t) + (size_t)header->numlines * sizeof(unsigned short)
+        + (size_t)header->blockmaplength * sizeof(int);
+
+    if (expected != (size_t)length)
+    {
+        free(cache->data);
+        free(cache);
+        return NULL;
+    }
+
+    // point into the data, copying out anything that must be aligned
+    data = cache->data + sizeof(*header);
+    cache->vertexes = malloc(header->numvertexes * 2 * sizeof(levelcachevertex_t));
+    cache->segs = malloc(header->numsegs * sizeof(seg_t));
+    cache->subsectors = malloc(header->numsubsectors * sizeof(subsector_t));
+    cache->nodes = malloc(MAX(1, header->numnodes) * sizeof(node_t));
+    cache->lineflags = malloc(MAX(1, header->numlines) * sizeof(unsigned short));
+    cache->blockmaplump = (header->blockmaplength ? malloc(header->blockmaplength * sizeof(int)) : NULL);
+
+    if (!cache->vertexes || !cache->segs || !cache->subsectors || !cache->nodes || !cache->lineflags
+        || (header->blockmaplength && !cache->blockmaplump))
+    {
+        free(cache->vertexes);
+        free(cache->segs);
+        free(cache->subsectors);
+        free(cache->nodes);
+        free(cache->lineflags);
+        free(cache->blockmaplump);
+        free(cache->data);
+        free(cache);
+        return NULL;
+    }
+
+    memcpy(cache->vertexes, data, header->numvertexes * 2 * sizeof(levelcachevertex_t));
+    cache->slimevertexes = cache->vertexes + header->numvertexes;
+    data += header->numvertexes * 2 * sizeof(levelcachevertex_t);
+    memcpy(cache->segs, data, header->numsegs * sizeof(seg_t));
+    data += header->numsegs * sizeof(seg_t);
+    memcpy(cache->subsectors, data, header->numsubsectors * sizeof(subsector_t));
+    data += header->numsubsectors * sizeof(subsector_t);
+    memcpy(cache->nodes, data, header->numnodes * sizeof(node_t));
+    data += header->numnodes * sizeof(node_t);
+    memcpy(cache->lineflags, data, header->numlines * sizeof(unsigned short));
+    data += header->numlines * sizeof(unsigned short);
+
+    if (header->blockmaplength)
+        memcpy(cache->blockmaplump, data, header->blockmaplength * sizeof(int));
+
+    free(cache->data);
+    cache->data = NULL;
+
+    if (!P_ValidateLevelCache(cache))
+    {
+        free(cache->vertexes);
+        free(cache->segs);
+        free(cache->subsectors);
+        free(cache->nodes);
+        free(cache->lineflags);
+        free(cache->blockmaplump);
+        free(cache);
+        return NULL;
+    }
+
+    return cache;
+}
+
+//
+// P_FreeLevelCache
+// Frees whatever of the cached data hasn't been handed over to the map.
+//
+static void P_FreeLevelCache(levelcache_t *cache)
+{
+    free(cache->vertexes);
+    free(cache->segs);
+    free(cache->subsectors);
+    free(cache->nodes);
+    free(cache->lineflags);
+    free(cache->blockmaplump);
+    free(cache);
+}
+
+//
+// P_LoadCachedBlockMap
+// Uses the blockmap that was created for the map when it was cached.
+//
+static void P_LoadCachedBlockMap(levelcache_t *cache)
+{
+    blockmaplump = cache->blockmaplump;
+    blockmaplength = cache->header.blockmaplength;
+    cache->blockmaplump = NULL;
+
+    bmaporgx = cache->header.bmaporgx;
+    bmaporgy = cache->header.bmaporgy;
+    bmapwidth = cache->header.bmapwidth;
+    bmapheight = cache->header.bmapheight;
+    blockmaprecreated = true;
+}
+
+//
+// P_LoadCachedNodes
+// Replaces the vertices, and loads the segs, subsectors and nodes, from the cached data.
+//
+static void P_LoadCachedNodes(levelcache_t *cache)
+{
+    const levelcacheheader_t    *header = &cache->header;
+    vertex_t                    *newvertexes = calloc(header->numvertexes, sizeof(vertex_t));
+    int                         i;
+
+    if (!newvertexes)
+        I_Error("Unable to load the cached nodes.");
+
+    for (i = 0; i < header->numvertexes; i++)
+    {
+        newvertexes[i].x = cache->vertexes[i].x;
+        newvertexes[i].y = cache->vertexes[i].y;
+    }
+
+    for (i = 0; i < numlines; i++)
+    {
+        lines[i].v1 = newvertexes + (lines[i].v1 - vertexes);
+        lines[i].v2 = newvertexes + (lines[i].v2 - vertexes);
+        lines[i].flags = cache->lineflags[i];
+    }
+
+    free(vertexes);
+    vertexes = newvertexes;
+    numvertexes = header->numvertexes;
+
+    // fix up the pointers in each seg
+    if (samelevel)
+        free(segs);
+
+    segs = cache->segs;
+    cache->segs = NULL;
+    numsegs = header->numsegs;
+
+    for (i = 0; i < numsegs; i++)
+    {
+        seg_t       *seg = &segs[i];
+        intptr_t    frontsector = (intptr_t)seg->frontsector;
+        intptr_t    backsector = (intptr_t)seg->backsector;
+
+        seg->v1 = vertexes + (intptr_t)seg->v1;
+        seg->v2 = vertexes + (intptr_t)seg->v2;
+        seg->sidedef = sides + (intptr_t)seg->sidedef;
+        seg->linedef = lines + (intptr_t)seg->linedef;
+        seg->frontsector = (frontsector == -1 ? NULL : sectors + frontsector);
+        seg->backsector = (backsector == -1 ? NULL : sectors + backsector);
+    }
+
+    if (samelevel)
+    {
+        free(subsectors);
+        free(nodes);
+    }
+
+    subsectors = cache->subsectors;
+    cache->subsectors = NULL;
+    numsubsectors = header->numsubsectors;
+
+    nodes = cache->nodes;
+    cache->nodes = NULL;
+    numnodes = header->numnodes;
+
+    boomlinespecials = header->boomlinespecials;
+}
+
+//
+// P_RemoveCachedSlimeTrails
+// Moves the vertices to where P_RemoveSlimeTrails() put them when the map was cached.
+//
+static void P_RemoveCachedSlimeTrails(const levelcache_t *cache)
+{
+    int i;
+
+    for (i = 0; i < numvertexes; i++)
+    {
+        vertexes[i].x = cache->slimevertexes[i].x;
+        vertexes[i].y = cache->slimevertexes[i].y;
+    }
+}
+
+//
+// P_SaveLevelVertexes
+// Keeps the vertices as they are before slime trails are removed, so they can be cached.
+//
+static void P_SaveLevelVertexes(void)
+{
+    int i;
+
+    free(levelcachevertexes);
+
+    if (!(levelcachevertexes = malloc(numvertexes * sizeof(*levelcachevertexes))))
+        return;
+
+    for (i = 0; i < numvertexes; i++)
+    {
+        levelcachevertexes[i].x = vertexes[i].x;
+        levelcachevertexes[i].y = vertexes[i].y;
+    }
+}
+
+//
+// P_WriteLevelCache
+// Writes the cached data for the current map, once it has been fully loaded.
+//
+static void P_WriteLevelCache(int numlumpvertexes)
+{
+    levelcacheheader_t  header;
+    size_t              length;
+    byte                *buffer;
+    byte                *data;
+    char                *tempfile;
+    int                 i;
+
+    if (!levelcachefile || !levelcachevertexes)
+        return;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.id, "DRLC", 4);
+    header.version = LEVELCACHEVERSION;
+    header.sizes[0] = sizeof(vertex_t);
+    header.sizes[1] = sizeof(seg_t);
+    header.sizes[2] = sizeof(subsector_t);
+    header.sizes[3] = sizeof(node_t);
+    header.numlines = numlines;
+    header.numsides = numsides;
+    header.numsectors = numsectors;
+    header.numlumpvertexes = numlumpvertexes;
+    header.numvertexes = numvertexes;
+    header.numsegs = numsegs;
+    header.numsubsectors = numsubsectors;
+    header.numnodes = numnodes;
+    header.blockmaplength = (blockmaprecreated ? blockmaplength : 0);
+    header.bmaporgx = bmaporgx;
+    header.bmaporgy = bmaporgy;
+    header.bmapwidth = bmapwidth;
+    header.bmapheight = bmapheight;
+    header.boomlinespecials = boomlinespecials;
+
+    length = sizeof(header) + (size_t)numvertexes * 2 * sizeof(levelcachevertex_t)
+        + (size_t)numsegs * sizeof(seg_t) + (size_t)numsubsectors * sizeof(subsector_t)
+        + (size_t)numnodes * sizeof(node_t) + (size_t)numlines * sizeof(unsigned short)
+        + (size_t)header.blockmaplength * sizeof(int);
+
+    if (!(buffer = malloc(length)))
+        return;
+
+    data = buffer;
+    memcpy(data, &header, sizeof(header));
+    data += sizeof(header);
+    memcpy(data, levelcachevertexes, numvertexes * sizeof(levelcachevertex_t));
+    data += numvertexes * sizeof(levelcachevertex_t);
+
+    for (i = 0; i < numvertexes; i++)
+    {
+        levelcachevertex_t  vertex;
+
+        vertex.x = vertexes[i].x;
+        vertex.y = vertexes[i].y;
+        memcpy(data, &vertex, sizeof(vertex));
+        data += sizeof(vertex);
+    }
+
+    // replace the pointers in each seg with indices
+    for (i = 0; i < numsegs; i++)
+    {
+        seg_t   seg = segs[i];
+
+        if (seg.sidedef < sides || seg.sidedef >= sides + numsides)
+        {
+            free(buffer);
+            return;
+        }
+
+        seg.v1 = (vertex_t *)(intptr_t)(segs[i].v1 - vertexes);
+        seg.v2 = (vertex_t *)(intptr_t)(segs[i].v2 - vertexes);
+        seg.sidedef = (side_t *)(intptr_t)(segs[i].sidedef - sides);
+        seg.linedef = (line_t *)(intptr_t)(segs[i].linedef - lines);
+        seg.frontsector = (sector_t *)(intptr_t)(segs[i].frontsector ? segs[i].frontsector - sectors : -1);
+        seg.backsector = (sector_t *)(intptr_t)(segs[i].backsector ? segs[i].backsector - sectors : -1);
+        memcpy(data, &seg, sizeof(seg));
+        data += sizeof(seg);
+    }
+
+    for (i = 0; i < numsubsectors; i++)
+    {
+        subsector_t subsector = subsectors[i];
+
+        subsector.sector = NULL;
+        memcpy(data, &subsector, sizeof(subsector));
+        data += sizeof(subsector);
+    }
+
+    memcpy(data, nodes, numnodes * sizeof(node_t));
+    data += numnodes * sizeof(node_t);
+
+    for (i = 0; i < numlines; i++)
+    {
+        memcpy(data, &lines[i].flags, sizeof(unsigned short));
+        data += sizeof(unsigned short);
+    }
+
+    if (header.blockmaplength)
+        memcpy(data, blockmaplump, header.blockmaplength * sizeof(int));
 
-        block = (bbox[BOXRIGHT] - bmaporgx + MAXRADIUS) >> MAPBLOCKSHIFT;
-        block = (block >= bmapwidth ? bmapwidth - 1 : block);
-        sector->blockbox[BOXRIGHT] = block;
+    tempfile = M_StringJoin(levelcachefile, ".tmp", NULL);
+    M_WriteFileSafely(levelcachefile, tempfile, buffer, length);
+    free(tempfile);
+    free(buffer);
+}
 
-        block = (bbox[BOXLEFT] - bmaporgx - MAXRADIUS) >> MAPBLOCKSHIFT;
-        block = (block < 0 ? 0 : block);
-        sector->blockbox[BOXLEFT] = block;
+//
+// PARALLEL LOADING
+// [BH] The vertices, sectors, blockmap, subsectors and nodes of a map don't depend on each other,
+// so once their lumps have been cached, they are parsed at the same time by I_RunJobs(). Anything
+// that uses the zone memory allocator or the console is done before or after, on the main thread.
+//
+typedef enum
+{
+    lj_vertexes,
+    lj_sectors,
+    lj_blockmap,
+    lj_nodes,
+    lj_nodes_v4
+} loadjobtype_t;
+
+typedef struct
+{
+    loadjobtype_t   type;
+    const void      *data;
+    const void      *data2;
+} loadjob_t;
+
+static void P_LoadJob(void *data, int job, int worker)
+{
+    const loadjob_t *loadjob = (const loadjob_t *)data + job;
+
+    switch (loadjob->type)
+    {
+        case lj_vertexes:
+            P_ParseVertexes(loadjob->data);
+            break;
+
+        case lj_sectors:
+            P_ParseSectors(loadjob->data);
+            break;
+
+        case lj_blockmap:
+            P_ParseBlockMap(loadjob->data);
+            break;
+
+        case lj_nodes:
+            P_ParseSubsectors(loadjob->data);
+            P_ParseNodes(loadjob->data2);
+            break;
+
+        case lj_nodes_v4:
+            P_ParseSubsectors_V4(loadjob->data);
+            P_ParseNodes_V4(loadjob->data2);
+            break;
     }
+}
 
-    return total;       // this value is needed by the reject overrun emulation code
+//
+// P_LoadMapLumps
+// Loads the vertices and sectors of the map, and also its blockmap, subsectors and nodes unless
+// they are in the level cache, the blockmap needs to be created, or the map has ZDBSP nodes.
+//
+static void P_LoadMapLumps(int lumpnum, const levelcache_t *cache)
+{
+    loadjob_t   jobs[4];
+    int         numjobs = 0;
+    short       *wadblockmaplump = NULL;
+    int         i;
+
+    jobs[numjobs].type = lj_vertexes;
+    jobs[numjobs++].data = P_CacheVertexes(lumpnum + ML_VERTEXES);
+
+    jobs[numjobs].type = lj_sectors;
+    jobs[numjobs++].data = P_CacheSectors(lumpnum + ML_SECTORS);
+
+    if (!samelevel && !(cache && cache->blockmaplump)
+        && (wadblockmaplump = P_CacheBlockMap(lumpnum + ML_BLOCKMAP)))
+    {
+        jobs[numjobs].type = lj_blockmap;
+        jobs[numjobs++].data = wadblockmaplump;
+    }
+
+    if (!cache && mapformat != ZDBSPX)
+    {
+        if (mapformat == DEEPBSP)
+        {
+            jobs[numjobs].type = lj_nodes_v4;
+            jobs[numjobs].data = P_CacheSubsectors_V4(lumpnum + ML_SSECTORS);
+            jobs[numjobs++].data2 = P_CacheNodes_V4(lumpnum + ML_NODES);
+        }
+        else
+        {
+            jobs[numjobs].type = lj_nodes;
+            jobs[numjobs].data = P_CacheSubsectors(lumpnum + ML_SSECTORS);
+            jobs[numjobs++].data2 = P_CacheNodes(lumpnum + ML_NODES);
+        }
+    }
+
+    // [BH] r_fixmaperrors warns about what it changes, so don't use the workers if it might
+    if (canmodify && r_fixmaperrors)
+        for (i = 0; i < numjobs; i++)
+            P_LoadJob(jobs, i, 0);
+    else
+        I_RunJobs(P_LoadJob, jobs, numjobs);
+
+    P_CheckSectors(jobs[1].data);
+    W_ReleaseLumpNum(lumpnum + ML_VERTEXES);
+    W_ReleaseLumpNum(lumpnum + ML_SECTORS);
+
+    for (i = 2; i < numjobs; i++)
+        if (jobs[i].type == lj_blockmap)
+            Z_Free(wadblockmaplump);
+        else
+        {
+            if (jobs[i].type == lj_nodes)
+                P_CheckNodes();
+
+            W_ReleaseLumpNum(lumpnum + ML_SSECTORS);
+            W_ReleaseLumpNum(lumpnum + ML_NODES);
+        }
 }
 
 //
-// killough 10/98
+// LEVEL PREFETCHING
+// [BH] While the intermission screen is shown, the lumps of the next map, and the flats, textures
+// and sprites it uses, are cached a little at a time, so that P_SetupLevel() and R_PrecacheLevel()
+// find most of them already in memory. This is done on the main thread rather than a background
+// one, since neither the zone memory allocator nor the WADs that lumps are read from can be shared
+// between threads.
 //
-// Remove slime trails.
+#define PREFETCHTIME    2       // milliseconds spent prefetching each tic
+
+typedef enum
+{
+    pf_none,
+    pf_maplumps,
+    pf_sectors,
+    pf_sidedefs,
+    pf_things
+} prefetchstage_t;
+
+static prefetchstage_t  prefetchstage = pf_none;
+static int              prefetchlumpnum;
+static int              prefetchlump;
+static int              prefetchindex;
+static int              prefetchcount;
+static const byte       *prefetchdata;
+
 //
-// Slime trails are inherent to DOOM's coordinate system -- i.e. there is
-// nothing that a node builder can do to prevent slime trails ALL of the time,
-// because it's a product of the integer coordinate system, and just because
-// two lines pass through exact integer coordinates, doesn't necessarily mean
-// that they will intersect at integer coordinates. Thus we must allow for
-// fractional coordinates if we are to be able to split segs with node lines,
-// as a node builder must do when creating a BSP tree.
+// P_CheckMapLumpNum
+// Returns the lump number of a map like P_SetupLevel() finds it, or -1 if it doesn't exist.
 //
-// A wad file does not allow fractional coordinates, so node builders are out
-// of luck except that they can try to limit the number of splits (they might
-// also be able to detect the degree of roundoff error and try to avoid splits
-// with a high degree of roundoff error). But we can use fractional coordinates
-// here, inside the engine. It's like the difference between square inches and
-// square miles, in terms of granularity.
+static int P_CheckMapLumpNum(int ep, int map)
+{
+    char    lumpname[6];
+
+    if (gamemode == commercial)
+        M_snprintf(lumpname, 6, "MAP%02i", map);
+    else
+        M_snprintf(lumpname, 5, "E%iM%i", ep, map);
+
+    if (nerve && gamemission == doom2)
+    {
+        int i;
+
+        for (i = 0; i < numlumps; i++)
+            if (!strncasecmp(lumpinfo[i]->name, lumpname, 8))
+                return i;
+
+        return -1;
+    }
+
+    return W_CheckNumForName(lumpname);
+}
+
 //
-// For each vertex of every seg, check to see whether it's also a vertex of
-// the linedef associated with the seg (i.e, it's an endpoint). If it's not
-// an endpoint, and it wasn't already moved, move the vertex towards the
-// linedef by projecting it using the law of cosines. Formula:
+// P_PrefetchLump
+// Caches a lump, unless it's already in memory.
 //
-//      2        2                         2        2
-//    dx  x0 + dy  x1 + dx dy (y0 - y1)  dy  y0 + dx  y1 + dx dy (x0 - x1)
-//   {---------------------------------, ---------------------------------}
-//                  2     2                            2     2
-//                dx  + dy                           dx  + dy
+static void P_PrefetchLump(int lump)
+{
+    if (lump >= 0 && lump < numlumps && !lumpinfo[lump]->cache)
+        W_CacheLumpNum(lump, PU_CACHE);
+}
+
 //
-// (x0,y0) is the vertex being moved, and (x1,y1)-(x1+dx,y1+dy) is the
-// reference linedef.
+// P_PrefetchFlat
 //
-// Segs corresponding to orthogonal linedefs (exactly vertical or horizontal
-// linedefs), which comprise at least half of all linedefs in most wads, don't
-// need to be considered, because they almost never contribute to slime trails
-// (because then any roundoff error is parallel to the linedef, which doesn't
-// cause slime). Skipping simple orthogonal lines lets the code finish quicker.
+static void P_PrefetchFlat(const char *name)
+{
+    int flat = R_CheckFlatNumForName((char *)name);
+
+    if (flat != -1)
+        P_PrefetchLump(firstflat + flat);
+}
+
 //
-// Please note: This section of code is not interchangeable with TeamTNT's
-// code which attempts to fix the same problem.
+// P_PrefetchTexture
 //
-// Firelines (TM) is a Registered Trademark of MBF Productions
+static void P_PrefetchTexture(const char *name)
+{
+    int texture = R_CheckTextureNumForName((char *)name);
+
+    if (texture > 0)
+    {
+        int i;
+
+        for (i = 0; i < textures[texture]->patchcount; i++)
+            P_PrefetchLump(textures[texture]->patches[i].patch);
+    }
+}
+
 //
+// P_PrefetchThing
+// Caches the frames of the sprite that a thing is spawned with.
+//
+static void P_PrefetchThing(short type)
+{
+    mobjtype_t  i = P_FindDoomedNum(SHORT(type));
+    int         sprite;
+    int         j;
 
-static void P_RemoveSlimeTrails(void)                   // killough 10/98
+    if (i == NUMMOBJTYPES || (sprite = states[mobjinfo[i].spawnstate].sprite) < 0 || sprite >= NUMSPRITES)
+        return;
+
+    for (j = 0; j < sprites[sprite].numframes; j++)
+    {
+        short   *lump = sprites[sprite].spriteframes[j].lump;
+        int     k;
+
+        for (k = 0; k < 8; k++)
+            P_PrefetchLump(firstspritelump + lump[k]);
+    }
+}
+
+//
+// P_BeginPrefetchStage
+// Holds the map lump that the next stage looks through, so it can't be purged until it's done.
+//
+static void P_BeginPrefetchStage(prefetchstage_t stage, int lump, size_t size)
 {
-    byte        *hit = calloc(1, numvertexes);          // Hitlist for vertices
-    int         i;
+    prefetchstage = stage;
+    prefetchlump = prefetchlumpnum + lump;
+    prefetchindex = 0;
 
-    for (i = 0; i < numsegs; i++)                       // Go through each seg
+    if (prefetchlump < numlumps)
     {
-        const line_t    *l = segs[i].linedef;              // The parent linedef
+        prefetchcount = W_LumpLength(prefetchlump) / (int)size;
+        prefetchdata = W_CacheLumpNum(prefetchlump, PU_STATIC);
+    }
+    else
+    {
+        prefetchcount = 0;
+        prefetchdata = NULL;
+    }
+}
 
-        if (l->dx && l->dy)                             // We can ignore orthogonal lines
-        {
-            vertex_t    *v = segs[i].v1;
+static void P_EndPrefetchStage(void)
+{
+    if (prefetchdata)
+    {
+        W_ReleaseLumpNum(prefetchlump);
+        prefetchdata = NULL;
+    }
+}
 
-            do
-            {
-                if (!hit[v - vertexes])                 // If we haven't processed vertex
-                {
-                    hit[v - vertexes] = 1;              // Mark this vertex as processed
+//
+// P_StopPrefetch
+//
+static void P_StopPrefetch(void)
+{
+    P_EndPrefetchStage();
+    prefetchstage = pf_none;
+}
 
-                    if (v != l->v1 && v != l->v2)       // Exclude endpoints of linedefs
-                    {
-                        // Project the vertex back onto the parent linedef
-                        int64_t dx2 = (l->dx >> FRACBITS) * (l->dx >> FRACBITS);
-                        int64_t dy2 = (l->dy >> FRACBITS) * (l->dy >> FRACBITS);
-                        int64_t dxy = (l->dx >> FRACBITS) * (l->dy >> FRACBITS);
-                        int64_t s = dx2 + dy2;
-                        int     x0 = v->x, y0 = v->y, x1 = l->v1->x, y1 = l->v1->y;
+//
+// P_StartPrefetch
+// Called by WI_Start() to start prefetching the map that will be loaded next.
+//
+void P_StartPrefetch(int ep, int map)
+{
+    P_StopPrefetch();
 
-                        v->x = (fixed_t)((dx2 * x0 + dy2 * x1 + dxy * (y0 - y1)) / s);
-                        v->y = (fixed_t)((dy2 * y0 + dx2 * y1 + dxy * (x0 - x1)) / s);
+    if ((prefetchlumpnum = P_CheckMapLumpNum(ep, map)) == -1)
+        return;
 
-                        // [crispy] wait a minute... moved more than 8 map units?
-                        // maybe that's a linguortal then, back to the original coordinates
-                        if (ABS(v->x - x0) > 8 * FRACUNIT || ABS(v->y - y0) > 8 * FRACUNIT)
-                        {
-                            v->x = x0;
-                            v->y = y0;
-                        }
-                    }
-                }  // Obfuscated C contest entry:   :)
-            }
-            while (v != segs[i].v2 && (v = segs[i].v2));
-        }
-    }
-    free(hit);
+    prefetchstage = pf_maplumps;
+    prefetchindex = ML_THINGS;
 }
 
-// Precalc values for use later in long wall error fix in R_StoreWallRange()
-static void P_CalcSegsLength(void)
+//
+// P_UpdatePrefetch
+// Called by WI_Ticker() to prefetch a little more of the next map.
+//
+void P_UpdatePrefetch(void)
 {
-    int i;
+    int starttime;
 
-    for (i = 0; i < numsegs; i++)
+    if (prefetchstage == pf_none)
+        return;
+
+    starttime = I_GetTimeMS();
+
+    do
     {
-        seg_t   *li = segs + i;
-        int64_t dx = (int64_t)li->v2->x - li->v1->x;
-        int64_t dy = (int64_t)li->v2->y - li->v1->y;
+        switch (prefetchstage)
+        {
+            case pf_maplumps:
+                if (prefetchindex <= ML_BLOCKMAP)
+                    P_PrefetchLump(prefetchlumpnum + prefetchindex++);
+                else
+                    P_BeginPrefetchStage(pf_sectors, ML_SECTORS, sizeof(mapsector_t));
 
-        li->length = (int64_t)sqrt((double)dx * dx + (double)dy * dy);
+                break;
 
-        // [crispy] re-calculate angle used for rendering
-        li->angle = R_PointToAngleEx2(li->v1->x, li->v1->y, li->v2->x, li->v2->y);
-    }
+            case pf_sectors:
+                if (prefetchindex < prefetchcount)
+                {
+                    const mapsector_t   *ms = (const mapsector_t *)prefetchdata + prefetchindex++;
+
+                    P_PrefetchFlat(ms->floorpic);
+                    P_PrefetchFlat(ms->ceilingpic);
+                }
+                else
+                {
+                    P_EndPrefetchStage();
+                    P_BeginPrefetchStage(pf_sidedefs, ML_SIDEDEFS, sizeof(mapsidedef_t));
+                }
+
+                break;
+
+            case pf_sidedefs:
+                if (prefetchindex < prefetchcount)
+                {
+                    const mapsidedef_t  *msd = (const mapsidedef_t *)prefetchdata + prefetchindex++;
+
+                    P_PrefetchTexture(msd->toptexture);
+                    P_PrefetchTexture(msd->midtexture);
+                    P_PrefetchTexture(msd->bottomtexture);
+                }
+                else
+                {
+                    P_EndPrefetchStage();
+                    P_BeginPrefetchStage(pf_things, ML_THINGS, sizeof(mapthing_t));
+                }
+
+                break;
+
+            case pf_things:
+                if (prefetchindex < prefetchcount)
+                    P_PrefetchThing(((const mapthing_t *)prefetchdata + prefetchindex++)->type);
+                else
+                    P_StopPrefetch();
+
+                break;
+
+            default:
+                break;
+        }
+    } while (prefetchstage != pf_none && I_GetTimeMS() - starttime < PREFETCHTIME);
 }
 
 char            mapnum[6];
@@ -2077,9 +3899,13 @@ extern dboolean massacre;
 //
 void P_SetupLevel(int ep, int map)
 {
-    char        lumpname[6];
-    int         lumpnum;
-    player_t    *player = &players[0];
+    char            lumpname[6];
+    int             lumpnum;
+    int             numlumpvertexes;
+    player_t        *player = &players[0];
+    dboolean        cachelevel;
+    levelcache_t    *cache;
+    thread_t        *blockmapthread = NULL;
 
     totalkills = totalitems = totalsecret = 0;
     memset(monstercount, 0, sizeof(int) * NUMMOBJTYPES);
@@ -2100,7 +3926,13 @@ void P_SetupLevel(int ep, int map)
 
     idclev = false;
 
+    P_StopRejectBuilder();
+    P_StopPrefetch();
+
     Z_FreeTags(PU_LEVEL, PU_PURGELEVEL - 1);
+    P_InitMobjPool();
+    P_InitBloodSplats();
+    P_InitSensing();
 
     if (rejectlump != -1)
     {
@@ -2159,43 +3991,84 @@ void P_SetupLevel(int ep, int map)
         free(vertexes);
     }
 
+    // [BH] maps that r_fixmaperrors changes are never cached
+    cachelevel = (levelcache && !(canmodify && r_fixmaperrors));
+    cache = (cachelevel ? P_ReadLevelCache(lumpnum) : NULL);
+
     // note: most of this ordering is important
-    P_LoadVertexes(lumpnum + ML_VERTEXES);
-    P_LoadSectors(lumpnum + ML_SECTORS);
+    P_LoadMapLumps(lumpnum, cache);
+    numlumpvertexes = numvertexes;
     P_LoadSideDefs(lumpnum + ML_SIDEDEFS);
     P_LoadLineDefs(lumpnum + ML_LINEDEFS);
     P_LoadSideDefs2(lumpnum + ML_SIDEDEFS);
     P_LoadLineDefs2(lumpnum + ML_LINEDEFS);
 
     if (!samelevel)
-        P_LoadBlockMap(lumpnum + ML_BLOCKMAP);
-    else
-        memset(blocklinks, 0, bmapwidth * bmapheight * sizeof(*blocklinks));
+    {
+        if (cache && cache->blockmaplump)
+            P_LoadCachedBlockMap(cache);
+        else if (blockmaprecreated)
+        {
+            // [BH] Create the blockmap while the segs are loaded, unless the vertices are about to
+            // be replaced by those in the level cache or ZDBSP nodes.
+            if (cache || mapformat == ZDBSPX
+                || !(blockmapthread = I_StartThread(P_CreateBlockMapThread, "Blockmap builder", NULL)))
+                P_CreateBlockMap();
+        }
+    }
 
-    if (mapformat == ZDBSPX)
+    if (cache)
+        P_LoadCachedNodes(cache);
+    else if (mapformat == ZDBSPX)
         P_LoadZNodes(lumpnum + ML_NODES);
     else if (mapformat == DEEPBSP)
-    {
-        P_LoadSubsectors_V4(lumpnum + ML_SSECTORS);
-        P_LoadNodes_V4(lumpnum + ML_NODES);
         P_LoadSegs_V4(lumpnum + ML_SEGS);
-    }
     else
-    {
-        P_LoadSubsectors(lumpnum + ML_SSECTORS);
-        P_LoadNodes(lumpnum + ML_NODES);
         P_LoadSegs(lumpnum + ML_SEGS);
-    }
+
+    if (blockmapthread)
+        I_WaitThread(blockmapthread, false);
+
+    if (!samelevel)
+        P_FinishBlockMap();
+    else
+        memset(blocklinks, 0, bmapwidth * bmapheight * sizeof(*blocklinks));
 
     // reject loading and underflow padding separated out into new function
     // P_GroupLines modified to return a number the underflow padding needs
     P_LoadReject(lumpnum, P_GroupLines());
 
-    P_RemoveSlimeTrails();
+    P_InitQueryContext(&gamequery);
+    P_InitQueryContext(&renderquery);
+    P_InitSoundQueue();
+    P_InitHitscanBatches();
+    P_InitBlockThings();
+
+    if (cache)
+    {
+        P_RemoveCachedSlimeTrails(cache);
+        P_FreeLevelCache(cache);
+    }
+    else
+    {
+        if (cachelevel)
+            P_SaveLevelVertexes();
 
-    P_CalcSegsLength();
+        P_RemoveSlimeTrails();
+
+        P_CalcSegsLength();
+
+        if (cachelevel)
+            P_WriteLevelCache(numlumpvertexes);
+
+        free(levelcachevertexes);
+        levelcachevertexes = NULL;
+    }
 
     r_bloodsplats_total = 0;
+    sightchecks = 0;
+    sightcachehits = 0;
+    P_ClearSightCache();
     P_BloodSplatSpawner = (r_blood == r_blood_none || !r_bloodsplats_max ?
         P_NullBloodSplatSpawner : P_SpawnBloodSplat);
 
@@ -41,6 +41,9 @@
 
 void P_SetupLevel(int ep, int map);
 void P_MapName(int ep, int map);
+void P_UpdateReject(void);
+void P_StartPrefetch(int ep, int map);
+void P_UpdatePrefetch(void);
 
 // Called by startup code.
 void P_Init(void);
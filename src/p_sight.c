@@ -38,6 +38,7 @@
 
 #include "m_bbox.h"
 #include "p_local.h"
+#include "z_zone.h"
 
 //
 // P_CheckSight
@@ -52,9 +53,44 @@ typedef struct
     fixed_t     topslope, bottomslope;  // slopes to top and bottom of target
     fixed_t     bbox[4];
     fixed_t     maxz, minz;             // cph - z optimizations for 2sided lines
+    querycontext_t  *query;             // [BH] lines visited
 } los_t;
 
-static los_t    los; // cph - made static
+//
+// SIGHT CACHE
+// [BH] The result of each line of sight traced through the BSP is cached until the end of
+// the tic, keyed on both mobjs and their positions and heights. The cache is also cleared
+// whenever a floor or ceiling moves, so a cached result is always the same as a traced one.
+//
+#define SIGHTCACHESIZE  16384
+
+typedef struct
+{
+    mobj_t              *t1;
+    mobj_t              *t2;
+    fixed_t             t1x, t1y, t1z, t1height;
+    fixed_t             t2x, t2y, t2z, t2height;
+    unsigned int        stamp;
+    dboolean            result;
+} sightcache_t;
+
+static sightcache_t     sightcache[SIGHTCACHESIZE];
+static unsigned int     sightcachestamp = 1;
+
+int64_t                 sightchecks;
+int64_t                 sightcachehits;
+
+//
+// P_ClearSightCache
+//
+void P_ClearSightCache(void)
+{
+    if (!++sightcachestamp)
+    {
+        memset(sightcache, 0, sizeof(sightcache));
+        sightcachestamp = 1;
+    }
+}
 
 //
 // P_DivlineSide
@@ -91,7 +127,7 @@ static fixed_t P_InterceptVector2(const divline_t *v2, const divline_t *v1)
 // Returns true
 //  if strace crosses the given subsector successfully.
 //
-static dboolean P_CrossSubsector(int num)
+static dboolean P_CrossSubsector(los_t *los, int num)
 {
     seg_t       *seg;
     int         count;
@@ -115,12 +151,12 @@ static dboolean P_CrossSubsector(int num)
         line_t  *line = seg->linedef;
         fixed_t frac;
 
-        if (line->bbox[BOXLEFT] > los.bbox[BOXRIGHT]
-            || line->bbox[BOXRIGHT] < los.bbox[BOXLEFT]
-            || line->bbox[BOXBOTTOM] > los.bbox[BOXTOP]
-            || line->bbox[BOXTOP] < los.bbox[BOXBOTTOM])
+        if (line->bbox[BOXLEFT] > los->bbox[BOXRIGHT]
+            || line->bbox[BOXRIGHT] < los->bbox[BOXLEFT]
+            || line->bbox[BOXBOTTOM] > los->bbox[BOXTOP]
+            || line->bbox[BOXTOP] < los->bbox[BOXBOTTOM])
         {
-            line->validcount = validcount;
+            P_MarkLine(los->query, line);
             continue;
         }
 
@@ -128,10 +164,10 @@ static dboolean P_CrossSubsector(int num)
         v2 = line->v2;
 
         // line isn't crossed?
-        if (P_DivlineSide(v1->x, v1->y, &los.strace)
-            == P_DivlineSide(v2->x, v2->y, &los.strace))
+        if (P_DivlineSide(v1->x, v1->y, &los->strace)
+            == P_DivlineSide(v2->x, v2->y, &los->strace))
         {
-            line->validcount = validcount;
+            P_MarkLine(los->query, line);
             continue;
         }
 
@@ -141,18 +177,18 @@ static dboolean P_CrossSubsector(int num)
         divl.dy = v2->y - v1->y;
 
         // line isn't crossed?
-        if (P_DivlineSide(los.strace.x, los.strace.y, &divl)
-            == P_DivlineSide(los.t2x, los.t2y, &divl))
+        if (P_DivlineSide(los->strace.x, los->strace.y, &divl)
+            == P_DivlineSide(los->t2x, los->t2y, &divl))
         {
-            line->validcount = validcount;
+            P_MarkLine(los->query, line);
             continue;
         }
 
         // already checked other side?
-        if (line->validcount == validcount)
+        if (P_LineVisited(los->query, line))
             continue;
 
-        line->validcount = validcount;
+        P_MarkLine(los->query, line);
 
         // crosses a two sided line
         front = seg->frontsector;
@@ -174,27 +210,27 @@ static dboolean P_CrossSubsector(int num)
             openbottom = MAX(front->floorheight, back->floorheight);
 
             // cph - reject if does not intrude in the z-space of the possible LOS
-            if (opentop >= los.maxz && openbottom <= los.minz)
+            if (opentop >= los->maxz && openbottom <= los->minz)
                 continue;
 
             // cph - if bottom >= top or top < minz or bottom > maxz then it must be
             // solid wrt this LOS
-            if (openbottom >= opentop || opentop < los.minz || openbottom > los.maxz)
+            if (openbottom >= opentop || opentop < los->minz || openbottom > los->maxz)
                 return false;
         }
         else
             return false;
 
         // crosses a two sided line
-        frac = P_InterceptVector2(&los.strace, &divl);
+        frac = P_InterceptVector2(&los->strace, &divl);
 
         if (front->floorheight != back->floorheight)
-            los.bottomslope = MAX(los.bottomslope, FixedDiv(openbottom - los.sightzstart, frac));
+            los->bottomslope = MAX(los->bottomslope, FixedDiv(openbottom - los->sightzstart, frac));
 
         if (front->ceilingheight != back->ceilingheight)
-            los.topslope = MIN(los.topslope, FixedDiv(opentop - los.sightzstart, frac));
+            los->topslope = MIN(los->topslope, FixedDiv(opentop - los->sightzstart, frac));
 
-        if (los.topslope <= los.bottomslope)
+        if (los->topslope <= los->bottomslope)
             return false;               // stop
     }
 
@@ -207,36 +243,71 @@ static dboolean P_CrossSubsector(int num)
 // Returns true
 //  if strace crosses the given node successfully.
 //
-static dboolean P_CrossBSPNode(int bspnum)
+static dboolean P_CrossBSPNode(los_t *los, int bspnum)
 {
     while (!(bspnum & NF_SUBSECTOR))
     {
         const node_t    *bsp = nodes + bspnum;
-        int             side1 = P_DivlineSide(los.strace.x, los.strace.y, (divline_t *)bsp) & 1;
-        int             side2 = P_DivlineSide(los.t2x, los.t2y, (divline_t *)bsp);
+        int             side1 = P_DivlineSide(los->strace.x, los->strace.y, (divline_t *)bsp) & 1;
+        int             side2 = P_DivlineSide(los->t2x, los->t2y, (divline_t *)bsp);
 
         if (side1 == side2)
             bspnum = bsp->children[side1];              // doesn't touch the other side
         else                                            // the partition plane is crossed here
-            if (!P_CrossBSPNode(bsp->children[side1]))
+            if (!P_CrossBSPNode(los, bsp->children[side1]))
                 return false;                           // cross the starting side
             else
                 bspnum = bsp->children[side1 ^ 1];      // cross the ending side
     }
-    return P_CrossSubsector(bspnum == -1 ? 0 : (bspnum & ~NF_SUBSECTOR));
+    return P_CrossSubsector(los, bspnum == -1 ? 0 : (bspnum & ~NF_SUBSECTOR));
+}
+
+static sightcache_t *P_SightCacheEntry(mobj_t *t1, mobj_t *t2)
+{
+    return &sightcache[((unsigned int)((uintptr_t)t1 >> 6) * 31
+        + (unsigned int)((uintptr_t)t2 >> 6)) & (SIGHTCACHESIZE - 1)];
+}
+
+static void P_StoreSight(sightcache_t *cache, mobj_t *t1, mobj_t *t2, dboolean result)
+{
+    cache->stamp = sightcachestamp;
+    cache->t1 = t1;
+    cache->t2 = t2;
+    cache->t1x = t1->x;
+    cache->t1y = t1->y;
+    cache->t1z = t1->z;
+    cache->t1height = t1->height;
+    cache->t2x = t2->x;
+    cache->t2y = t2->y;
+    cache->t2z = t2->z;
+    cache->t2height = t2->height;
+    cache->result = result;
 }
 
 //
-// P_CheckSight
+// P_CacheSight
+// [BH] Stores the result of a line of sight that has already been traced by P_TraceSight(),
+// so the next call to P_CheckSight() for the same mobjs in the same positions returns it.
+//
+void P_CacheSight(mobj_t *t1, mobj_t *t2, dboolean result)
+{
+    P_StoreSight(P_SightCacheEntry(t1, t2), t1, t2, result);
+}
+
+//
+// P_TraceSight
 // Returns true
 //  if a straight line between t1 and t2 is unobstructed.
 // Uses REJECT.
+// [BH] Doesn't use the sight cache, and only writes to the given query context, so it can be
+// called from more than one thread at once as long as nothing is moving.
 //
-dboolean P_CheckSight(mobj_t *t1, mobj_t *t2)
+dboolean P_TraceSight(querycontext_t *query, mobj_t *t1, mobj_t *t2)
 {
     const sector_t      *s1 = t1->subsector->sector;
     const sector_t      *s2 = t2->subsector->sector;
     int                 pnum = (int)(s1 - sectors) * numsectors + (int)(s2 - sectors);
+    los_t               los;
 
     // First check for trivial rejection.
     // Determine subsector entries in REJECT table.
@@ -264,7 +335,8 @@ dboolean P_CheckSight(mobj_t *t1, mobj_t *t2)
 
     // An unobstructed LOS is possible.
     // Now look from eyes of t1 to any part of t2.
-    validcount++;
+    los.query = query;
+    P_NewQuery(los.query);
 
     los.sightzstart = t1->z + t1->height - (t1->height >> 2);
     los.bottomslope = t2->z - los.sightzstart;
@@ -300,5 +372,33 @@ dboolean P_CheckSight(mobj_t *t1, mobj_t *t2)
     }
 
     // the head node is the last node output
-    return P_CrossBSPNode(numnodes - 1);
+    return P_CrossBSPNode(&los, numnodes - 1);
+}
+
+//
+// P_CheckSight
+// Returns true
+//  if a straight line between t1 and t2 is unobstructed.
+// [BH] Checks the sight cache first in case the same line of sight has already been traced
+// this tic.
+//
+dboolean P_CheckSight(mobj_t *t1, mobj_t *t2)
+{
+    sightcache_t        *cache = P_SightCacheEntry(t1, t2);
+    dboolean            result;
+
+    sightchecks++;
+
+    if (cache->stamp == sightcachestamp && cache->t1 == t1 && cache->t2 == t2
+        && cache->t1x == t1->x && cache->t1y == t1->y && cache->t1z == t1->z
+        && cache->t1height == t1->height && cache->t2x == t2->x && cache->t2y == t2->y
+        && cache->t2z == t2->z && cache->t2height == t2->height)
+    {
+        sightcachehits++;
+        return cache->result;
+    }
+
+    result = P_TraceSight(&gamequery, t1, t2);
+    P_StoreSight(cache, t1, t2, result);
+    return result;
 }
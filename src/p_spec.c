@@ -308,20 +308,50 @@ sector_t *getNextSector(line_t *line, sector_t *sec)
         line->frontsector);
 }
 
+//
+// P_InvalidateNeighborHeights
+// [BH] Called when the floor or ceiling of a sector moves, so the extremes of the heights
+// surrounding each adjacent sector are recalculated the next time they are needed.
+//
+void P_InvalidateNeighborHeights(sector_t *sec)
+{
+    int i;
+
+    for (i = 0; i < sec->neighborcount; i++)
+        sectors[sec->neighbors[i]].neighborheightsvalid = false;
+}
+
+static void P_UpdateNeighborHeights(sector_t *sec)
+{
+    int i;
+
+    sec->lowestneighborfloor = INT_MAX;
+    sec->highestneighborfloor = INT_MIN;
+    sec->lowestneighborceiling = INT_MAX;
+    sec->highestneighborceiling = INT_MIN;
+
+    for (i = 0; i < sec->neighborcount; i++)
+    {
+        const sector_t  *other = &sectors[sec->neighbors[i]];
+
+        sec->lowestneighborfloor = MIN(sec->lowestneighborfloor, other->floorheight);
+        sec->highestneighborfloor = MAX(sec->highestneighborfloor, other->floorheight);
+        sec->lowestneighborceiling = MIN(sec->lowestneighborceiling, other->ceilingheight);
+        sec->highestneighborceiling = MAX(sec->highestneighborceiling, other->ceilingheight);
+    }
+
+    sec->neighborheightsvalid = true;
+}
+
 //
 // P_FindLowestFloorSurrounding()
 // FIND LOWEST FLOOR HEIGHT IN SURROUNDING SECTORS
 //
 fixed_t P_FindLowestFloorSurrounding(sector_t *sec)
 {
-    int         i;
-    sector_t    *other;
-    fixed_t     floor = sec->floorheight;
-
-    for (i = 0; i < sec->linecount; i++)
-        if ((other = getNextSector(sec->lines[i], sec)) && other->floorheight < floor)
-            floor = other->floorheight;
-    return floor;
+    if (!sec->neighborheightsvalid)
+        P_UpdateNeighborHeights(sec);
+    return MIN(sec->floorheight, sec->lowestneighborfloor);
 }
 
 //
@@ -330,14 +360,9 @@ fixed_t P_FindLowestFloorSurrounding(sector_t *sec)
 //
 fixed_t P_FindHighestFloorSurrounding(sector_t *sec)
 {
-    int         i;
-    sector_t    *other;
-    fixed_t     floor = -32000 * FRACUNIT;
-
-    for (i = 0; i < sec->linecount; i++)
-        if ((other = getNextSector(sec->lines[i], sec)) && other->floorheight > floor)
-            floor = other->floorheight;
-    return floor;
+    if (!sec->neighborheightsvalid)
+        P_UpdateNeighborHeights(sec);
+    return MAX(-32000 * FRACUNIT, sec->highestneighborfloor);
 }
 
 //
@@ -347,20 +372,22 @@ fixed_t P_FindHighestFloorSurrounding(sector_t *sec)
 fixed_t P_FindNextHighestFloor(sector_t *sec, int currentheight)
 {
     int         i;
-    sector_t    *other;
+    fixed_t     height = INT_MAX;
 
-    for (i = 0; i < sec->linecount; i++)
-        if ((other = getNextSector(sec->lines[i], sec)) && other->floorheight > currentheight)
-        {
-            int height = other->floorheight;
+    // [BH] no adjacent floor is higher
+    if (!sec->neighborheightsvalid)
+        P_UpdateNeighborHeights(sec);
+    if (sec->highestneighborfloor <= currentheight)
+        return currentheight;
 
-            while (++i < sec->linecount)
-                if ((other = getNextSector(sec->lines[i], sec)) && other->floorheight < height
-                    && other->floorheight > currentheight)
-                    height = other->floorheight;
-            return height;
-        }
-    return currentheight;
+    for (i = 0; i < sec->neighborcount; i++)
+    {
+        const sector_t  *other = &sectors[sec->neighbors[i]];
+
+        if (other->floorheight > currentheight && other->floorheight < height)
+            height = other->floorheight;
+    }
+    return height;
 }
 
 //
@@ -370,20 +397,22 @@ fixed_t P_FindNextHighestFloor(sector_t *sec, int currentheight)
 fixed_t P_FindNextLowestFloor(sector_t *sec, int currentheight)
 {
     int         i;
-    sector_t    *other;
+    fixed_t     height = INT_MIN;
 
-    for (i = 0; i < sec->linecount; i++)
-        if ((other = getNextSector(sec->lines[i], sec)) && other->floorheight < currentheight)
-        {
-            int height = other->floorheight;
+    // [BH] no adjacent floor is lower
+    if (!sec->neighborheightsvalid)
+        P_UpdateNeighborHeights(sec);
+    if (sec->lowestneighborfloor >= currentheight)
+        return currentheight;
 
-            while (++i < sec->linecount)
-                if ((other = getNextSector(sec->lines[i], sec)) && other->floorheight > height
-                    && other->floorheight < currentheight)
-                    height = other->floorheight;
-            return height;
-        }
-    return currentheight;
+    for (i = 0; i < sec->neighborcount; i++)
+    {
+        const sector_t  *other = &sectors[sec->neighbors[i]];
+
+        if (other->floorheight < currentheight && other->floorheight > height)
+            height = other->floorheight;
+    }
+    return height;
 }
 
 //
@@ -399,21 +428,22 @@ fixed_t P_FindNextLowestFloor(sector_t *sec, int currentheight)
 fixed_t P_FindNextLowestCeiling(sector_t *sec, int currentheight)
 {
     int         i;
-    sector_t    *other;
+    fixed_t     height = INT_MIN;
 
-    for (i = 0; i < sec->linecount; i++)
-        if ((other = getNextSector(sec->lines[i], sec)) &&
-            other->ceilingheight < currentheight)
-        {
-            int height = other->ceilingheight;
-            while (++i < sec->linecount)
-                if ((other = getNextSector(sec->lines[i], sec)) &&
-                    other->ceilingheight > height &&
-                    other->ceilingheight < currentheight)
-                    height = other->ceilingheight;
-            return height;
-        }
-    return currentheight;
+    // [BH] no adjacent ceiling is lower
+    if (!sec->neighborheightsvalid)
+        P_UpdateNeighborHeights(sec);
+    if (sec->lowestneighborceiling >= currentheight)
+        return currentheight;
+
+    for (i = 0; i < sec->neighborcount; i++)
+    {
+        const sector_t  *other = &sectors[sec->neighbors[i]];
+
+        if (other->ceilingheight < currentheight && other->ceilingheight > height)
+            height = other->ceilingheight;
+    }
+    return height;
 }
 
 //
@@ -429,21 +459,22 @@ fixed_t P_FindNextLowestCeiling(sector_t *sec, int currentheight)
 fixed_t P_FindNextHighestCeiling(sector_t *sec, int currentheight)
 {
     int         i;
-    sector_t    *other;
+    fixed_t     height = INT_MAX;
 
-    for (i = 0; i < sec->linecount; i++)
-        if ((other = getNextSector(sec->lines[i], sec)) &&
-            other->ceilingheight > currentheight)
-        {
-            int height = other->ceilingheight;
-            while (++i < sec->linecount)
-                if ((other = getNextSector(sec->lines[i], sec)) &&
-                    other->ceilingheight < height &&
-                    other->ceilingheight > currentheight)
-                    height = other->ceilingheight;
-            return height;
-        }
-    return currentheight;
+    // [BH] no adjacent ceiling is higher
+    if (!sec->neighborheightsvalid)
+        P_UpdateNeighborHeights(sec);
+    if (sec->highestneighborceiling <= currentheight)
+        return currentheight;
+
+    for (i = 0; i < sec->neighborcount; i++)
+    {
+        const sector_t  *other = &sectors[sec->neighbors[i]];
+
+        if (other->ceilingheight > currentheight && other->ceilingheight < height)
+            height = other->ceilingheight;
+    }
+    return height;
 }
 
 //
@@ -451,14 +482,9 @@ fixed_t P_FindNextHighestCeiling(sector_t *sec, int currentheight)
 //
 fixed_t P_FindLowestCeilingSurrounding(sector_t *sec)
 {
-    int         i;
-    sector_t    *other;
-    fixed_t     height = 32000 * FRACUNIT;
-
-    for (i = 0; i < sec->linecount; i++)
-        if ((other = getNextSector(sec->lines[i], sec)) && other->ceilingheight < height)
-            height = other->ceilingheight;
-    return height;
+    if (!sec->neighborheightsvalid)
+        P_UpdateNeighborHeights(sec);
+    return MIN(32000 * FRACUNIT, sec->lowestneighborceiling);
 }
 
 //
@@ -466,14 +492,9 @@ fixed_t P_FindLowestCeilingSurrounding(sector_t *sec)
 //
 fixed_t P_FindHighestCeilingSurrounding(sector_t *sec)
 {
-    int         i;
-    sector_t    *other;
-    fixed_t     height = -32000 * FRACUNIT;
-
-    for (i = 0; i < sec->linecount; i++)
-        if ((other = getNextSector(sec->lines[i], sec)) && other->ceilingheight > height)
-            height = other->ceilingheight;
-    return height;
+    if (!sec->neighborheightsvalid)
+        P_UpdateNeighborHeights(sec);
+    return MAX(-32000 * FRACUNIT, sec->highestneighborceiling);
 }
 
 //
@@ -656,12 +677,10 @@ static void P_InitTagLists(void)
 //
 int P_FindMinSurroundingLight(sector_t *sector, int min)
 {
-    int         i;
-    sector_t    *check;
+    int i;
 
-    for (i = 0; i < sector->linecount; i++)
-        if ((check = getNextSector(sector->lines[i], sector)) && check->lightlevel < min)
-            min = check->lightlevel;
+    for (i = 0; i < sector->neighborcount; i++)
+        min = MIN(min, sectors[sector->neighbors[i]].lightlevel);
     return min;
 }
 
@@ -38,7 +38,9 @@
 
 #include "c_console.h"
 #include "doomstat.h"
+#include "i_system.h"
 #include "p_local.h"
+#include "p_setup.h"
 #include "p_tick.h"
 #include "s_sound.h"
 #include "z_zone.h"
@@ -83,7 +85,8 @@ void P_UpdateThinker(thinker_t *thinker)
     thinker_t   *th;
 
     // find the class the thinker belongs to
-    int class = (thinker->function == P_RemoveThinkerDelayed ? th_delete :
+    int class = (thinker->function == P_RemoveThinkerDelayed
+        || thinker->function == P_RemoveMobjDelayed ? th_delete :
         (thinker->function == P_MobjThinker ? th_mobj : th_misc));
 
     // Remove from current thread, if in one
@@ -125,16 +128,11 @@ void P_AddThinker(thinker_t *thinker)
 static thinker_t        *currentthinker;
 
 //
-// P_RemoveThinkerDelayed()
-//
-// Called automatically as part of the thinker loop in P_RunThinkers(),
-// on nodes which are pending deletion.
-//
-// If this thinker has no more pointers referencing it indirectly,
-// remove it, and set currentthinker to one node preceding it, so
-// that the next step in P_RunThinkers() will get its successor.
+// P_UnlinkThinker
+// Removes a thinker from the thinker lists, unless something still refers to it,
+// and returns true if it did.
 //
-void P_RemoveThinkerDelayed(thinker_t *thinker)
+static dboolean P_UnlinkThinker(thinker_t *thinker)
 {
     if (!thinker->references)
     {
@@ -151,8 +149,37 @@ void P_RemoveThinkerDelayed(thinker_t *thinker)
         // Remove from current thinker class list
         (th->cprev = thinker->cprev)->cnext = th;
 
-        Z_Free(thinker);
+        return true;
     }
+
+    return false;
+}
+
+//
+// P_RemoveThinkerDelayed()
+//
+// Called automatically as part of the thinker loop in P_RunThinkers(),
+// on nodes which are pending deletion.
+//
+// If this thinker has no more pointers referencing it indirectly,
+// remove it, and set currentthinker to one node preceding it, so
+// that the next step in P_RunThinkers() will get its successor.
+//
+void P_RemoveThinkerDelayed(thinker_t *thinker)
+{
+    if (P_UnlinkThinker(thinker))
+        Z_Free(thinker);
+}
+
+//
+// P_RemoveMobjDelayed
+// [BH] The same as P_RemoveThinkerDelayed(), except that the mobj is returned to
+// the mobj pool rather than freed.
+//
+void P_RemoveMobjDelayed(thinker_t *thinker)
+{
+    if (P_UnlinkThinker(thinker))
+        P_FreeMobj((mobj_t *)thinker);
 }
 
 //
@@ -186,6 +213,11 @@ void P_RemoveThinker(thinker_t *thinker)
 //
 void P_SetTarget(mobj_t **mop, mobj_t *targ)
 {
+#if defined(_DEBUG)
+    if (targ && !(P_MobjGeneration(targ) & 1))
+        I_Error("P_SetTarget: Mobj %p has already been freed", (void *)targ);
+#endif
+
     if (*mop)           // If there was a target already, decrease its refcount
         (*mop)->thinker.references--;
     if ((*mop = targ))  // Set new target and if non-NULL, increase its counter
@@ -216,12 +248,19 @@ void P_SetTarget(mobj_t **mop, mobj_t *targ)
 //
 static void P_RunThinkers(void)
 {
+    thinker_t   *playerthinker = &players[0].mo->thinker;
+
     currentthinker = thinkercap.next;
 
     while (currentthinker != &thinkercap)
     {
         if (currentthinker->function)
             currentthinker->function(currentthinker);
+
+        // [BH] the player has moved, so sense the monsters that think after them
+        if (currentthinker == playerthinker)
+            P_SenseMonsters(playerthinker->cnext, &thinkerclasscap[th_mobj]);
+
         currentthinker = currentthinker->next;
     }
 
@@ -238,8 +277,14 @@ void P_Ticker(void)
     if (paused || menuactive || consoleactive)
         return;
 
+    P_ClearSightCache();
+    P_UpdateReject();
+
     P_PlayerThink(&players[0]);
 
+    // [BH] sense the monsters that think before the player moves
+    P_SenseMonsters(thinkerclasscap[th_mobj].cnext, &players[0].mo->thinker);
+
     P_RunThinkers();
     P_UpdateSpecials();
     P_RespawnSpecials();
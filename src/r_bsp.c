@@ -40,6 +40,7 @@
 
 #include "doomstat.h"
 #include "m_bbox.h"
+#include "p_local.h"
 #include "r_main.h"
 #include "r_plane.h"
 #include "r_things.h"
@@ -671,9 +672,9 @@ static void R_Subsector(int num)
     // Either you must pass the fake sector and handle validcount here, on the
     // real sector, or you must account for the lighting in some other way,
     // like passing it as an argument.
-    if (sub->sector->validcount != validcount)
+    if (!P_SectorVisited(&renderquery, sub->sector))
     {
-        sub->sector->validcount = validcount;
+        P_MarkSector(&renderquery, sub->sector);
         R_AddSprites(sub->sector, floorlightlevel);
     }
 
@@ -84,6 +84,30 @@ typedef struct
     fixed_t             z;
 } degenmobj_t;
 
+//
+// [BH] Blood splats are stored as decals in the sector they are in, rather than as mobjs.
+//
+typedef struct bloodsplat_s
+{
+    fixed_t             x;
+    fixed_t             y;
+    int                 blood;
+    int                 frame;
+    struct bloodsplat_s *snext;
+    struct bloodsplat_s **sprev;
+} bloodsplat_t;
+
+//
+// [BH] An edge in the graph of sectors that sound travels through, built when a map is loaded.
+//
+typedef struct
+{
+    int                 sector;                 // sector on the other side of line
+    struct line_s       *line;
+    dboolean            soundblock;             // line has ML_SOUNDBLOCK set
+    dboolean            open;                   // line was open when the map was loaded
+} soundedge_t;
+
 //
 // The SECTORS record, at runtime.
 // Stores things/mobjs.
@@ -111,12 +135,12 @@ typedef struct
     // origin for any sounds played by the sector
     degenmobj_t         soundorg;
 
-    // if == validcount, already checked
-    int                 validcount;
-
     // list of mobjs in sector
     mobj_t              *thinglist;
 
+    // list of blood splats in sector
+    bloodsplat_t        *splatlist;
+
     // thinker_t for reversible actions
     void                *floordata;             // jff 2/22/98 make thinkers on
     void                *ceilingdata;           // floors, ceilings, lighting,
@@ -129,6 +153,21 @@ typedef struct
     int                 linecount;
     struct line_s       **lines;                // [linecount] size
 
+    // [BH] two-sided lines that sound can travel through
+    int                 soundedgecount;
+    soundedge_t         *soundedges;            // [soundedgecount] size
+
+    // [BH] floor or ceiling has moved since the map was loaded
+    dboolean            moved;
+
+    // [BH] unique sectors adjacent to this one, and the extremes of their heights. The extremes
+    //      are recalculated when needed after any of the sectors move.
+    int                 neighborcount;
+    int                 *neighbors;             // [neighborcount] size
+    dboolean            neighborheightsvalid;
+    fixed_t             lowestneighborfloor, highestneighborfloor;
+    fixed_t             lowestneighborceiling, highestneighborceiling;
+
     int                 cachedheight;
     int                 scaleindex;
 
@@ -251,9 +290,6 @@ typedef struct line_s
     sector_t            *frontsector;
     sector_t            *backsector;
 
-    // if == validcount, already checked
-    int                 validcount;
-
     // thinker_t for reversible actions
     void                *specialdata;
 
@@ -974,4 +1010,16 @@ typedef struct visplane_s
     sector_t            *sector;        // [BH] Support animated liquid sectors
 } visplane_t;
 
+//
+// [BH] A query context holds the stamps used to mark the lines and sectors visited by a
+// spatial query, in place of the validcount fields that were once in every line and
+// sector. Each thread that queries the map at the same time needs its own context.
+//
+typedef struct
+{
+    unsigned int        stamp;
+    unsigned int        *linestamps;
+    unsigned int        *sectorstamps;
+} querycontext_t;
+
 #endif
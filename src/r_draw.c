@@ -54,6 +54,7 @@
 int     viewwidth;
 int     scaledviewwidth;
 int     viewheight;
+int     scaledviewheight;
 int     viewheight2;
 int     viewwindowx;
 int     viewwindowy;
@@ -1407,7 +1408,7 @@ void R_FillBackScreen(void)
 
     // Draw screen and bezel; this is done to a separate screen buffer.
     width = scaledviewwidth / 2;
-    height = viewheight / 2;
+    height = scaledviewheight / 2;
     windowx = viewwindowx / 2;
     windowy = viewwindowy / 2;
 
@@ -1432,6 +1433,41 @@ void R_FillBackScreen(void)
     V_DrawPatch(windowx + width, windowy + height, 1, brdr_br);
 }
 
+//
+// R_ScaleView
+// Scales the view up from viewwidth*viewheight to
+//  scaledviewwidth*scaledviewheight in place. Working
+//  backwards means no pixel is overwritten before it's read.
+//
+void R_ScaleView(void)
+{
+    static int  xlookup[SCREENWIDTH];
+    int         x, y;
+    int         prevsrcy = -1;
+    byte        *origin = R_ADDRESS(0, 0, 0);
+
+    for (x = 0; x < scaledviewwidth; x++)
+        xlookup[x] = x * viewwidth / scaledviewwidth;
+
+    for (y = scaledviewheight - 1; y >= 0; y--)
+    {
+        int     srcy = y * viewheight / scaledviewheight;
+        byte    *dest = origin + y * SCREENWIDTH;
+
+        if (srcy == prevsrcy)
+            memcpy(dest, dest + SCREENWIDTH, scaledviewwidth);
+        else
+        {
+            byte        *src = origin + srcy * SCREENWIDTH;
+
+            for (x = scaledviewwidth - 1; x >= 0; x--)
+                dest[x] = src[xlookup[x]];
+        }
+
+        prevsrcy = srcy;
+    }
+}
+
 //
 // Copy a screen buffer.
 //
@@ -1460,21 +1496,21 @@ void R_DrawViewBorder(void)
     if (scaledviewwidth == SCREENWIDTH)
         return;
 
-    top = (SCREENHEIGHT - SBARHEIGHT - viewheight) / 2;
+    top = (SCREENHEIGHT - SBARHEIGHT - scaledviewheight) / 2;
     side = (SCREENWIDTH - scaledviewwidth) / 2;
 
     // copy top and one line of left side
     R_VideoErase(0, top * SCREENWIDTH + side);
 
     // copy one line of right side and bottom
-    ofs = (viewheight + top) * SCREENWIDTH - side;
+    ofs = (scaledviewheight + top) * SCREENWIDTH - side;
     R_VideoErase(ofs, top * SCREENWIDTH + side);
 
     // copy sides using wraparound
     ofs = top * SCREENWIDTH + SCREENWIDTH - side;
     side <<= 1;
 
-    for (i = 1; i < viewheight; i++)
+    for (i = 1; i < scaledviewheight; i++)
     {
         R_VideoErase(ofs, side);
         ofs += SCREENWIDTH;
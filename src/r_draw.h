@@ -146,6 +146,7 @@ extern byte             *dc_translation;
 void R_DrawSpan(void);
 
 void R_InitBuffer(int width, int height);
+void R_ScaleView(void);
 
 // Initialize color translation tables,
 //  for player rendering etc.
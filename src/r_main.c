@@ -46,9 +46,6 @@
 // Fineangles in the SCREENWIDTH wide window.
 #define FIELDOFVIEW     2048
 
-// increment every time a check is made
-int                     validcount = 1;
-
 lighttable_t            *fixedcolormap;
 extern lighttable_t     **walllights;
 
@@ -110,8 +107,14 @@ lighttable_t            **colormaps;
 int                     extralight;
 
 dboolean                r_homindicator = r_homindicator_default;
+int                     r_dynamicresolution = r_dynamicresolution_default;
+int                     r_renderscale = r_renderscale_default;
 dboolean                r_translucency = r_translucency_default;
 
+// The percentage of scaledviewwidth*scaledviewheight the view is rendered at,
+// which may be lowered from r_renderscale if r_dynamicresolution is set
+static int              renderscale = r_renderscale_default;
+
 extern int              viewheight2;
 
 void (*colfunc)(void);
@@ -435,17 +438,19 @@ void R_ExecuteSetViewSize(void)
     if (setblocks == 11)
     {
         scaledviewwidth = SCREENWIDTH;
-        viewheight = SCREENHEIGHT;
+        scaledviewheight = SCREENHEIGHT;
         viewheight2 = SCREENHEIGHT;
     }
     else
     {
         scaledviewwidth = setblocks * SCREENWIDTH / 10;
-        viewheight = (setblocks * (SCREENHEIGHT - SBARHEIGHT) / 10) & ~7;
+        scaledviewheight = (setblocks * (SCREENHEIGHT - SBARHEIGHT) / 10) & ~7;
         viewheight2 = SCREENHEIGHT - SBARHEIGHT;
     }
 
-    viewwidth = scaledviewwidth;
+    renderscale = (r_dynamicresolution ? MIN(renderscale, r_renderscale) : r_renderscale);
+    viewwidth = scaledviewwidth * renderscale / 100;
+    viewheight = scaledviewheight * renderscale / 100;
     viewheightfrac = viewheight << FRACBITS;
 
     centery = viewheight / 2;
@@ -456,7 +461,7 @@ void R_ExecuteSetViewSize(void)
     projectiony = ((SCREENHEIGHT * centerx * ORIGINALWIDTH) / ORIGINALHEIGHT) / SCREENWIDTH
         * FRACUNIT;
 
-    R_InitBuffer(scaledviewwidth, viewheight);
+    R_InitBuffer(scaledviewwidth, scaledviewheight);
 
     R_InitTextureMapping();
 
@@ -484,7 +489,10 @@ void R_ExecuteSetViewSize(void)
 
         for (j = 0; j < MAXLIGHTSCALE; j++)
         {
-            int t, level = BETWEEN(0, startmap - j * SCREENWIDTH / (viewwidth * DISTMAP),
+            // scales are smaller when the view is rendered at a lower resolution,
+            //  so find the light level the same distance would have at full resolution
+            int t, level = BETWEEN(0, startmap - MIN(j * scaledviewwidth / viewwidth,
+                MAXLIGHTSCALE - 1) * SCREENWIDTH / (scaledviewwidth * DISTMAP),
                 NUMCOLORMAPS - 1) * 256;
 
             // killough 3/20/98: initialize multiple colormaps
@@ -654,7 +662,7 @@ void R_SetupFrame(player_t *player)
 
     // Figure out how far into the current tic we're in as a fixed_t
     if (!vid_capfps)
-        fractionaltic = I_GetTimeMS() * TICRATE % 1000 * FRACUNIT / 1000;
+        fractionaltic = I_GetFracTic();
 
     if (!vid_capfps
         // Don't interpolate on the first tic of a level, otherwise
@@ -718,7 +726,47 @@ void R_SetupFrame(player_t *player)
     else
         fixedcolormap = 0;
 
-    ++validcount;
+    P_NewQuery(&renderquery);
+}
+
+//
+// R_UpdateRenderScale
+// Lowers renderscale when rendering the view takes longer than a frame at
+//  r_dynamicresolution FPS, and raises it again when there's enough headroom.
+//
+static void R_UpdateRenderScale(uint64_t rendertime)
+{
+    static uint64_t     averagetime;
+    static int          wait;
+    const uint64_t      budget = 1000000000 / r_dynamicresolution;
+    int                 newscale = renderscale;
+
+    averagetime = (averagetime * 7 + rendertime) / 8;
+
+    if (wait)
+    {
+        --wait;
+        return;
+    }
+
+    if (averagetime > budget)
+        newscale = MAX(renderscale - 10, r_renderscale_min);
+    else if (renderscale < r_renderscale)
+    {
+        int     nextscale = MIN(renderscale + 10, r_renderscale);
+
+        // the time taken is roughly proportional to the number of pixels rendered
+        if (averagetime * nextscale * nextscale < budget * 8 / 10 * renderscale * renderscale)
+            newscale = nextscale;
+    }
+
+    if (newscale != renderscale)
+    {
+        averagetime = averagetime * newscale * newscale / (renderscale * renderscale);
+        renderscale = newscale;
+        setsizeneeded = true;
+        wait = TICRATE;
+    }
 }
 
 //
@@ -726,6 +774,8 @@ void R_SetupFrame(player_t *player)
 //
 void R_RenderPlayerView(player_t *player)
 {
+    uint64_t    starttime = (r_dynamicresolution ? I_GetTimeNS() : 0);
+
     R_SetupFrame(player);
 
     // Clear buffers.
@@ -754,4 +804,10 @@ void R_RenderPlayerView(player_t *player)
         R_DrawPlanes();
         R_DrawMasked();
     }
+
+    if (viewwidth != scaledviewwidth)
+        R_ScaleView();
+
+    if (r_dynamicresolution)
+        R_UpdateRenderScale(I_GetTimeNS() - starttime);
 }
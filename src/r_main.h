@@ -58,7 +58,6 @@ extern fixed_t          centeryfrac;
 extern fixed_t          projection;
 extern fixed_t          projectiony;
 
-extern int              validcount;
 
 //
 // Lighting LUT.
@@ -67,6 +67,7 @@ extern lighttable_t     *fullcolormap;  // killough 3/20/98
 extern int              viewwidth;
 extern int              scaledviewwidth;
 extern int              viewheight;
+extern int              scaledviewheight;
 
 extern int              firstflat;
 
@@ -877,7 +877,7 @@ void R_ProjectSprite(mobj_t *thing)
         vis->colormap = spritelights[BETWEEN(0, xscale >> LIGHTSCALESHIFT, MAXLIGHTSCALE - 1)];
 }
 
-void R_ProjectBloodSplat(mobj_t *thing)
+void R_ProjectBloodSplat(bloodsplat_t *splat, sector_t *sec)
 {
     fixed_t             tx;
 
@@ -890,8 +890,8 @@ void R_ProjectBloodSplat(mobj_t *thing)
 
     vissprite_t         *vis;
 
-    fixed_t             fx = thing->x;
-    fixed_t             fy = thing->y;
+    fixed_t             fx = splat->x;
+    fixed_t             fy = splat->y;
     fixed_t             fz;
 
     fixed_t             width;
@@ -918,7 +918,7 @@ void R_ProjectBloodSplat(mobj_t *thing)
         return;
 
     // decide which patch to use for sprite relative to player
-    lump = sprites[SPR_BLD2].spriteframes[thing->frame].lump[0];
+    lump = sprites[SPR_BLD2].spriteframes[splat->frame].lump[0];
     width = spritewidth[lump];
 
     // calculate edges of the shape
@@ -935,6 +935,9 @@ void R_ProjectBloodSplat(mobj_t *thing)
     if (x2 < 0)
         return;
 
+    if (num_bloodvissprite >= NUMVISSPRITES)
+        return;
+
     // store information in a vissprite
     vis = &bloodvissprites[num_bloodvissprite++];
 
@@ -942,15 +945,15 @@ void R_ProjectBloodSplat(mobj_t *thing)
     vis->scale = xscale;
     vis->gx = fx;
     vis->gy = fy;
-    fz = thing->subsector->sector->interpfloorheight;
+    fz = sec->interpfloorheight;
     vis->gz = fz;
     vis->gzt = fz + 1;
-    vis->blood = thing->blood;
+    vis->blood = splat->blood;
 
-    if ((thing->flags & MF_FUZZ) && (menuactive || paused || consoleactive))
-        vis->colfunc = R_DrawPausedFuzzColumn;
+    if (splat->blood == FUZZYBLOOD)
+        vis->colfunc = (menuactive || paused || consoleactive ? R_DrawPausedFuzzColumn : fuzzcolfunc);
     else
-        vis->colfunc = thing->colfunc;
+        vis->colfunc = bloodsplatcolfunc;
 
     vis->texturemid = fz + 1 - viewz;
 
@@ -971,7 +974,11 @@ void R_ProjectBloodSplat(mobj_t *thing)
         vis->colormap = spritelights[BETWEEN(0, xscale >> LIGHTSCALESHIFT, MAXLIGHTSCALE - 1)];
 }
 
-void R_ProjectShadow(mobj_t *thing)
+//
+// R_ProjectShadow
+// [BH] Project the shadow of a thing onto the floor of its sector, using the thing itself
+//
+static void R_ProjectShadow(mobj_t *thing)
 {
     fixed_t             tx;
 
@@ -988,16 +995,35 @@ void R_ProjectShadow(mobj_t *thing)
 
     vissprite_t         *vis;
 
-    fixed_t             fx = thing->x;
-    fixed_t             fy = thing->y;
-    fixed_t             fz = thing->subsector->sector->interpfloorheight
-                             + thing->shadow->info->shadowoffset;
+    fixed_t             fx;
+    fixed_t             fy;
+    fixed_t             fz = thing->subsector->sector->interpfloorheight + thing->info->shadowoffset;
+    angle_t             fangle;
 
     // transform the origin point
-    fixed_t             tr_x = fx - viewx;
-    fixed_t             tr_y = fy - viewy;
+    fixed_t             tr_x;
+    fixed_t             tr_y;
 
-    fixed_t             tz = FixedMul(tr_x, viewcos) + FixedMul(tr_y, viewsin);
+    fixed_t             tz;
+
+    // [AM] Interpolate between current and last position, if prudent.
+    if (!vid_capfps && thing->interp && !paused && !menuactive && !consoleactive)
+    {
+        fx = thing->oldx + FixedMul(thing->x - thing->oldx, fractionaltic);
+        fy = thing->oldy + FixedMul(thing->y - thing->oldy, fractionaltic);
+        fangle = R_InterpolateAngle(thing->oldangle, thing->angle, fractionaltic);
+    }
+    else
+    {
+        fx = thing->x;
+        fy = thing->y;
+        fangle = thing->angle;
+    }
+
+    tr_x = fx - viewx;
+    tr_y = fy - viewy;
+
+    tz = FixedMul(tr_x, viewcos) + FixedMul(tr_y, viewsin);
 
     // thing is behind view plane?
     if (tz < MINZ)
@@ -1025,9 +1051,9 @@ void R_ProjectShadow(mobj_t *thing)
         angle_t ang = R_PointToAngle(fx, fy);
 
         if (sprframe->lump[0] == sprframe->lump[1])
-            rot = (ang - thing->angle + (angle_t)(ANG45 / 2) * 9) >> 28;
+            rot = (ang - fangle + (angle_t)(ANG45 / 2) * 9) >> 28;
         else
-            rot = (ang - thing->angle + (angle_t)(ANG45 / 2) * 9 - (angle_t)(ANG180 / 16)) >> 28;
+            rot = (ang - fangle + (angle_t)(ANG45 / 2) * 9 - (angle_t)(ANG180 / 16)) >> 28;
         lump = sprframe->lump[rot];
         flip = (!!(sprframe->flip & (1 << rot)) || (thing->flags2 & MF2_MIRRORED));
     }
@@ -1052,6 +1078,9 @@ void R_ProjectShadow(mobj_t *thing)
     if (x2 < 0)
         return;
 
+    if (num_shadowvissprite >= NUMVISSPRITES)
+        return;
+
     // store information in a vissprite
     vis = &shadowvissprites[num_shadowvissprite++];
 
@@ -1063,7 +1092,8 @@ void R_ProjectShadow(mobj_t *thing)
     vis->gy = fy;
     vis->gz = fz;
     vis->gzt = fz;
-    vis->colfunc = thing->colfunc;
+    vis->colfunc = ((thing->flags & MF_FUZZ) ? R_DrawFuzzyShadowColumn :
+        (r_translucency ? R_DrawShadowColumn : R_DrawSolidShadowColumn));
     vis->texturemid = fz - viewz;
 
     vis->x1 = MAX(0, x1);
@@ -1092,8 +1122,9 @@ void R_ProjectShadow(mobj_t *thing)
 // killough 9/18/98: add lightlevel as parameter, fixing underwater lighting
 void R_AddSprites(sector_t *sec, int lightlevel)
 {
-    mobj_t      *thing;
-    short       floorpic = sec->floorpic;
+    mobj_t          *thing;
+    bloodsplat_t    *splat;
+    short           floorpic = sec->floorpic;
 
     spritelights = scalelight[BETWEEN(0, (lightlevel >> LIGHTSEGSHIFT) + extralight * LIGHTBRIGHT,
         LIGHTLEVELS - 1)];
@@ -1101,13 +1132,20 @@ void R_AddSprites(sector_t *sec, int lightlevel)
     // Handle all things in sector.
     if (fixedcolormap || isliquid[floorpic] || floorpic == skyflatnum || !r_shadows)
         for (thing = sec->thinglist; thing; thing = thing->snext)
-        {
-            if (thing->type != MT_SHADOW)
-                thing->projectfunc(thing);
-        }
+            thing->projectfunc(thing);
     else
         for (thing = sec->thinglist; thing; thing = thing->snext)
+        {
             thing->projectfunc(thing);
+
+            // [BH] project the thing's shadow
+            if (thing->flags2 & MF2_SHADOW)
+                R_ProjectShadow(thing);
+        }
+
+    // Handle all blood splats in sector.
+    for (splat = sec->splatlist; splat; splat = splat->snext)
+        R_ProjectBloodSplat(splat, sec);
 }
 
 //
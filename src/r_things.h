@@ -67,7 +67,6 @@ void R_DrawPlayerSprites(void);
 void R_DrawMasked(void);
 
 void R_ProjectSprite(mobj_t *thing);
-void R_ProjectBloodSplat(mobj_t *thing);
-void R_ProjectShadow(mobj_t *thing);
+void R_ProjectBloodSplat(bloodsplat_t *splat, sector_t *sec);
 
 #endif
@@ -100,6 +100,7 @@ static sobj_t           *sobjs;
 
 int                     s_musicvolume = s_musicvolume_default;
 int                     s_sfxvolume = s_sfxvolume_default;
+dboolean                s_precachesfx = s_precachesfx_default;
 dboolean                s_randommusic = s_randommusic_default;
 dboolean                s_randompitch = s_randompitch_default;
 
@@ -206,6 +207,9 @@ void S_Init(int sfxvol, int musicvol)
         // Note that sounds have not been cached (yet).
         for (i = 1; i < NUMSFX; i++)
             S_sfx[i].lumpnum = -1;
+
+        if (s_precachesfx)
+            S_PrecacheSounds();
     }
 
     if (!nomusic)
@@ -218,6 +222,33 @@ void S_Init(int sfxvol, int musicvol)
     }
 }
 
+//
+// S_PrecacheSounds
+// [BH] Finds the lumps of all sound effects and converts them at once.
+//
+void S_PrecacheSounds(void)
+{
+    int i;
+
+    if (nosfx)
+        return;
+
+    for (i = 1; i < NUMSFX; i++)
+    {
+        sfxinfo_t   *sfx = &S_sfx[i];
+
+        if (sfx->lumpnum < 0)
+        {
+            char    namebuf[9];
+
+            M_snprintf(namebuf, 9, "ds%s", (sfx->link ? sfx->link : sfx)->name);
+            sfx->lumpnum = W_CheckNumForName(namebuf);
+        }
+    }
+
+    I_PrecacheSounds(&S_sfx[1], NUMSFX - 1);
+}
+
 void S_Shutdown(void)
 {
     I_ShutdownSound();
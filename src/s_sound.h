@@ -46,11 +46,13 @@
 #define SAMPLERATE      44100
 #define NUM_CHANNELS    32
 
+extern dboolean s_precachesfx;
 extern dboolean s_randompitch;
 
 dboolean I_InitSound(void);
 void I_ShutdownSound(void);
 int I_GetSfxLumpNum(sfxinfo_t *sfx);
+void I_PrecacheSounds(sfxinfo_t *sfxinfos, int count);
 void I_UpdateSoundParams(int handle, int vol, int sep);
 int I_StartSound(sfxinfo_t *sfxinfo, int channel, int vol, int sep, int pitch);
 void I_StopSound(int handle);
@@ -75,6 +77,9 @@ dboolean I_MusicIsPlaying(void);
 //
 void S_Init(int sfxvol, int musicvol);
 
+// Converts all sound effects so they don't need to be when first played
+void S_PrecacheSounds(void);
+
 // Shut down sound
 void S_Shutdown(void);
 
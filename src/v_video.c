@@ -1293,8 +1293,8 @@ void GetPixelSize(dboolean reset)
 void V_LowGraphicDetail(void)
 {
     int x, y;
-    int w = viewwindowx + viewwidth;
-    int h = (viewwindowy + viewheight) * SCREENWIDTH;
+    int w = viewwindowx + scaledviewwidth;
+    int h = (viewwindowy + scaledviewheight) * SCREENWIDTH;
     int hh = pixelheight * SCREENWIDTH;
 
     for (y = viewwindowy * SCREENWIDTH; y < h; y += hh)
@@ -1011,6 +1011,8 @@ void WI_checkForAccelerate(void)
 // Updates stuff each tick
 void WI_Ticker(void)
 {
+    P_UpdatePrefetch();
+
     if (menuactive || paused || consoleactive)
         return;
 
@@ -1246,4 +1248,8 @@ void WI_Start(wbstartstruct_t *wbstartstruct)
     WI_loadData();
 
     WI_initStats();
+
+    // [BH] start loading the next map while the stats are shown
+    if (gamemode == commercial || wbs->last != 7)
+        P_StartPrefetch(wbs->epsd + 1, wbs->next + 1);
 }